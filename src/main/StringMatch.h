@@ -91,12 +91,32 @@ typedef ptrdiff_t Long;
 
 struct Status {
     enum MatchStatus {
+        IOError = -3,
         InvalidParameter = -2,
         NotFound = -1,
         Found = 0
     };
 };
 
+struct MatchMode {
+    enum Type {
+        // The next match may start inside of the previous one.
+        Overlapping = 0,
+        // The next match starts behind the end of the previous one.
+        NonOverlapping = 1
+    };
+};
+
+struct CaseFold {
+    enum Type {
+        // Only the ASCII letters are folded, the other bytes are compared as is.
+        Ascii = 0,
+        // A non-ASCII pattern is decoded as UTF-8, and the code points are
+        // compared by the simple case folding of Unicode.
+        Utf8 = 1
+    };
+};
+
 } // namespace StringMatch
 
 #endif // MAIN_STRING_MATCH_H
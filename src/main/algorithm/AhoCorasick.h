@@ -18,10 +18,8 @@
 
 #include "StringMatch.h"
 #include "algorithm/AlgorithmWrapper.h"
-#include "jstd/scoped_ptr.h"
 #include "jstd/vector.h"
-
-#define USE_PLACEMENT_NEW   1
+#include "jstd/arena.h"
 
 //
 // Article:
@@ -42,15 +40,19 @@ struct ACNode {
     static const size_type kMaxAscii = 256;
 
     ACNode * fail;
+    ACNode * output;        // The nearest terminal node on the fail chain (output link).
     Long cnt;
+    int first_output;       // The head of the output list of this node, -1 is none.
     ACNode * next[kMaxAscii];
 
+    // The nodes are owned by the arena of automation, it's trivially destructible.
     ACNode(ACNode * _fail = nullptr)  { init(_fail); }
-    ~ACNode() { destroy(); }
 
     void init(ACNode * _fail = nullptr) {
         this->fail = _fail;
+        this->output = nullptr;
         this->cnt = 0;
+        this->first_output = -1;
 #if 1
         memset((void *)&this->next[0], 0, kMaxAscii * sizeof(ACNode *));
 #else
@@ -59,69 +61,6 @@ struct ACNode {
         }
 #endif
     }
-
-    void destroy() {
-#if USE_PLACEMENT_NEW
-  #if 0
-        for (size_type i = 0; i < kMaxAscii; ++i) {
-            if (this->next[i] != nullptr) {
-                this->next[i]->~ACNode();
-                this->next[i] = nullptr;
-            }
-        }
-  #endif
-#else
-        for (size_type i = 0; i < kMaxAscii; ++i) {
-            if (this->next[i] != nullptr) {
-                delete next[i];
-                this->next[i] = nullptr;
-            }
-        }
-#endif
-    }
-};
-
-struct MemoryPool {
-public:
-    typedef std::size_t size_type;
-    typedef ACNode      node_type;
-
-    static const size_type kMaxSize = 16384;
-
-private:
-    bool inited_;
-    std::vector<node_type *> nodes_;
-
-public:
-    MemoryPool() : inited_(false) { init(); }
-    ~MemoryPool() { destroy(); }
-
-    void init() {
-        if (!this->inited_) {
-            this->nodes_.reserve(kMaxSize);
-            for (size_type i = 0; i < kMaxSize; ++i) {
-                this->nodes_.emplace_back(new node_type());
-            }
-            this->inited_ = true;
-        }
-    }
-
-    void destroy() {
-        if (this->inited_) {
-            for (size_type i = 0; i < kMaxSize; ++i) {
-                if (this->nodes_[i] != nullptr) {
-                    delete this->nodes_[i];
-                    this->nodes_[i] = nullptr;
-                }
-            }
-            this->inited_ = false;
-        }
-    }
-
-    void * get(size_type i) {
-        assert(i < kMaxSize);
-        return (void *)this->nodes_[i];
-    }
 };
 
 template <typename CharTy>
@@ -136,66 +75,84 @@ public:
 
     static const size_type kMaxAscii = 256;
 
-    static MemoryPool memory_pool;
-    static int pool_idx;
+    struct output_type {
+        int id;             // The id of pattern.
+        int length;         // The length of pattern.
+        int next;           // The next output of the same node, -1 is end.
+    };
 
 private:
-    jstd::scoped_ptr<node_type> root_;
+    jstd::arena<node_type> arena_;          // All of the nodes of this automation.
+    node_type * root_;
     jstd::vector<node_type *> queue_;
+    std::vector<output_type> outputs_;
 
 public:
     AhoCorasickImpl() : root_(nullptr) {
         this->init();
-        AhoCorasickImpl::memory_pool.init();
     }
     ~AhoCorasickImpl() {
         this->destroy();
     }
 
-    static void reset_counter() {
-        AhoCorasickImpl::pool_idx = 0;
+    static const char * name() { return "AhoCorasick"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const {
+        return (this->root_ != nullptr);
     }
 
-    static int get_counter() {
-        return AhoCorasickImpl::pool_idx;
+    // The length of the longest pattern ends at this node.
+    Long match_length(const node_type * node) const {
+        const node_type * terminal = (node->cnt > 0) ? node : node->output;
+        assert(terminal != nullptr);
+        assert(terminal->first_output >= 0);
+        return (Long)this->outputs_[terminal->first_output].length;
     }
 
-    static const char * name() { return "AhoCorasick"; }
-    static bool need_preprocessing() { return true; }
+    size_type state_count() const {
+        return this->arena_.size();
+    }
 
-    bool is_alive() const {
-        return (this->root_.get() != nullptr);
+    size_type memory_usage() const {
+        return (this->arena_.memory_usage() +
+                this->outputs_.capacity() * sizeof(output_type));
     }
 
     void init() {
-        this->root_.reset(new node_type());
+        this->root_ = this->arena_.create();
         this->queue_.reserve(63);
     }
 
     void destroy() {
-        this->root_.reset();
+        // Release all of the nodes at once.
+        this->arena_.destroy();
+        this->root_ = nullptr;
+        this->outputs_.clear();
     }
 
-#if 1
-    void build_trie(const char_type * pattern, size_type length) {
-        node_type * root = this->root_.get();
-        node_type * node = root;
-        assert(node != nullptr);
+    /* Add a pattern to the trie, call compile() after all patterns are added. */
+    bool add_pattern(int id, const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (unlikely(length == 0))
+            return false;
+
+        if (unlikely(this->root_ == nullptr)) {
+            this->init();
+            if (unlikely(this->root_ == nullptr))
+                return false;
+        }
+
+        node_type * node = this->root_;
 
         for (size_type i = 0; i < length; ++i) {
             uchar_type ch = (uchar_type)*pattern++;
             assert(node != nullptr);
             if (likely(node->next[ch] == nullptr)) {
-#if USE_PLACEMENT_NEW
-                void * next_ptr = AhoCorasickImpl::memory_pool.get(AhoCorasickImpl::pool_idx);
-                node_type * next = new (next_ptr) node_type();
-                assert((void *)next == next_ptr);
-                AhoCorasickImpl::pool_idx++;
-#else
-                node_type * next = new node_type();
-#endif
+                node_type * next = this->arena_.create();
+                if (unlikely(next == nullptr))
+                    return false;
                 node->next[ch] = next;
-                assert(next != nullptr);
                 node = next;
             }
             else {
@@ -203,16 +160,29 @@ public:
             }
         }
 
-        // Record the leaf node.
+        // Record the terminal node.
+        output_type output;
+        output.id = id;
+        output.length = (int)length;
+        output.next = node->first_output;
+        node->first_output = (int)this->outputs_.size();
+        this->outputs_.push_back(output);
         node->cnt++;
+        return true;
     }
 
-    void build_automation(const char_type * pattern, size_type length) {
-        // First step: build the trie tree.
-        build_trie(pattern, length);
+    bool add_pattern(int id, const char_type * first, const char_type * last) {
+        assert(first <= last);
+        return this->add_pattern(id, first, (size_type)(last - first));
+    }
+
+    /* Build the fail links and the output links of the automation. */
+    bool compile() {
+        node_type * root = this->root_;
+        if (unlikely(root == nullptr))
+            return false;
 
-        // Second step: build the automation.
-        node_type * root = this->root_.get();
+        this->queue_.clear();
         this->queue_.emplace_back(root);
 
         size_type head = 0;
@@ -226,7 +196,6 @@ public:
                 else {
                     if (likely(cur == root)) {
                         next->fail = root;
-                        this->queue_.emplace_back(next);
                     }
                     else {
                         node_type * node = cur->fail;
@@ -245,89 +214,60 @@ public:
                                 break;
                             }
                         } while (1);
-                        this->queue_.emplace_back(next);
                     }
+                    // The fail node is in front of the next node in BFS order,
+                    // so its output link has been built.
+                    node_type * fail = next->fail;
+                    next->output = (fail->cnt > 0) ? fail : fail->output;
+                    this->queue_.emplace_back(next);
                 }
             }
         }
+        return true;
     }
-#else
-    void build_trie(const char_type * pattern, size_type length) {
-        node_type * root = this->root_.get();
-        node_type * node = root;
-        assert(node != nullptr);
-
-        for (size_type i = 0; i < length; ++i) {
-            uchar_type ch = (uchar_type)*pattern++;
-            assert(node != nullptr);
-            if (likely(node->next[ch] == nullptr)) {
-#if USE_PLACEMENT_NEW
-                void * next_ptr = AhoCorasickImpl::memory_pool.get(AhoCorasickImpl::pool_idx);
-                node_type * next = new (next_ptr) node_type();
-                assert((void *)next == next_ptr);
-                AhoCorasickImpl::pool_idx++;
-#else
-                node_type * next = new node_type();
-#endif
-                node->next[ch] = next;
-                assert(next != nullptr);
-            }
-            node = node->next[ch];
-        }
 
-        // Record the leaf node.
-        node->cnt++;
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (likely(this->add_pattern(0, pattern, length)))
+            return this->compile();
+        else
+            return false;
     }
 
-    void build_automation(const char_type * pattern, size_type length) {
-        // First step: build the trie tree.
-        build_trie(pattern, length);
+    /* Searching all patterns, call callback(pattern_id, start, end) for every match, the range is [start, end). */
+    template <typename Callback>
+    size_type search_all(const char_type * text, size_type text_len, Callback && callback) const {
+        assert(text != nullptr);
 
-        // Second step: build the automation.
-        node_type * root = this->root_.get();
-        this->queue_.push_back(root);
+        node_type * root = this->root_;
+        if (unlikely(root == nullptr))
+            return 0;
 
-        size_type head = 0;
-        while (likely(head < this->queue_.size())) {
-            node_type * node = nullptr;
-            node_type * cur = this->queue_[head++];
-            for (size_type i = 0; i < kMaxAscii; ++i) {
-                if (likely(cur->next[i] == nullptr)) {
-                    continue;
-                }
-                else {
-                    if (likely(cur == root)) {
-                        cur->next[i]->fail = root;
-                    }
-                    else {
-                        node = cur->fail;
-                        while (likely(node != nullptr)) {
-                            if (likely(node->next[i] == nullptr)) {
-                                node = node->fail;
-                            }
-                            else {
-                                cur->next[i]->fail = node->next[i];
-                                break;
-                            }
-                        }
-                        if (likely(node == nullptr)) {
-                            cur->next[i]->fail = root;
-                        }
+        size_type matches = 0;
+        node_type * node = root;
+        for (size_type pos = 0; pos < text_len; ++pos) {
+            uchar_type ch = (uchar_type)text[pos];
+            node_type * next;
+            while (likely((next = node->next[ch]) == nullptr && node != root)) {
+                node = (node->fail != nullptr) ? node->fail : root;
+            }
+            if (likely(next != nullptr)) {
+                node = next;
+                // Report the node itself and the terminal nodes along the output links,
+                // such as "hers", "she" and "he" in "ushers".
+                const node_type * terminal = (node->cnt > 0) ? node : node->output;
+                while (unlikely(terminal != nullptr)) {
+                    for (int i = terminal->first_output; i >= 0; i = this->outputs_[i].next) {
+                        const output_type & output = this->outputs_[i];
+                        callback(output.id, pos + 1 - (size_type)output.length, pos + 1);
+                        matches++;
                     }
-                    this->queue_.push_back(cur->next[i]);
+                    terminal = terminal->output;
                 }
             }
         }
-    }
-#endif
-
-    /* Preprocessing */
-    bool preprocessing(const char_type * pattern, size_type length) {
-        bool success = false;
-        assert(pattern != nullptr);
-
-        this->build_automation(pattern, length);
-        return true;
+        return matches;
     }
 
     /* Searching */
@@ -338,7 +278,7 @@ public:
         assert(pattern != nullptr);
 
         if (likely(pattern_len <= text_len)) {
-            node_type * root = this->root_.get();
+            node_type * root = this->root_;
             node_type * node = root;
             assert(root != nullptr);
 
@@ -369,15 +309,14 @@ public:
                         // Matched one char
                         assert(next != nullptr);
                         node = next;
-                        if (likely(node->cnt <= 0)) {
-                            // Isn't a leaf node.
-                            text++;
+                        text++;
+                        if (likely(node->cnt <= 0 && node->output == nullptr)) {
+                            // Isn't a terminal node.
                             break;
                         }
                         else {
                             // Has found
-                            text++;
-                            return (Long)(text - text_start - pattern_len);
+                            return (Long)(text - text_start) - this->match_length(node);
                         }
                     }
                 } while (1);
@@ -387,6 +326,86 @@ public:
         return Status::NotFound;
     }
 
+    struct cursor_type {
+        size_type pos;          // The next char of text to be scanned.
+        node_type * node;       // The current state of automation, nullptr is root.
+        size_type length;       // The length of the last match.
+
+        cursor_type() : pos(0), node(nullptr), length(0) {}
+    };
+
+    /* Searching the next match in a stream, the cursor keeps all of the state
+       between the chunks, set cursor.pos to 0 for every new chunk. Return the
+       end of the match in this chunk, the match may start in the chunks before. */
+    SM_NOINLINE_DECLARE(Long)
+    search_stream(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len,
+                cursor_type & cursor, MatchMode::Type mode) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        assert(pattern_len != 0);
+
+        node_type * root = this->root_;
+        node_type * node = (cursor.node != nullptr) ? cursor.node : root;
+        assert(root != nullptr);
+
+        const char_type * text_start = text;
+        const char_type * text_end = text + text_len;
+        text += cursor.pos;
+        while (likely(text < text_end)) {
+            uchar_type ch = (uchar_type)*text;
+            do {
+                node_type * next = node->next[ch];
+                if (likely(next == nullptr)) {
+                    // Dismatch
+                    if (likely(node == root)) {
+                        text++;
+                        break;
+                    }
+                    else {
+                        if (likely(node->fail != nullptr)) {
+                            node = node->fail;
+                        }
+                        else {
+                            node = root;
+                            text++;
+                            break;
+                        }
+                    }
+                }
+                else {
+                    // Matched one char
+                    assert(next != nullptr);
+                    node = next;
+                    text++;
+                    if (unlikely(node->cnt > 0 || node->output != nullptr)) {
+                        // Has found, the non-overlapping match restarts from root.
+                        cursor.pos = (size_type)(text - text_start);
+                        cursor.node = (mode == MatchMode::Overlapping) ? node : root;
+                        cursor.length = (size_type)this->match_length(node);
+                        return (Long)(text - text_start);
+                    }
+                    break;
+                }
+            } while (1);
+        }
+
+        cursor.pos = text_len;
+        cursor.node = node;
+        return Status::NotFound;
+    }
+
+    /* Searching the next match, continue from the cursor. */
+    Long search_next(const char_type * text, size_type text_len,
+                     const char_type * pattern, size_type pattern_len,
+                     cursor_type & cursor, MatchMode::Type mode) const {
+        Long match_end = this->search_stream(text, text_len, pattern, pattern_len, cursor, mode);
+        if (likely(match_end >= 0))
+            return (match_end - (Long)cursor.length);
+        else
+            return Status::NotFound;
+    }
+
     /* Searching */
     SM_NOINLINE_DECLARE(Long)
     search2(const char_type * text, size_type text_len,
@@ -395,7 +414,7 @@ public:
         assert(pattern != nullptr);
 
         if (likely(pattern_len <= text_len)) {
-            ACNode * root = this->root_.get();
+            ACNode * root = this->root_;
             ACNode * node = root;
             assert(root != nullptr);
 
@@ -418,13 +437,13 @@ public:
                     text++;
                 }
                 else {
-                    if (likely(node->cnt <= 0)) {
+                    if (likely(node->cnt <= 0 && node->output == nullptr)) {
                         text++;
                     }
                     else {
                         // Has found
                         text++;
-                        return (Long)(text - text_start - pattern_len);
+                        return (Long)(text - text_start) - this->match_length(node);
                     }
                 }
             }
@@ -434,14 +453,6 @@ public:
     }
 };
 
-template <typename T>
-MemoryPool AhoCorasickImpl<T>::memory_pool;
-
-template <typename T>
-int AhoCorasickImpl<T>::pool_idx = 0;
-
 } // namespace StringMatch
 
-#undef USE_PLACEMENT_NEW
-
 #endif // STRING_MATCH_AHO_CORASICK_H
@@ -19,6 +19,7 @@
 #include <algorithm>
 
 #include "StringMatch.h"
+#include "jstd/char_traits.h"
 #include "jstd/scoped_ptr.h"
 
 namespace StringMatch {
@@ -144,6 +145,44 @@ public:
     }
 };
 
+//
+// The index of a char in the bad character tables of 256 entries (kMaxAscii).
+//
+// A 8 bits char is the index itself, the wider code units (UTF-16, UTF-32) are
+// folded into 8 bits, so the tables of the wide chars never overflow and are
+// still 256 entries. The chars of the same index share one entry, it keeps the
+// shift of the last one in the pattern (the smallest shift), so a shift is
+// never too long, a collision only shortens it.
+//
+template <typename CharTy, std::size_t CharSize = sizeof(CharTy)>
+struct BadCharHash {
+    typedef typename jstd::uchar_traits<CharTy>::type uchar_type;
+
+    static std::size_t index(CharTy ch) {
+        return (std::size_t)(uchar_type)ch;
+    }
+};
+
+template <typename CharTy>
+struct BadCharHash<CharTy, 2> {
+    typedef typename jstd::uchar_traits<CharTy>::type uchar_type;
+
+    static std::size_t index(CharTy ch) {
+        uint32_t code = (uint32_t)(uchar_type)ch;
+        return (std::size_t)((code ^ (code >> 8)) & 0xFFU);
+    }
+};
+
+template <typename CharTy>
+struct BadCharHash<CharTy, 4> {
+    typedef typename jstd::uchar_traits<CharTy>::type uchar_type;
+
+    static std::size_t index(CharTy ch) {
+        uint32_t code = (uint32_t)(uchar_type)ch;
+        return (std::size_t)((code ^ (code >> 8) ^ (code >> 16) ^ (code >> 24)) & 0xFFU);
+    }
+};
+
 } // namespace StringMatch
 
 #endif // STRING_MATCH_ALGORITHM_UTILS_H
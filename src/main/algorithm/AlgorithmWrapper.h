@@ -17,6 +17,7 @@
 #include <cstddef>
 #include <string>
 #include <memory>
+#include <iterator>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -24,6 +25,7 @@
 #include "StringMatch.h"
 #include "jstd/char_traits.h"
 #include "support/StringRef.h"
+#include "algorithm/SearchStats.h"
 #include "algorithm/AhoCorasick.h"
 
 namespace StringMatch {
@@ -64,25 +66,103 @@ struct AlgorithmCounter {
     }
 };
 
-template <>
-struct AlgorithmCounter<AhoCorasickImpl<char>> {
-    static void reset_counter() {
-        AhoCorasickImpl<char>::reset_counter();
-    }
+//
+// Whether the algorithm can resume the scanning from its internal state,
+// it provides: cursor_type and search_next(text, text_len, pattern, pattern_len, cursor, mode).
+//
+template <typename AlgorithmImpl>
+struct has_match_cursor {
+    template <typename T>
+    static char test(typename T::cursor_type *);
 
-    static int get_counter() {
-        return AhoCorasickImpl<char>::get_counter();
-    }
+    template <typename T>
+    static long test(...);
+
+    static const bool value = (sizeof(test<AlgorithmImpl>(nullptr)) == sizeof(char));
 };
 
-template <>
-struct AlgorithmCounter<AhoCorasickImpl<wchar_t>> {
-    static void reset_counter() {
-        AhoCorasickImpl<wchar_t>::reset_counter();
+//
+// Whether the cursor of the algorithm keeps all of the state and never looks back
+// to the text before cursor.pos, so it can be carried from one chunk of a stream
+// to the next, it provides: search_stream(text, text_len, pattern, pattern_len, cursor, mode).
+//
+template <typename AlgorithmImpl>
+struct has_stream_search {
+    template <typename T>
+    static char test(decltype(&T::search_stream));
+
+    template <typename T>
+    static long test(...);
+
+    static const bool value = (sizeof(test<AlgorithmImpl>(nullptr)) == sizeof(char));
+};
+
+//
+// Whether the algorithm searches by the strstr() family, it ignores text_len and
+// reads until the null terminator, it declares: static const bool kNullTerminated.
+//
+template <typename AlgorithmImpl>
+struct need_null_terminated {
+    template <typename T>
+    static char test(decltype(&T::kNullTerminated));
+
+    template <typename T>
+    static long test(...);
+
+    static const bool value = (sizeof(test<AlgorithmImpl>(nullptr)) == sizeof(char));
+};
+
+//
+// The cursor of the matches of the algorithms haven't search_next(),
+// restart search() behind the last match.
+//
+template <typename AlgorithmImpl, bool HasCursor = has_match_cursor<AlgorithmImpl>::value>
+struct MatchCursor {
+    typedef typename AlgorithmImpl::char_type   char_type;
+    typedef typename AlgorithmImpl::size_type   size_type;
+
+    size_type pos;
+
+    MatchCursor() : pos(0) {}
+
+    Long next(const AlgorithmImpl & algorithm,
+              const char_type * text, size_type text_len,
+              const char_type * pattern, size_type pattern_len,
+              MatchMode::Type mode) {
+        assert(pattern_len != 0);
+        if (likely(this->pos < text_len)) {
+            Long index_of = algorithm.search(text + this->pos, text_len - this->pos,
+                                             pattern, pattern_len);
+            if (likely(index_of >= 0)) {
+                index_of += (Long)this->pos;
+                this->pos = (size_type)index_of + ((mode == MatchMode::Overlapping) ? 1 : pattern_len);
+                return index_of;
+            }
+            this->pos = text_len;
+        }
+        return Status::NotFound;
     }
+};
 
-    static int get_counter() {
-        return AhoCorasickImpl<wchar_t>::get_counter();
+//
+// The cursor of the matches of the algorithms have search_next(),
+// continue scanning from the internal state (the shift, the border, etc.).
+//
+template <typename AlgorithmImpl>
+struct MatchCursor<AlgorithmImpl, true> {
+    typedef typename AlgorithmImpl::char_type   char_type;
+    typedef typename AlgorithmImpl::size_type   size_type;
+
+    typename AlgorithmImpl::cursor_type cursor;
+
+    MatchCursor() : cursor() {}
+
+    Long next(const AlgorithmImpl & algorithm,
+              const char_type * text, size_type text_len,
+              const char_type * pattern, size_type pattern_len,
+              MatchMode::Type mode) {
+        assert(pattern_len != 0);
+        return algorithm.search_next(text, text_len, pattern, pattern_len, this->cursor, mode);
     }
 };
 
@@ -95,12 +175,24 @@ struct AlgorithmWrapper {
     typedef typename algorithm_type::size_type  size_type;
     typedef std::basic_string<char_type>        string_type;
     typedef BasicStringRef<char_type>           stringref_type;
+    typedef MatchCursor<algorithm_type>         cursor_type;
 
     class Matcher;
-
+    class MatchIterator;
+    class MatchRange;
+
+    //
+    // A compiled pattern owns a copy of the pattern string, and the algorithm's
+    // search() is const and has no side effect, so after preprocessing() one
+    // Pattern can be shared by many threads without any lock.
+    //
     class Pattern {
+    public:
+        typedef AlgorithmWrapper<AlgorithmTy>   wrapper_type;
+
     private:
-        stringref_type pattern_;
+        stringref_type pattern_;    // Always reference to storage_.
+        string_type storage_;
         algorithm_type algorithm_;
         bool compiled_;
 
@@ -109,33 +201,56 @@ struct AlgorithmWrapper {
             // Do nothing!
         }
         Pattern(const char_type * pattern)
-            : pattern_(pattern), compiled_(false) {
+            : pattern_(), compiled_(false) {
             this->compiled_ = this->preprocessing(pattern);
         }
         Pattern(const char_type * pattern, size_type length)
-            : pattern_(pattern, length), compiled_(false) {
+            : pattern_(), compiled_(false) {
             this->compiled_ = this->preprocessing(pattern, length);
         }
         Pattern(const char_type * first, const char_type * last)
-            : pattern_(first, last), compiled_(false) {
+            : pattern_(), compiled_(false) {
             this->compiled_ = this->preprocessing(first, last);
         }
         template <size_t N>
         Pattern(const char_type (&pattern)[N])
-            : pattern_(pattern, N - 1), compiled_(false) {
+            : pattern_(), compiled_(false) {
             this->compiled_ = this->preprocessing(pattern, N - 1);
         }
         Pattern(const string_type & pattern)
-            : pattern_(pattern), compiled_(false) {
+            : pattern_(), compiled_(false) {
             this->compiled_ = this->preprocessing(pattern);
         }
         Pattern(const stringref_type & pattern)
-            : pattern_(pattern), compiled_(false) {
+            : pattern_(), compiled_(false) {
             this->compiled_ = this->preprocessing(pattern);
         }
+        // Only for the case-insensitive algorithms, see: algorithm/NoCaseStrStr.h
+        Pattern(const char_type * pattern, size_type length, CaseFold::Type fold)
+            : pattern_(), compiled_(false) {
+            this->compiled_ = this->preprocessing(pattern, length, fold);
+        }
+        Pattern(const string_type & pattern, CaseFold::Type fold)
+            : pattern_(), compiled_(false) {
+            this->compiled_ = this->preprocessing(pattern.c_str(), pattern.size(), fold);
+        }
         Pattern(const Pattern & src)
-            : pattern_(src.pattern_), algorithm_(src.algorithm_),
+            : pattern_(), storage_(src.storage_), algorithm_(src.algorithm_),
               compiled_(src.compiled_) {
+            if (src.is_valid())
+                this->pattern_.set_data(this->storage_.c_str(), this->storage_.size());
+        }
+        Pattern & operator = (const Pattern & rhs) {
+            if (&rhs != this) {
+                this->storage_ = rhs.storage_;
+                this->algorithm_ = rhs.algorithm_;
+                this->compiled_ = rhs.compiled_;
+                if (rhs.is_valid())
+                    this->pattern_.set_data(this->storage_.c_str(), this->storage_.size());
+                else
+                    this->pattern_.reset();
+            }
+            return *this;
         }
         ~Pattern() {
             this->destroy();
@@ -153,6 +268,8 @@ struct AlgorithmWrapper {
         bool has_compiled() const { return (this->need_preprocessing() ? this->compiled_ : true); }
         bool need_preprocessing() const { return this->algorithm_.need_preprocessing(); }
 
+        const algorithm_type & algorithm() const { return this->algorithm_; }
+
         // Pattern::preprocessing()
         bool preprocessing(const char_type * pattern, size_type length) {
             assert(pattern != nullptr);
@@ -183,6 +300,13 @@ struct AlgorithmWrapper {
             return this->preprocessing(pattern.c_str(), pattern.size());
         }
 
+        // Pattern::preprocessing(pattern, length, fold);
+        // Only for the case-insensitive algorithms, the other ones have no set_case_fold().
+        bool preprocessing(const char_type * pattern, size_type length, CaseFold::Type fold) {
+            this->algorithm_.set_case_fold(fold);
+            return this->preprocessing(pattern, length);
+        }
+
         // Pattern::match(text, length);
         Long match(const char_type * text, size_type length) const {
             assert(text != nullptr);
@@ -214,6 +338,98 @@ struct AlgorithmWrapper {
         // Pattern::match(matcher);
         Long match(const Matcher & matcher) const;
 
+        // Pattern::match_next(text, length, cursor, mode);
+        // Return the next match behind the cursor, an empty pattern has no match.
+        Long match_next(const char_type * text, size_type length, cursor_type & cursor,
+                        MatchMode::Type mode = MatchMode::Overlapping) const {
+            assert(text != nullptr);
+            if (likely(this->size() != 0))
+                return cursor.next(this->algorithm_, text, length, this->c_str(), this->size(), mode);
+            else
+                return Status::NotFound;
+        }
+
+        // Pattern::match_all(text, length, visitor, mode);
+        // Call visitor(index_of) for every match, return the numbers of matches.
+        template <typename Visitor>
+        size_type match_all(const char_type * text, size_type length, Visitor && visitor,
+                            MatchMode::Type mode = MatchMode::Overlapping) const {
+            size_type matches = 0;
+            cursor_type cursor;
+            Long index_of;
+            while ((index_of = this->match_next(text, length, cursor, mode)) >= 0) {
+                visitor(index_of);
+                matches++;
+            }
+            return matches;
+        }
+
+        template <typename Visitor>
+        size_type match_all(const char_type * text, Visitor && visitor,
+                            MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->match_all(text, detail::strlen(text), visitor, mode);
+        }
+
+        template <typename Visitor>
+        size_type match_all(const string_type & text, Visitor && visitor,
+                            MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->match_all(text.c_str(), text.size(), visitor, mode);
+        }
+
+        template <typename Visitor>
+        size_type match_all(const stringref_type & text, Visitor && visitor,
+                            MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->match_all(text.c_str(), text.size(), visitor, mode);
+        }
+
+        // Pattern::count(text, length, mode);
+        size_type count(const char_type * text, size_type length,
+                        MatchMode::Type mode = MatchMode::Overlapping) const {
+            size_type matches = 0;
+            cursor_type cursor;
+            while (this->match_next(text, length, cursor, mode) >= 0) {
+                matches++;
+            }
+            return matches;
+        }
+
+        size_type count(const char_type * text,
+                        MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->count(text, detail::strlen(text), mode);
+        }
+
+        size_type count(const string_type & text,
+                        MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->count(text.c_str(), text.size(), mode);
+        }
+
+        size_type count(const stringref_type & text,
+                        MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->count(text.c_str(), text.size(), mode);
+        }
+
+        // Pattern::matches(text, length, mode);
+        // Usage: for (Long index_of : pattern.matches(text, length)) { ... }
+        MatchRange matches(const char_type * text, size_type length,
+                           MatchMode::Type mode = MatchMode::Overlapping) const {
+            return MatchRange(this, text, length, mode);
+        }
+
+        MatchRange matches(const char_type * text,
+                           MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->matches(text, detail::strlen(text), mode);
+        }
+
+        MatchRange matches(const string_type & text,
+                           MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->matches(text.c_str(), text.size(), mode);
+        }
+
+        MatchRange matches(const stringref_type & text,
+                           MatchMode::Type mode = MatchMode::Overlapping) const {
+            return this->matches(text.c_str(), text.size(), mode);
+        }
+
         // Pattern::print_result()
         void print_result(const Matcher & matcher, int index_of) {
             Console::print_result(matcher.c_str(), matcher.size(),
@@ -229,15 +445,96 @@ struct AlgorithmWrapper {
     private:
         void destroy() {
             this->pattern_.reset();
+            this->storage_.clear();
             this->algorithm_.destroy();
         }
 
         bool preprocessing_impl(const char_type * pattern, size_type length) {
-            this->pattern_.set_data(pattern, length);
-            return this->algorithm_.preprocessing(pattern, length);
+            // The caller's buffer may be freed or reused after compiled, use our own copy.
+            this->storage_.assign(pattern, length);
+            this->pattern_.set_data(this->storage_.c_str(), length);
+            return this->algorithm_.preprocessing(this->storage_.c_str(), length);
         }
     }; // class Pattern
 
+    // An input iterator over the positions of the matches.
+    class MatchIterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef Long                    value_type;
+        typedef std::ptrdiff_t          difference_type;
+        typedef const Long *            pointer;
+        typedef const Long &            reference;
+
+    private:
+        const Pattern * pattern_;
+        const char_type * text_;
+        size_type length_;
+        MatchMode::Type mode_;
+        cursor_type cursor_;
+        Long index_of_;
+
+    public:
+        // The end iterator.
+        MatchIterator()
+            : pattern_(nullptr), text_(nullptr), length_(0),
+              mode_(MatchMode::Overlapping), cursor_(), index_of_(Status::NotFound) {
+        }
+        MatchIterator(const Pattern * pattern, const char_type * text, size_type length,
+                      MatchMode::Type mode)
+            : pattern_(pattern), text_(text), length_(length),
+              mode_(mode), cursor_(), index_of_(Status::NotFound) {
+            assert(pattern != nullptr);
+            this->index_of_ = pattern->match_next(text, length, this->cursor_, mode);
+        }
+
+        reference operator * () const { return this->index_of_; }
+        pointer operator -> () const { return &this->index_of_; }
+
+        MatchIterator & operator ++ () {
+            assert(this->index_of_ >= 0);
+            this->index_of_ = this->pattern_->match_next(this->text_, this->length_,
+                                                         this->cursor_, this->mode_);
+            return *this;
+        }
+
+        MatchIterator operator ++ (int) {
+            MatchIterator copy(*this);
+            ++(*this);
+            return copy;
+        }
+
+        bool operator == (const MatchIterator & rhs) const {
+            return (this->index_of_ == rhs.index_of_);
+        }
+
+        bool operator != (const MatchIterator & rhs) const {
+            return (this->index_of_ != rhs.index_of_);
+        }
+    }; // class MatchIterator
+
+    class MatchRange {
+    private:
+        const Pattern * pattern_;
+        const char_type * text_;
+        size_type length_;
+        MatchMode::Type mode_;
+
+    public:
+        MatchRange(const Pattern * pattern, const char_type * text, size_type length,
+                   MatchMode::Type mode)
+            : pattern_(pattern), text_(text), length_(length), mode_(mode) {
+        }
+
+        MatchIterator begin() const {
+            return MatchIterator(this->pattern_, this->text_, this->length_, this->mode_);
+        }
+
+        MatchIterator end() const {
+            return MatchIterator();
+        }
+    }; // class MatchRange
+
     class Matcher {
     private:
         stringref_type text_;
@@ -311,8 +608,10 @@ struct AlgorithmWrapper {
         // Matcher::find(text, length, pattern, pattern_len);
         static Long find(const char_type * text, size_type length,
                         const char_type * pattern, size_type pattern_len) {
-            Pattern _pattern(pattern, pattern_len);
-            return _pattern.match(text, length);
+            // One-shot search, don't need to copy the pattern.
+            algorithm_type algorithm;
+            algorithm.preprocessing(pattern, pattern_len);
+            return algorithm.search(text, length, pattern, pattern_len);
         }
 
         // Matcher::find(pattern);
@@ -378,6 +677,15 @@ struct AlgorithmWrapper {
         return AlgorithmCounter<algorithm_type>::get_counter();
     }
 
+    // The search statistics of the calling thread, all zeros if STRING_MATCH_ENABLE_STATS is 0.
+    static SearchStats stats() {
+        return SearchStatsOf<algorithm_type>::get();
+    }
+
+    static void reset_stats() {
+        SearchStatsOf<algorithm_type>::get().reset();
+    }
+
     // AlgorithmWrapper::match(matcher, pattern)
     static Long match(const Matcher & matcher, const Pattern & pattern) {
         return pattern.match(matcher.c_str(), matcher.size());
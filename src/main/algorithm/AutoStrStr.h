@@ -0,0 +1,388 @@
+
+#ifndef STRING_MATCH_AUTO_STRSTR_H
+#define STRING_MATCH_AUTO_STRSTR_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <wchar.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/MemMem.h"
+#include "algorithm/SSEStrStr.h"
+#include "algorithm/AvxStrStr.h"
+#include "algorithm/Avx512StrStr.h"
+#include "asm/asmlib.h"
+
+//
+// AutoStrStr: runtime CPU dispatching.
+//
+// The instruction set is detected once by InstructionSet() (asm/instrset_xxx.asm),
+// and the best available kernel is bound to a function pointer table at the
+// first call. After that, every call is only an indirect call through the table,
+// there is no per-call feature check.
+//
+// Together with the STRING_MATCH_DISPATCH_BUILD mode in CMakeLists.txt (each
+// kernel is compiled with its own SM_TARGET_XXX attributes instead of the global
+// -m flags), one binary runs on every x86 host at its full speed.
+//
+
+#if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
+ || defined(__amd64__) || defined(__x86_64__) \
+ || defined(WIN32) || defined(_WIN32) || defined(_M_IX86) || defined(__i386__)
+#define STRING_MATCH_HAVE_ASMLIB    1
+#endif
+
+namespace StringMatch {
+
+struct CpuInstrSet {
+    // The return values of InstructionSet(), see: asm/instrset_x64.asm
+    enum Level {
+        kBaseline = 0,
+        kSSE2 = 4,
+        kSSSE3 = 6,
+        kSSE4_2 = 10,
+        kAVX2 = 13,
+        kAVX512F = 15,
+        kAVX512BW = 16
+    };
+
+    // InstructionSet() caches its result, it's cheap to be called again.
+    static int level() {
+#if STRING_MATCH_HAVE_ASMLIB
+        return ::InstructionSet();
+#else
+        return kBaseline;
+#endif
+    }
+
+    static bool has_ssse3() { return (level() >= kSSSE3); }
+    static bool has_sse42() { return (level() >= kSSE4_2); }
+    static bool has_avx2() { return (level() >= kAVX2); }
+    static bool has_avx512bw() { return (level() >= kAVX512BW); }
+};
+
+namespace detail {
+
+static inline
+const char * strstr_scalar(const char * text, const char * pattern) {
+    return ::strstr(text, pattern);
+}
+
+static inline
+const wchar_t * strstr_scalar(const wchar_t * text, const wchar_t * pattern) {
+    return ::wcsstr(text, pattern);
+}
+
+// char16_t and char32_t have no strstr() in the C library.
+template <typename char_type>
+static inline
+const char_type * strstr_generic(const char_type * text, const char_type * pattern) {
+    typedef std::char_traits<char_type> traits_type;
+    const char_type * text_end = text + traits_type::length(text);
+    const char_type * pattern_end = pattern + traits_type::length(pattern);
+    const char_type * substr = std::search(text, text_end, pattern, pattern_end);
+    if (likely(substr != text_end || pattern == pattern_end))
+        return substr;
+    else
+        return nullptr;
+}
+
+static inline
+const char16_t * strstr_scalar(const char16_t * text, const char16_t * pattern) {
+    return strstr_generic(text, pattern);
+}
+
+static inline
+const char32_t * strstr_scalar(const char32_t * text, const char32_t * pattern) {
+    return strstr_generic(text, pattern);
+}
+
+// The SSE 4.2 kernels only support the 8 bits and 16 bits chars (see SSEHelper),
+// the 32 bits chars use the scalar version, and the kernels are not instantiated.
+template <typename char_type>
+static inline
+const char_type * strstr_sse42_of_size(const char_type * text, const char_type * pattern,
+                                       std::true_type /* is_16_bits */) {
+    return strstr_sse42_v1c(text, pattern);
+}
+
+template <typename char_type>
+static inline
+const char_type * strstr_sse42_of_size(const char_type * text, const char_type * pattern,
+                                       std::false_type /* is_16_bits */) {
+    return strstr_scalar(text, pattern);
+}
+
+static inline
+const char * strstr_sse42_best(const char * text, const char * pattern) {
+#if STRING_MATCH_HAVE_ASMLIB
+    return A_strstr(text, pattern);
+#else
+    return strstr_sse42_v1c(text, pattern);
+#endif
+}
+
+static inline
+const wchar_t * strstr_sse42_best(const wchar_t * text, const wchar_t * pattern) {
+    return strstr_sse42_of_size(text, pattern, std::integral_constant<bool, (sizeof(wchar_t) == 2)>());
+}
+
+static inline
+const char16_t * strstr_sse42_best(const char16_t * text, const char16_t * pattern) {
+    return strstr_sse42_v1c(text, pattern);
+}
+
+static inline
+const char32_t * strstr_sse42_best(const char32_t * text, const char32_t * pattern) {
+    return strstr_scalar(text, pattern);
+}
+
+template <typename char_type>
+static inline
+const char_type * memmem_scalar(const char_type * text, size_t text_len,
+                                const char_type * pattern, size_t pattern_len) {
+    if (sizeof(char_type) == 1) {
+        return (const char_type *)memmem((const void *)text, text_len,
+                                         (const void *)pattern, pattern_len);
+    }
+    else {
+        const char_type * text_end = text + text_len;
+        const char_type * substr = std::search(text, text_end, pattern, pattern + pattern_len);
+        if (likely(substr != text_end || pattern_len == 0))
+            return substr;
+        else
+            return nullptr;
+    }
+}
+
+template <typename char_type>
+static inline
+const char_type * memmem_sse42_of_size(const char_type * text, size_t text_len,
+                                       const char_type * pattern, size_t pattern_len,
+                                       std::true_type /* is_16_bits */) {
+    return memmem_sse42(text, text_len, pattern, pattern_len);
+}
+
+template <typename char_type>
+static inline
+const char_type * memmem_sse42_of_size(const char_type * text, size_t text_len,
+                                       const char_type * pattern, size_t pattern_len,
+                                       std::false_type /* is_16_bits */) {
+    return memmem_scalar(text, text_len, pattern, pattern_len);
+}
+
+// The 8 bits chars use memmem() of the C library, the 16 bits chars use
+// memmem_sse42() (pcmpestri), and the 32 bits chars use std::search().
+template <typename char_type>
+static inline
+const char_type * memmem_sse42_best(const char_type * text, size_t text_len,
+                                    const char_type * pattern, size_t pattern_len) {
+    return memmem_sse42_of_size(text, text_len, pattern, pattern_len,
+                                std::integral_constant<bool, (sizeof(char_type) == 2)>());
+}
+
+} // namespace detail
+
+template <typename CharTy>
+class AutoStrStrDispatcher {
+public:
+    typedef AutoStrStrDispatcher<CharTy>    this_type;
+    typedef CharTy                          char_type;
+
+    typedef const char_type * (*memmem_func_t)(const char_type * text, size_t text_len,
+                                               const char_type * pattern, size_t pattern_len);
+    typedef const char_type * (*strstr_func_t)(const char_type * text, const char_type * pattern);
+
+    struct Kernel {
+        memmem_func_t   memmem;
+        strstr_func_t   strstr;
+        const char *    name;
+    };
+
+private:
+    static const Kernel kResolver;
+    static const Kernel kAVX512BW;
+    static const Kernel kAVX2;
+    static const Kernel kSSE42;
+    static const Kernel kScalar;
+
+    static std::atomic<const Kernel *> kernel_;
+
+    static const Kernel * select(int level) {
+#if STRING_MATCH_HAVE_AVX512BW
+        if (level >= CpuInstrSet::kAVX512BW)
+            return &kAVX512BW;
+#endif
+        if (level >= CpuInstrSet::kAVX2)
+            return &kAVX2;
+        else if (level >= CpuInstrSet::kSSE4_2)
+            return &kSSE42;
+        else
+            return &kScalar;
+    }
+
+    static const Kernel * resolve() {
+        const Kernel * kernel = this_type::select(CpuInstrSet::level());
+        // All threads would store the same value, so it's no matter who wins.
+        this_type::kernel_.store(kernel, std::memory_order_relaxed);
+        return kernel;
+    }
+
+    static const char_type * resolve_memmem(const char_type * text, size_t text_len,
+                                            const char_type * pattern, size_t pattern_len) {
+        return this_type::resolve()->memmem(text, text_len, pattern, pattern_len);
+    }
+
+    static const char_type * resolve_strstr(const char_type * text, const char_type * pattern) {
+        return this_type::resolve()->strstr(text, pattern);
+    }
+
+public:
+    // The kernel of this host, resolve it if it has not been done yet.
+    static const Kernel * current() {
+        const Kernel * kernel = this_type::kernel_.load(std::memory_order_relaxed);
+        if (kernel == &kResolver)
+            kernel = this_type::resolve();
+        return kernel;
+    }
+
+    static const char * name() {
+        return this_type::current()->name;
+    }
+
+    // Length bounded: honours text_len and pattern_len, the text may contain '\0'.
+    static const char_type * memmem(const char_type * text, size_t text_len,
+                                    const char_type * pattern, size_t pattern_len) {
+        return this_type::kernel_.load(std::memory_order_relaxed)->memmem(text, text_len,
+                                                                          pattern, pattern_len);
+    }
+
+    // Null-terminated.
+    static const char_type * strstr(const char_type * text, const char_type * pattern) {
+        return this_type::kernel_.load(std::memory_order_relaxed)->strstr(text, pattern);
+    }
+};
+
+template <typename CharTy>
+const typename AutoStrStrDispatcher<CharTy>::Kernel
+AutoStrStrDispatcher<CharTy>::kResolver = {
+    &AutoStrStrDispatcher<CharTy>::resolve_memmem,
+    &AutoStrStrDispatcher<CharTy>::resolve_strstr,
+    "unresolved"
+};
+
+template <typename CharTy>
+const typename AutoStrStrDispatcher<CharTy>::Kernel
+AutoStrStrDispatcher<CharTy>::kAVX512BW = {
+#if STRING_MATCH_HAVE_AVX512BW
+    &avx512_memmem<CharTy>,
+#else
+    &avx2_memmem<CharTy>,
+#endif
+    &detail::strstr_sse42_best,
+    "AVX-512BW"
+};
+
+template <typename CharTy>
+const typename AutoStrStrDispatcher<CharTy>::Kernel
+AutoStrStrDispatcher<CharTy>::kAVX2 = {
+    &avx2_memmem<CharTy>,
+    &detail::strstr_sse42_best,
+    "AVX2"
+};
+
+template <typename CharTy>
+const typename AutoStrStrDispatcher<CharTy>::Kernel
+AutoStrStrDispatcher<CharTy>::kSSE42 = {
+    &detail::memmem_sse42_best<CharTy>,
+    &detail::strstr_sse42_best,
+    "SSE 4.2"
+};
+
+template <typename CharTy>
+const typename AutoStrStrDispatcher<CharTy>::Kernel
+AutoStrStrDispatcher<CharTy>::kScalar = {
+    &detail::memmem_scalar<CharTy>,
+    &detail::strstr_scalar,
+    "Scalar"
+};
+
+template <typename CharTy>
+std::atomic<const typename AutoStrStrDispatcher<CharTy>::Kernel *>
+AutoStrStrDispatcher<CharTy>::kernel_(&AutoStrStrDispatcher<CharTy>::kResolver);
+
+template <typename CharTy>
+class AutoStrStrImpl {
+public:
+    typedef AutoStrStrImpl<CharTy>          this_type;
+    typedef CharTy                          char_type;
+    typedef std::size_t                     size_type;
+    typedef AutoStrStrDispatcher<CharTy>    dispatcher_type;
+
+    AutoStrStrImpl() {}
+    ~AutoStrStrImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "auto_memmem()"; }
+    static bool need_preprocessing() { return false; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        /* Don't need to do preprocessing. */
+        SM_UNUSED_VAR(pattern);
+        SM_UNUSED_VAR(length);
+        return true;
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        const char_type * substr = dispatcher_type::memmem(text, text_len, pattern, pattern_len);
+        if (likely(substr != nullptr))
+            return (Long)(substr - text);
+        else
+            return Status::NotFound;
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< AutoStrStrImpl<char> >    AutoStrStr;
+}
+
+namespace UnicodeString {
+    typedef AlgorithmWrapper< AutoStrStrImpl<wchar_t> > AutoStrStr;
+}
+
+namespace Utf16String {
+    typedef AlgorithmWrapper< AutoStrStrImpl<char16_t> >    AutoStrStr;
+}
+
+namespace Utf32String {
+    typedef AlgorithmWrapper< AutoStrStrImpl<char32_t> >    AutoStrStr;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_AUTO_STRSTR_H
@@ -0,0 +1,387 @@
+
+#ifndef STRING_MATCH_AUTO_TUNE_H
+#define STRING_MATCH_AUTO_TUNE_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AutoStrStr.h"
+#include "algorithm/MemMem.h"
+#include "algorithm/Horspool.h"
+#include "algorithm/ShiftOr.h"
+#include "algorithm/TwoWay.h"
+
+//
+// AutoTune: measure the engines on the live searches and lock in the fastest.
+//
+// The first searches of a compiled pattern are the trial: they run the candidate
+// engines in turn (trial_rounds searches per candidate) and time them by
+// steady_clock. The last search of the trial pins the engine of the lowest
+// nanoseconds per scanned byte, by storing its search function to an atomic
+// function pointer, so a pinned search is only an indirect call plus a counter.
+//
+// Every check_interval searches the pinned engine reads the clock, and after
+// retune_seconds a new trial is started, so the choice follows the changes of
+// the texts. retune() starts one at once.
+//
+// The candidates are the SIMD dispatcher of AutoStrStr, glibc memmem(), Horspool,
+// Two-Way and ShiftOr (x64, the patterns of at most 64 chars). All of them return
+// the first match, so the engine never changes the results, only the speed.
+//
+// The tuning state is atomic and relaxed: a Pattern is still shared by many
+// threads without any lock, the races only add some noise to the timings.
+// The factorization of Two-Way compares bytes, so only AnsiString is provided.
+//
+
+namespace StringMatch {
+
+struct AutoTuneEngine {
+    enum Type {
+        Simd,
+        MemMem,
+        Horspool,
+        TwoWay,
+        ShiftOr,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Simd:      return "simd";
+            case MemMem:    return "memmem";
+            case Horspool:  return "horspool";
+            case TwoWay:    return "two-way";
+            case ShiftOr:   return "shift-or";
+            default:        return "unknown";
+        }
+    }
+};
+
+struct AutoTuneOptions {
+    std::size_t trial_rounds;       // The timed searches per candidate.
+    std::size_t check_interval;     // The pinned searches between two reads of the clock.
+    double retune_seconds;          // Start a new trial after it, 0 for never.
+
+    AutoTuneOptions() : trial_rounds(8), check_interval(4096), retune_seconds(60.0) {}
+
+    static AutoTuneOptions & global() {
+        static AutoTuneOptions options;
+        return options;
+    }
+
+    // Not thread safe, call it at startup, before any pattern is compiled.
+    static void set_global(const AutoTuneOptions & options) {
+        AutoTuneOptions::global() = options;
+    }
+};
+
+template <typename CharTy>
+class AutoTuneImpl {
+public:
+    typedef AutoTuneImpl<CharTy>    this_type;
+    typedef CharTy                  char_type;
+    typedef std::size_t             size_type;
+    typedef std::chrono::steady_clock
+                                    clock_type;
+
+    typedef Long (*search_func_t)(const this_type * self,
+                                  const char_type * text, size_type text_len,
+                                  const char_type * pattern, size_type pattern_len);
+
+private:
+    AutoStrStrImpl<CharTy>  simd_;
+    MemMemImpl<CharTy>      mem_mem_;
+    HorspoolImpl<CharTy>    horspool_;
+    TwoWayImpl<CharTy>      two_way_;
+#if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
+ || defined(_M_IA64) || defined(_M_ARM64) || defined(__amd64__) || defined(__x86_64__)
+    ShiftOrImpl<CharTy, uint64_t>
+                            shift_or_;
+#endif
+
+    AutoTuneEngine::Type candidates_[AutoTuneEngine::Last];
+    size_type num_candidates_;
+    uint64_t trial_searches_;
+    uint64_t check_interval_;
+    int64_t retune_nanos_;
+
+    mutable std::atomic<search_func_t>  search_;
+    mutable std::atomic<int>            engine_;        // AutoTuneEngine::Last in the trial.
+    mutable std::atomic<uint64_t>       trials_;        // The searches of the trial, reset by retune() only.
+    mutable std::atomic<uint64_t>       searches_;      // The pinned searches since the last check.
+    mutable std::atomic<int64_t>        pinned_time_;   // The nanoseconds of steady_clock.
+    mutable std::atomic<uint64_t>       tunings_;
+    mutable std::atomic<uint64_t>       nanos_[AutoTuneEngine::Last];
+    mutable std::atomic<uint64_t>       bytes_[AutoTuneEngine::Last];
+
+public:
+    AutoTuneImpl() : num_candidates_(0), trial_searches_(0), check_interval_(1), retune_nanos_(0),
+                     search_(&this_type::search_trial), engine_(AutoTuneEngine::Last),
+                     trials_(0), searches_(0), pinned_time_(0), tunings_(0) {
+        this->candidates_[0] = AutoTuneEngine::Simd;
+        this->reset_timings();
+    }
+    AutoTuneImpl(const AutoTuneImpl & src)
+        : search_(&this_type::search_trial), engine_(AutoTuneEngine::Last),
+          trials_(0), searches_(0), pinned_time_(0), tunings_(0) {
+        this->reset_timings();
+        this->copy_from(src);
+    }
+    ~AutoTuneImpl() {
+        this->destroy();
+    }
+
+    AutoTuneImpl & operator = (const AutoTuneImpl & rhs) {
+        if (&rhs != this)
+            this->copy_from(rhs);
+        return *this;
+    }
+
+    static const char * name() { return "AutoTune"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    // The pinned engine, or AutoTuneEngine::Last in a trial.
+    AutoTuneEngine::Type engine() const {
+        return (AutoTuneEngine::Type)this->engine_.load(std::memory_order_relaxed);
+    }
+
+    bool is_tuning() const { return (this->engine() == AutoTuneEngine::Last); }
+
+    // The numbers of the finished trials.
+    uint64_t tunings() const { return this->tunings_.load(std::memory_order_relaxed); }
+
+    size_type num_candidates() const { return this->num_candidates_; }
+    AutoTuneEngine::Type candidate(size_type index) const {
+        assert(index < this->num_candidates_);
+        return this->candidates_[index];
+    }
+
+    // Start a new trial from the next search.
+    void retune() const {
+        this->reset_timings();
+        this->trials_.store(0, std::memory_order_relaxed);
+        this->engine_.store(AutoTuneEngine::Last, std::memory_order_relaxed);
+        this->search_.store(&this_type::search_trial, std::memory_order_release);
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+
+        const AutoTuneOptions & options = AutoTuneOptions::global();
+
+        bool success = this->simd_.preprocessing(pattern, length);
+        success = this->mem_mem_.preprocessing(pattern, length) && success;
+        success = this->horspool_.preprocessing(pattern, length) && success;
+        success = this->two_way_.preprocessing(pattern, length) && success;
+
+        size_type n = 0;
+        this->candidates_[n++] = AutoTuneEngine::Simd;
+        this->candidates_[n++] = AutoTuneEngine::MemMem;
+        this->candidates_[n++] = AutoTuneEngine::Horspool;
+        this->candidates_[n++] = AutoTuneEngine::TwoWay;
+#if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
+ || defined(_M_IA64) || defined(_M_ARM64) || defined(__amd64__) || defined(__x86_64__)
+        if (length <= 64) {
+            success = this->shift_or_.preprocessing(pattern, length) && success;
+            this->candidates_[n++] = AutoTuneEngine::ShiftOr;
+        }
+#endif
+        this->num_candidates_ = n;
+
+        this->trial_searches_ = (uint64_t)(sm_max(options.trial_rounds, (size_t)1) * n);
+        this->check_interval_ = (uint64_t)sm_max(options.check_interval, (size_t)1);
+        this->retune_nanos_ = (int64_t)(options.retune_seconds * 1.0e9);
+        this->tunings_.store(0, std::memory_order_relaxed);
+        this->retune();
+        return success;
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+
+        // Horspool and ShiftOr don't accept the empty pattern.
+        if (unlikely(pattern_len == 0))
+            return 0;
+
+        search_func_t search_func = this->search_.load(std::memory_order_acquire);
+        return search_func(this, text, text_len, pattern, pattern_len);
+    }
+
+private:
+    static int64_t now_nanos() {
+        return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        clock_type::now().time_since_epoch()).count();
+    }
+
+    void reset_timings() const {
+        for (int i = 0; i < AutoTuneEngine::Last; ++i) {
+            this->nanos_[i].store(0, std::memory_order_relaxed);
+            this->bytes_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void copy_from(const AutoTuneImpl & src) {
+        this->simd_ = src.simd_;
+        this->mem_mem_ = src.mem_mem_;
+        this->horspool_ = src.horspool_;
+        this->two_way_ = src.two_way_;
+#if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
+ || defined(_M_IA64) || defined(_M_ARM64) || defined(__amd64__) || defined(__x86_64__)
+        this->shift_or_ = src.shift_or_;
+#endif
+        for (size_type i = 0; i < src.num_candidates_; ++i)
+            this->candidates_[i] = src.candidates_[i];
+        this->num_candidates_ = src.num_candidates_;
+        this->trial_searches_ = src.trial_searches_;
+        this->check_interval_ = src.check_interval_;
+        this->retune_nanos_ = src.retune_nanos_;
+
+        // The copy keeps the engine of src, and tunes by itself from now on.
+        int engine = src.engine_.load(std::memory_order_relaxed);
+        if (engine != AutoTuneEngine::Last) {
+            this->engine_.store(engine, std::memory_order_relaxed);
+            this->searches_.store(0, std::memory_order_relaxed);
+            this->pinned_time_.store(this_type::now_nanos(), std::memory_order_relaxed);
+            this->search_.store(this_type::pinned_search((AutoTuneEngine::Type)engine),
+                                std::memory_order_release);
+        }
+        else {
+            this->retune();
+        }
+    }
+
+    Long search_with(AutoTuneEngine::Type engine,
+                     const char_type * text, size_type text_len,
+                     const char_type * pattern, size_type pattern_len) const {
+        switch (engine) {
+            case AutoTuneEngine::MemMem:
+                return this->mem_mem_.search(text, text_len, pattern, pattern_len);
+            case AutoTuneEngine::Horspool:
+                return this->horspool_.search(text, text_len, pattern, pattern_len);
+            case AutoTuneEngine::TwoWay:
+                return this->two_way_.search(text, text_len, pattern, pattern_len);
+#if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
+ || defined(_M_IA64) || defined(_M_ARM64) || defined(__amd64__) || defined(__x86_64__)
+            case AutoTuneEngine::ShiftOr:
+                return this->shift_or_.search(text, text_len, pattern, pattern_len);
+#endif
+            default:
+                return this->simd_.search(text, text_len, pattern, pattern_len);
+        }
+    }
+
+    template <int Engine>
+    static Long search_pinned(const this_type * self,
+                              const char_type * text, size_type text_len,
+                              const char_type * pattern, size_type pattern_len) {
+        // A plain load and store, a lost count only delays the check a little.
+        // The stale store of a racing caller can't stall a trial, it has its own counter.
+        uint64_t searches = self->searches_.load(std::memory_order_relaxed) + 1;
+        if (likely(searches < self->check_interval_)) {
+            self->searches_.store(searches, std::memory_order_relaxed);
+        }
+        else {
+            self->searches_.store(0, std::memory_order_relaxed);
+            self->check_retune();
+        }
+        return self->search_with((AutoTuneEngine::Type)Engine, text, text_len, pattern, pattern_len);
+    }
+
+    static search_func_t pinned_search(AutoTuneEngine::Type engine) {
+        switch (engine) {
+            case AutoTuneEngine::MemMem:
+                return &this_type::template search_pinned<AutoTuneEngine::MemMem>;
+            case AutoTuneEngine::Horspool:
+                return &this_type::template search_pinned<AutoTuneEngine::Horspool>;
+            case AutoTuneEngine::TwoWay:
+                return &this_type::template search_pinned<AutoTuneEngine::TwoWay>;
+            case AutoTuneEngine::ShiftOr:
+                return &this_type::template search_pinned<AutoTuneEngine::ShiftOr>;
+            default:
+                return &this_type::template search_pinned<AutoTuneEngine::Simd>;
+        }
+    }
+
+    void check_retune() const {
+        if (this->retune_nanos_ <= 0)
+            return;
+        int64_t elapsed = this_type::now_nanos() - this->pinned_time_.load(std::memory_order_relaxed);
+        if (elapsed >= this->retune_nanos_)
+            this->retune();
+    }
+
+    static Long search_trial(const this_type * self,
+                             const char_type * text, size_type text_len,
+                             const char_type * pattern, size_type pattern_len) {
+        uint64_t trial = self->trials_.fetch_add(1, std::memory_order_relaxed);
+        if (unlikely(trial >= self->trial_searches_)) {
+            // The other thread is pinning the engine.
+            return self->search_with(self->candidates_[0], text, text_len, pattern, pattern_len);
+        }
+
+        AutoTuneEngine::Type engine = self->candidates_[trial % self->num_candidates_];
+        int64_t start_time = this_type::now_nanos();
+        Long index_of = self->search_with(engine, text, text_len, pattern, pattern_len);
+        int64_t elapsed = this_type::now_nanos() - start_time;
+
+        // The bytes have been scanned, up to the end of the match.
+        uint64_t bytes = (index_of >= 0) ? ((uint64_t)index_of + pattern_len) : (uint64_t)text_len;
+        self->nanos_[engine].fetch_add((uint64_t)sm_max(elapsed, (int64_t)0), std::memory_order_relaxed);
+        self->bytes_[engine].fetch_add(sm_max(bytes, (uint64_t)1), std::memory_order_relaxed);
+
+        if (unlikely(trial + 1 == self->trial_searches_))
+            self->pin_fastest();
+        return index_of;
+    }
+
+    void pin_fastest() const {
+        AutoTuneEngine::Type best = this->candidates_[0];
+        double best_cost = -1.0;
+        for (size_type i = 0; i < this->num_candidates_; ++i) {
+            AutoTuneEngine::Type engine = this->candidates_[i];
+            uint64_t bytes = this->bytes_[engine].load(std::memory_order_relaxed);
+            if (bytes == 0)
+                continue;
+            double cost = (double)this->nanos_[engine].load(std::memory_order_relaxed) / (double)bytes;
+            if (best_cost < 0.0 || cost < best_cost) {
+                best = engine;
+                best_cost = cost;
+            }
+        }
+
+        this->pinned_time_.store(this_type::now_nanos(), std::memory_order_relaxed);
+        this->searches_.store(0, std::memory_order_relaxed);
+        this->engine_.store(best, std::memory_order_relaxed);
+        this->tunings_.fetch_add(1, std::memory_order_relaxed);
+        this->search_.store(this_type::pinned_search(best), std::memory_order_release);
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< AutoTuneImpl<char> >  AutoTune;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_AUTO_TUNE_H
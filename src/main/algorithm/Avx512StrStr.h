@@ -0,0 +1,192 @@
+
+#ifndef STRING_MATCH_AVX512_STRSTR_H
+#define STRING_MATCH_AVX512_STRSTR_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+#include <immintrin.h>  // For AVX 512
+
+#include <cstdint>
+#include <cstddef>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "support/bitscan_forward.h"
+
+//
+// The AVX-512BW version of avx2_memmem(), see: algorithm/AvxStrStr.h
+//
+// 64 candidate positions (of char) are compared per iteration, and the tail
+// of the text is loaded with the mask registers, the masked-off chars are never
+// read, so there is no scalar epilogue and no over-read.
+//
+
+#if defined(__AVX512BW__) || SM_HAS_TARGET_ATTRIBUTE \
+ || (defined(_MSC_VER) && (_MSC_VER >= 1910))
+#define STRING_MATCH_HAVE_AVX512BW  1
+#endif
+
+#if STRING_MATCH_HAVE_AVX512BW
+
+namespace StringMatch {
+
+template <std::size_t CharSize>
+struct AVX512Helper {
+};
+
+template <>
+struct AVX512Helper<1> {
+    typedef __mmask64 mask_type;
+
+    static SM_TARGET_AVX512BW __m512i set1(uint32_t ch) { return _mm512_set1_epi8((char)ch); }
+    static SM_TARGET_AVX512BW __m512i maskz_loadu(mask_type k, const void * p) { return _mm512_maskz_loadu_epi8(k, p); }
+    static SM_TARGET_AVX512BW mask_type cmpeq(mask_type k, __m512i a, __m512i b) { return _mm512_mask_cmpeq_epi8_mask(k, a, b); }
+};
+
+template <>
+struct AVX512Helper<2> {
+    typedef __mmask32 mask_type;
+
+    static SM_TARGET_AVX512BW __m512i set1(uint32_t ch) { return _mm512_set1_epi16((short)ch); }
+    static SM_TARGET_AVX512BW __m512i maskz_loadu(mask_type k, const void * p) { return _mm512_maskz_loadu_epi16(k, p); }
+    static SM_TARGET_AVX512BW mask_type cmpeq(mask_type k, __m512i a, __m512i b) { return _mm512_mask_cmpeq_epi16_mask(k, a, b); }
+};
+
+template <>
+struct AVX512Helper<4> {
+    typedef __mmask16 mask_type;
+
+    static SM_TARGET_AVX512BW __m512i set1(uint32_t ch) { return _mm512_set1_epi32((int)ch); }
+    static SM_TARGET_AVX512BW __m512i maskz_loadu(mask_type k, const void * p) { return _mm512_maskz_loadu_epi32(k, p); }
+    static SM_TARGET_AVX512BW mask_type cmpeq(mask_type k, __m512i a, __m512i b) { return _mm512_mask_cmpeq_epi32_mask(k, a, b); }
+};
+
+template <typename char_type>
+static
+SM_TARGET_AVX512BW
+SM_NOINLINE_DECLARE(const char_type *)
+avx512_memmem(const char_type * text, size_t text_len,
+              const char_type * pattern, size_t pattern_len) {
+    typedef AVX512Helper<sizeof(char_type)> helper_type;
+    typedef typename helper_type::mask_type mask_type;
+    typedef typename jstd::uchar_traits<char_type>::type uchar_type;
+
+    static const size_t kMaxSize = sizeof(__m512i) / sizeof(char_type);
+    static const mask_type kFullMask = (mask_type)(~(mask_type)0);
+
+    assert(text != nullptr);
+    assert(pattern != nullptr);
+
+    if (unlikely(pattern_len == 0))
+        return text;
+    if (unlikely(pattern_len > text_len))
+        return nullptr;
+
+    const size_t pattern_last = pattern_len - 1;
+    // The numbers of candidate positions.
+    const size_t scan_len = text_len - pattern_len + 1;
+    const size_t verify_size = (pattern_len >= 2) ? ((pattern_len - 2) * sizeof(char_type)) : 0;
+
+    const __m512i __first = helper_type::set1((uint32_t)(uchar_type)pattern[0]);
+    const __m512i __last  = helper_type::set1((uint32_t)(uchar_type)pattern[pattern_last]);
+
+    size_t index = 0;
+    mask_type load_mask = kFullMask;
+    do {
+        size_t remain = scan_len - index;
+        if (unlikely(remain < kMaxSize)) {
+            // The tail: only load the remaining candidate positions.
+            load_mask = (mask_type)(((uint64_t)1 << remain) - 1);
+        }
+
+        const __m512i __block_first = helper_type::maskz_loadu(load_mask, text + index);
+        const __m512i __block_last  = helper_type::maskz_loadu(load_mask, text + index + pattern_last);
+
+        mask_type mask = helper_type::cmpeq(load_mask, __first, __block_first);
+        mask = helper_type::cmpeq(mask, __last, __block_last);
+        while (unlikely(mask != 0)) {
+            unsigned long bit_pos;
+            __BitScanForward64(bit_pos, (uint64_t)mask);
+            const char_type * candidate = text + index + bit_pos;
+            if (::memcmp((const void *)(candidate + 1),
+                         (const void *)(pattern + 1), verify_size) == 0) {
+                // Has found
+                return candidate;
+            }
+            mask &= (mask_type)(mask - 1);
+        }
+
+        index += kMaxSize;
+    } while (likely(index < scan_len));
+
+    return nullptr;
+}
+
+template <typename CharTy>
+class Avx512StrStrImpl {
+public:
+    typedef Avx512StrStrImpl<CharTy>    this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+
+    Avx512StrStrImpl() {}
+    ~Avx512StrStrImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "avx512_memmem()"; }
+    static bool need_preprocessing() { return false; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        /* Don't need to do preprocessing. */
+        SM_UNUSED_VAR(pattern);
+        SM_UNUSED_VAR(length);
+        return true;
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        const char_type * substr = avx512_memmem(text, text_len, pattern, pattern_len);
+        if (likely(substr != nullptr))
+            return (Long)(substr - text);
+        else
+            return Status::NotFound;
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< Avx512StrStrImpl<char> >      Avx512StrStr;
+}
+
+namespace UnicodeString {
+    typedef AlgorithmWrapper< Avx512StrStrImpl<wchar_t> >   Avx512StrStr;
+}
+
+namespace Utf16String {
+    typedef AlgorithmWrapper< Avx512StrStrImpl<char16_t> >  Avx512StrStr;
+}
+
+namespace Utf32String {
+    typedef AlgorithmWrapper< Avx512StrStrImpl<char32_t> >  Avx512StrStr;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_HAVE_AVX512BW
+
+#endif // STRING_MATCH_AVX512_STRSTR_H
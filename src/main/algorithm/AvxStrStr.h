@@ -0,0 +1,209 @@
+
+#ifndef STRING_MATCH_AVX_STRSTR_H
+#define STRING_MATCH_AVX_STRSTR_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+#include <immintrin.h>  // For AVX 2
+
+#include <cstdint>
+#include <cstddef>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "support/bitscan_forward.h"
+
+//
+// SIMD-friendly algorithms for substring searching (Generic SIMD, AVX2 version)
+//
+// See: http://0x80.pl/articles/simd-strfind.html
+//
+// Compare the first and the last char of the pattern against 32 bytes of
+// candidate positions at once, and only verify the positions where both
+// of them are matched. The text length is explicit, so the text may contain
+// '\0' chars and never be read past (text + text_len).
+//
+
+namespace StringMatch {
+
+template <std::size_t CharSize>
+struct AVX2Helper {
+};
+
+template <>
+struct AVX2Helper<1> {
+    static const uint32_t kCharMask = 0x00000001UL;
+
+    static SM_TARGET_AVX2 __m256i set1(uint32_t ch) { return _mm256_set1_epi8((char)ch); }
+    static SM_TARGET_AVX2 __m256i cmpeq(__m256i a, __m256i b) { return _mm256_cmpeq_epi8(a, b); }
+};
+
+template <>
+struct AVX2Helper<2> {
+    static const uint32_t kCharMask = 0x00000003UL;
+
+    static SM_TARGET_AVX2 __m256i set1(uint32_t ch) { return _mm256_set1_epi16((short)ch); }
+    static SM_TARGET_AVX2 __m256i cmpeq(__m256i a, __m256i b) { return _mm256_cmpeq_epi16(a, b); }
+};
+
+template <>
+struct AVX2Helper<4> {
+    static const uint32_t kCharMask = 0x0000000FUL;
+
+    static SM_TARGET_AVX2 __m256i set1(uint32_t ch) { return _mm256_set1_epi32((int)ch); }
+    static SM_TARGET_AVX2 __m256i cmpeq(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+};
+
+template <typename char_type>
+static
+SM_TARGET_AVX2
+SM_NOINLINE_DECLARE(const char_type *)
+avx2_memmem(const char_type * text, size_t text_len,
+            const char_type * pattern, size_t pattern_len) {
+    typedef AVX2Helper<sizeof(char_type)> helper_type;
+    typedef typename jstd::uchar_traits<char_type>::type uchar_type;
+
+    static const size_t kMaxSize = sizeof(__m256i) / sizeof(char_type);
+    static const uint32_t kCharMask = helper_type::kCharMask;
+
+    assert(text != nullptr);
+    assert(pattern != nullptr);
+
+    if (unlikely(pattern_len == 0))
+        return text;
+    if (unlikely(pattern_len > text_len))
+        return nullptr;
+
+    const size_t pattern_last = pattern_len - 1;
+    // The numbers of candidate positions.
+    const size_t scan_len = text_len - pattern_len + 1;
+    const size_t verify_size = (pattern_len >= 2) ? ((pattern_len - 2) * sizeof(char_type)) : 0;
+
+    size_t index = 0;
+    if (likely(scan_len >= kMaxSize)) {
+        const __m256i __first = helper_type::set1((uint32_t)(uchar_type)pattern[0]);
+        const __m256i __last  = helper_type::set1((uint32_t)(uchar_type)pattern[pattern_last]);
+
+        // The last block overlaps the previous one, the positions have been
+        // scanned in front are masked off, so there is no scalar epilogue.
+        const size_t last_block = scan_len - kMaxSize;
+        uint32_t skip_mask = 0xFFFFFFFFUL;
+        do {
+            const __m256i __block_first = _mm256_loadu_si256((const __m256i *)(text + index));
+            const __m256i __block_last  = _mm256_loadu_si256((const __m256i *)(text + index + pattern_last));
+
+            const __m256i __eq_first = helper_type::cmpeq(__first, __block_first);
+            const __m256i __eq_last  = helper_type::cmpeq(__last, __block_last);
+
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(__eq_first, __eq_last));
+            mask &= skip_mask;
+            while (unlikely(mask != 0)) {
+                unsigned long bit_pos;
+                __BitScanForward(bit_pos, mask);
+                const char_type * candidate = text + index + bit_pos / sizeof(char_type);
+                if (::memcmp((const void *)(candidate + 1),
+                             (const void *)(pattern + 1), verify_size) == 0) {
+                    // Has found
+                    return candidate;
+                }
+                mask ^= (kCharMask << bit_pos);
+            }
+
+            if (likely(index < last_block)) {
+                size_t next_index = index + kMaxSize;
+                if (unlikely(next_index > last_block)) {
+                    skip_mask = 0xFFFFFFFFUL << ((next_index - last_block) * sizeof(char_type));
+                    next_index = last_block;
+                }
+                index = next_index;
+            }
+            else break;
+        } while (1);
+
+        return nullptr;
+    }
+
+    // The text is too short to fill a whole block.
+    const uchar_type first_char = (uchar_type)pattern[0];
+    const uchar_type last_char  = (uchar_type)pattern[pattern_last];
+    for (; index < scan_len; ++index) {
+        if (likely((uchar_type)text[index] != first_char ||
+                   (uchar_type)text[index + pattern_last] != last_char)) {
+            continue;
+        }
+        if (::memcmp((const void *)(text + index + 1),
+                     (const void *)(pattern + 1), verify_size) == 0) {
+            // Has found
+            return (text + index);
+        }
+    }
+
+    return nullptr;
+}
+
+template <typename CharTy>
+class AvxStrStrImpl {
+public:
+    typedef AvxStrStrImpl<CharTy>   this_type;
+    typedef CharTy                  char_type;
+    typedef std::size_t             size_type;
+
+    AvxStrStrImpl() {}
+    ~AvxStrStrImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "avx2_memmem()"; }
+    static bool need_preprocessing() { return false; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        /* Don't need to do preprocessing. */
+        SM_UNUSED_VAR(pattern);
+        SM_UNUSED_VAR(length);
+        return true;
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        const char_type * substr = avx2_memmem(text, text_len, pattern, pattern_len);
+        if (likely(substr != nullptr))
+            return (Long)(substr - text);
+        else
+            return Status::NotFound;
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< AvxStrStrImpl<char> >     AvxStrStr;
+}
+
+namespace UnicodeString {
+    typedef AlgorithmWrapper< AvxStrStrImpl<wchar_t> >  AvxStrStr;
+}
+
+namespace Utf16String {
+    typedef AlgorithmWrapper< AvxStrStrImpl<char16_t> > AvxStrStr;
+}
+
+namespace Utf32String {
+    typedef AlgorithmWrapper< AvxStrStrImpl<char32_t> > AvxStrStr;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_AVX_STRSTR_H
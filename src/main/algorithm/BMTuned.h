@@ -16,7 +16,7 @@
 
 #include "StringMatch.h"
 #include "algorithm/AlgorithmWrapper.h"
-#include "jstd/scoped_ptr.h"
+#include "algorithm/AlgorithmUtils.h"
 
 //
 // See: http://www-igm.univ-mlv.fr/~lecroq/string/tunedbm.html#SECTION00195
@@ -32,14 +32,16 @@ public:
     typedef std::size_t             size_type;
     typedef typename jstd::uchar_traits<CharTy>::type
                                     uchar_type;
+    typedef BadCharHash<CharTy>     hash_type;
 
     static const size_t kMaxAscii = 256;
 
 private:
     int bmBc_[kMaxAscii];
+    int shift_;
 
 public:
-    BMTunedImpl() {}
+    BMTunedImpl() : shift_(0) {}
     ~BMTunedImpl() {
         this->destroy();
     }
@@ -53,7 +55,7 @@ public:
     }
 
     /* Preprocessing bad characters. */
-    static void preBmBc(const char * pattern, size_type length, int * bmBc) {
+    static void preBmBc(const char_type * pattern, size_type length, int * bmBc) {
         assert(pattern != nullptr);
         assert(bmBc != nullptr);
 
@@ -61,9 +63,9 @@ public:
             bmBc[i] = (int)length;
         }
         for (Long i = 0; i < ((Long)length - 1); ++i) {
-            bmBc[(uchar_type)pattern[i]] = (int)((Long)length - 1 - i);
+            bmBc[hash_type::index(pattern[i])] = (int)((Long)length - 1 - i);
         }
-        assert(bmBc[(uchar_type)pattern[length - 1]] > 0);
+        assert(length == 0 || bmBc[hash_type::index(pattern[length - 1])] > 0);
     }
 
     /* Preprocessing */
@@ -74,60 +76,84 @@ public:
         int * bmBc = (int *)&this->bmBc_[0];
         this_type::preBmBc(pattern, length, bmBc);
 
+        // The tuned loop stops when it meets the last char of the pattern,
+        // so set it to 0 here, search() must not modify the shared table.
+        if (likely(length > 0)) {
+            size_type last_char = hash_type::index(pattern[length - 1]);
+            this->shift_ = bmBc[last_char];
+            bmBc[last_char] = 0;
+        }
+        else {
+            this->shift_ = 1;
+        }
         return true;
     }
 
     /* Searching */
     SM_NOINLINE_DECLARE(Long)
-    search(const char_type * text_start, size_type text_len,
+    search(const char_type * text, size_type text_len,
            const char_type * pattern, size_type pattern_len) const {
-        assert(text_start != nullptr);
+        assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
-            int * bmBc = (int *)&this->bmBc_[0];
+            if (unlikely(pattern_len == 0))
+                return 0;
+
+            const int * bmBc = &this->bmBc_[0];
             assert(bmBc != nullptr);
 
-            Long last = (Long)pattern_len - 1;
-            Long last_char = (Long)(uchar_type)pattern[last];
-            Long shift = (Long)pattern_len;
-            bmBc[last_char] = 0;
+            const Long shift = (Long)this->shift_;
+            const Long pattern_last = (Long)pattern_len - 1;
+            const Long scan_len = (Long)(text_len - pattern_len);
+            assert(bmBc[hash_type::index(pattern[pattern_last])] == 0);
             assert(shift > 0);
 
-            jstd::scoped_array<char_type> text_new(new char_type[text_len + pattern_len + 1]);
-            char_type * text = text_new.get();
-            if (text != nullptr) {
-                ::memcpy((void *)text, (const void *)text_start, text_len);
-                ::memset((void *)(text + text_len), (int)(uchar_type)pattern[last],
-                                  pattern_len * sizeof(char_type));
-                *(text + text_len + pattern_len) = char_type('\0');
-            }
-
-            const Long scan_len = (Long)(text_len - pattern_len);
-            const Long pattern_last = (Long)pattern_len - 1;
+            //
+            // Every jump of the skip loop is at most pattern_len, so one round of
+            // the unrolled loop (3 jumps) can't run out of the text while index is
+            // not greater than fast_limit. Behind it, jump one by one and check the
+            // bound every time. So there is no sentinel and no copy of the text.
+            //
+            const Long fast_limit = scan_len - 3 * (Long)pattern_len;
+            const char_type * text_last = text + pattern_last;
             Long index = 0;
             do {
-                register const char_type * source = text + index + pattern_last;
-                register const char_type * target = pattern + pattern_last;
-                assert(source >= text && source < (text + text_len));
-
-                Long k = bmBc[(uchar_type)*source];
-                while (k != 0) {
-                    source += k;
+                Long k = bmBc[hash_type::index(text_last[index])];
+                while (likely(k != 0 && index <= fast_limit)) {
+                    SM_STATS_SHIFT(k);
                     index += k;
-                    k = bmBc[(uchar_type)*source];
-                    source += k;
+                    k = bmBc[hash_type::index(text_last[index])];
+                    SM_STATS_SHIFT(k);
                     index += k;
-                    k = bmBc[(uchar_type)*source];
-                    source += k;
+                    k = bmBc[hash_type::index(text_last[index])];
+                    SM_STATS_SHIFT(k);
+                    index += k;
+                    k = bmBc[hash_type::index(text_last[index])];
+                }
+
+                while (k != 0) {
+                    SM_STATS_SHIFT(k);
                     index += k;
-                    k = bmBc[(uchar_type)*source];
+                    if (unlikely(index > scan_len))
+                        return Status::NotFound;
+                    k = bmBc[hash_type::index(text_last[index])];
                 }
 
-                source--;
-                target--;
+                // The last char is matched, compare the others from right to left.
+                // A wide char shares its entry with the other chars (BadCharHash),
+                // so k is 0 only means the last char may be matched, compare it too.
+                // shift is the smallest shift of the chars of the entry, it's safe.
+                SM_STATS_INC(filter_hits);
+                SM_STATS_INC(verifications);
+                const Long verify_last = (sizeof(char_type) == 1) ? (pattern_last - 1) : pattern_last;
+                register const char_type * source = text + index + verify_last;
+                register const char_type * target = pattern + verify_last;
+                assert(source >= (text - 1) && source < (text + text_len));
 
                 while (likely(target >= pattern)) {
+                    SM_STATS_INC(comparisons);
                     if (likely(*source != *target)) {
                         break;
                     }
@@ -136,11 +162,13 @@ public:
                 }
 
                 if (likely(target >= pattern)) {
+                    SM_STATS_INC(false_positives);
+                    SM_STATS_SHIFT(shift);
                     index += shift;
                 }
                 else {
                     // Has found
-                    assert(index >= 0 && index < (Long)text_len);
+                    assert(index >= 0 && index <= scan_len);
                     return index;
                 }
             } while (likely(index <= scan_len));
@@ -16,6 +16,7 @@
 
 #include "StringMatch.h"
 #include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AlgorithmUtils.h"
 #include "jstd/scoped_ptr.h"
 
 //
@@ -32,6 +33,7 @@ public:
     typedef std::size_t             size_type;
     typedef typename jstd::uchar_traits<CharTy>::type
                                     uchar_type;
+    typedef BadCharHash<CharTy>     hash_type;
 
     static const size_t kMaxAscii = 256;
 
@@ -57,7 +59,7 @@ public:
     }
 
     /* Preprocessing bad characters. */
-    static void preBmBc(const char * pattern, size_type length, int * bmBc) {
+    static void preBmBc(const char_type * pattern, size_type length, int * bmBc) {
         assert(pattern != nullptr);
         assert(bmBc != nullptr);
 
@@ -65,12 +67,12 @@ public:
             bmBc[i] = (int)length;
         }
         for (Long i = 0; i < ((Long)length - 1); ++i) {
-            bmBc[(uchar_type)pattern[i]] = (int)((Long)length - 1 - i);
+            bmBc[hash_type::index(pattern[i])] = (int)((Long)length - 1 - i);
         }
     }
 
     /* Preprocessing suffixes. */
-    static void suffixes(const char * pattern, size_type length, int * suffix) {
+    static void suffixes(const char_type * pattern, size_type length, int * suffix) {
         assert(pattern != nullptr);
         assert(suffix != nullptr);
 
@@ -103,7 +105,7 @@ public:
     }
 
     /* Preprocessing good suffixes. */
-    static bool preBmGs(const char * pattern, size_type length, int * bmGs) {
+    static bool preBmGs(const char_type * pattern, size_type length, int * bmGs) {
         int i, j;
         int len = (int)length;
 
@@ -163,12 +165,13 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         if (unlikely(pattern_len == 0))
             return 0;
 
         if (likely(pattern_len <= text_len)) {
-            int * bmGs = this->bmGs_.get();
-            int * bmBc = (int *)&this->bmBc_[0];
+            const int * bmGs = this->bmGs_.get();
+            const int * bmBc = &this->bmBc_[0];
 
             assert(bmGs != nullptr);
             assert(bmBc != nullptr);
@@ -182,6 +185,7 @@ public:
                 assert(source >= text && source < (text + text_len));
 
                 while (likely(cursor >= pattern)) {
+                    SM_STATS_INC(comparisons);
                     if (likely(*source != *cursor)) {
                         break;
                     }
@@ -191,8 +195,10 @@ public:
 
                 if (likely(cursor >= pattern)) {
                     Long pattern_idx = cursor - pattern;
-                    source_offset += sm_max(bmGs[pattern_idx],
-                                            bmBc[(uchar_type)*source] - (pattern_last - pattern_idx));
+                    Long shift = sm_max(bmGs[pattern_idx],
+                                        bmBc[hash_type::index(*source)] - (pattern_last - pattern_idx));
+                    SM_STATS_SHIFT(shift);
+                    source_offset += shift;
                 }
                 else {
                     // Has found
@@ -205,9 +211,70 @@ public:
         return Status::NotFound;
     }
 
+    struct cursor_type {
+        Long offset;            // The offset of text to be compared.
+
+        cursor_type() : offset(0) {}
+    };
+
+    /* Searching the next match, continue from the cursor. */
+    SM_NOINLINE_DECLARE(Long)
+    search_next(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len,
+                cursor_type & cursor, MatchMode::Type mode) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        assert(pattern_len != 0);
+
+        SM_STATS_INC(searches);
+        if (likely(pattern_len <= text_len)) {
+            const int * bmGs = this->bmGs_.get();
+            const int * bmBc = &this->bmBc_[0];
+
+            assert(bmGs != nullptr);
+            assert(bmBc != nullptr);
+
+            const Long source_last = (Long)(text_len - pattern_len);
+            const Long pattern_last = (Long)pattern_len - 1;
+            Long source_offset = cursor.offset;
+            while (likely(source_offset <= source_last)) {
+                register const char_type * source = text + source_offset + pattern_last;
+                register const char_type * cursor_ptr = pattern + pattern_last;
+                assert(source >= text && source < (text + text_len));
+
+                while (likely(cursor_ptr >= pattern)) {
+                    SM_STATS_INC(comparisons);
+                    if (likely(*source != *cursor_ptr)) {
+                        break;
+                    }
+                    source--;
+                    cursor_ptr--;
+                }
+
+                if (likely(cursor_ptr >= pattern)) {
+                    Long pattern_idx = cursor_ptr - pattern;
+                    Long shift = sm_max(bmGs[pattern_idx],
+                                        bmBc[hash_type::index(*source)] - (pattern_last - pattern_idx));
+                    SM_STATS_SHIFT(shift);
+                    source_offset += shift;
+                }
+                else {
+                    // Has found, bmGs[0] is the shift of a full match (the period of pattern).
+                    assert(source_offset >= 0 && source_offset < (Long)text_len);
+                    cursor.offset = source_offset +
+                        ((mode == MatchMode::Overlapping) ? (Long)bmGs[0] : (Long)pattern_len);
+                    return source_offset;
+                }
+            }
+            cursor.offset = source_offset;
+        }
+
+        return Status::NotFound;
+    }
+
 private:
     // Reserved codes
-    static void suffixes_old(const char * pattern, size_t length, int * suffix) {
+    static void suffixes_old(const char_type * pattern, size_t length, int * suffix) {
         int i, f, g;
         int len = (int)length;
 
@@ -0,0 +1,510 @@
+
+#ifndef STRING_MATCH_COMPACT_AHO_CORASICK_H
+#define STRING_MATCH_COMPACT_AHO_CORASICK_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+
+//
+// The compact version of AhoCorasick, see: algorithm/AhoCorasick.h
+//
+// The chars of the patterns are compressed into the classes of alphabet (the chars
+// not in any pattern share the class 0), and the goto and fail transitions are
+// precomputed into a flat DFA: (the numbers of states x the numbers of classes)
+// 32 bits entries. So the scanning is only one table lookup per char, and a state
+// is (classes * 4) bytes instead of the 2 KB of ACNode. The class map is 8 bits
+// (16 bits for the wide chars), the 256 bytes map of char always stays in L1.
+//
+// The entries store the row offset of the next state (premultiplied by the numbers
+// of classes), so the next entry is delta[row + class]. The states have any output
+// are numbered after all of the others, a match is only (row >= accept_row_).
+//
+
+namespace StringMatch {
+
+template <typename CharTy>
+class CompactAhoCorasickImpl {
+public:
+    typedef CompactAhoCorasickImpl<CharTy>  this_type;
+    typedef CharTy                          char_type;
+    typedef std::size_t                     size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                            uchar_type;
+    typedef uint32_t                        state_type;
+    typedef typename std::conditional<(sizeof(CharTy) == 1), uint8_t, uint16_t>::type
+                                            class_type;
+
+    // The wide chars which greater than 0xFFFF are not supported in the patterns.
+    static const size_type kMaxClassMap = (sizeof(char_type) == 1) ? 256 : 65536;
+    static const size_type kMaxClasses  = (size_type)std::numeric_limits<class_type>::max() + 1;
+
+    static const state_type kMaxRow = 0xFFFFFFFFUL;
+    static const uint32_t   kNone   = 0xFFFFFFFFUL;
+
+    struct output_type {
+        int id;             // The id of pattern.
+        int length;         // The length of pattern.
+        uint32_t next;      // The next output of the same state, kNone is end.
+    };
+
+private:
+    struct keyword_type {
+        int id;
+        size_type offset;
+        size_type length;
+    };
+
+    std::vector<class_type> class_map_;     // char -> class of alphabet.
+    size_type num_classes_;
+    std::vector<state_type> delta_;         // The flat DFA.
+    state_type accept_row_;                 // The row of the first state has any output.
+    std::vector<uint32_t> first_output_;    // The head of the output list of every state.
+    std::vector<uint32_t> output_link_;     // The nearest terminal state on the fail chain.
+    std::vector<output_type> outputs_;
+
+    std::vector<char_type> keyword_chars_;  // The patterns added, for recompile.
+    std::vector<keyword_type> keywords_;
+    bool compiled_;
+
+public:
+    CompactAhoCorasickImpl() : num_classes_(0), accept_row_(kMaxRow), compiled_(false) {}
+    ~CompactAhoCorasickImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "AhoCorasick (Compact)"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const {
+        return this->compiled_;
+    }
+
+    void destroy() {
+        this->clear_automation();
+        this->keyword_chars_.clear();
+        this->keywords_.clear();
+    }
+
+    size_type state_count() const {
+        return this->first_output_.size();
+    }
+
+    size_type class_count() const {
+        return this->num_classes_;
+    }
+
+    size_type memory_usage() const {
+        return (this->class_map_.capacity() * sizeof(class_type) +
+                this->delta_.capacity() * sizeof(state_type) +
+                this->first_output_.capacity() * sizeof(uint32_t) +
+                this->output_link_.capacity() * sizeof(uint32_t) +
+                this->outputs_.capacity() * sizeof(output_type));
+    }
+
+    /* Add a pattern, call compile() after all patterns are added. */
+    bool add_pattern(int id, const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (unlikely(length == 0))
+            return false;
+
+        for (size_type i = 0; i < length; ++i) {
+            if (unlikely((size_type)(uchar_type)pattern[i] >= kMaxClassMap))
+                return false;
+        }
+
+        keyword_type keyword;
+        keyword.id = id;
+        keyword.offset = this->keyword_chars_.size();
+        keyword.length = length;
+        this->keyword_chars_.insert(this->keyword_chars_.end(), pattern, pattern + length);
+        this->keywords_.push_back(keyword);
+        return true;
+    }
+
+    bool add_pattern(int id, const char_type * first, const char_type * last) {
+        assert(first <= last);
+        return this->add_pattern(id, first, (size_type)(last - first));
+    }
+
+    /* Build the classes of alphabet, the trie, and the flat DFA. */
+    bool compile() {
+        this->clear_automation();
+
+        // The classes of alphabet, mark the chars in the patterns first. If all of
+        // the chars are in the patterns, the class 0 needn't be kept for the others.
+        this->class_map_.assign(kMaxClassMap, 0);
+        size_type num_chars = 0;
+        for (size_type i = 0; i < this->keyword_chars_.size(); ++i) {
+            uchar_type ch = (uchar_type)this->keyword_chars_[i];
+            if (this->class_map_[ch] == 0) {
+                this->class_map_[ch] = 1;
+                num_chars++;
+            }
+        }
+
+        size_type first_class = (sizeof(char_type) == 1 && num_chars == kMaxClassMap) ? 0 : 1;
+        if (unlikely(first_class + num_chars > kMaxClasses)) {
+            this->clear_automation();
+            return false;
+        }
+
+        this->num_classes_ = first_class;
+        for (size_type ch = 0; ch < kMaxClassMap; ++ch) {
+            if (this->class_map_[ch] != 0) {
+                this->class_map_[ch] = (class_type)this->num_classes_++;
+            }
+        }
+
+        // The trie: the entry 0 is no edge, because no edge goes to the root.
+        // Every char of the patterns adds one state at most, reserve them at once.
+        const size_type num_classes = this->num_classes_;
+        const size_type max_states = this->keyword_chars_.size() + 1;
+        this->delta_.reserve(max_states * num_classes);
+        this->first_output_.reserve(max_states);
+        this->output_link_.reserve(max_states);
+        this->outputs_.reserve(this->keywords_.size());
+        this->new_state();
+        for (size_type k = 0; k < this->keywords_.size(); ++k) {
+            const keyword_type & keyword = this->keywords_[k];
+            const char_type * pattern = &this->keyword_chars_[keyword.offset];
+            uint32_t state = 0;
+            for (size_type i = 0; i < keyword.length; ++i) {
+                size_type index = state * num_classes + this->class_map_[(uchar_type)pattern[i]];
+                if (likely(this->delta_[index] == 0)) {
+                    uint32_t next = this->new_state();
+                    this->delta_[index] = next;
+                }
+                state = this->delta_[index];
+            }
+
+            // Record the terminal state.
+            output_type output;
+            output.id = keyword.id;
+            output.length = (int)keyword.length;
+            output.next = this->first_output_[state];
+            this->first_output_[state] = (uint32_t)this->outputs_.size();
+            this->outputs_.push_back(output);
+        }
+
+        const size_type num_states = this->state_count();
+        if (unlikely((uint64_t)num_states * num_classes > (uint64_t)kMaxRow)) {
+            this->clear_automation();
+            return false;
+        }
+
+        // The fail links in BFS order, and fill the missing goto transitions
+        // with the transitions of the fail state.
+        std::vector<uint32_t> fail(num_states, 0);
+        std::vector<uint32_t> queue;
+        queue.reserve(num_states);
+        for (size_type c = 0; c < num_classes; ++c) {
+            uint32_t next = this->delta_[c];
+            if (next != 0) {
+                fail[next] = 0;
+                queue.push_back(next);
+            }
+        }
+
+        size_type head = 0;
+        while (likely(head < queue.size())) {
+            uint32_t state = queue[head++];
+            const size_type row = state * num_classes;
+            const size_type fail_row = fail[state] * num_classes;
+            for (size_type c = 0; c < num_classes; ++c) {
+                uint32_t next = this->delta_[row + c];
+                if (likely(next == 0)) {
+                    this->delta_[row + c] = this->delta_[fail_row + c];
+                }
+                else {
+                    // The row of fail state has been filled in front of this state.
+                    uint32_t next_fail = this->delta_[fail_row + c];
+                    fail[next] = next_fail;
+                    this->output_link_[next] = (this->first_output_[next_fail] != kNone) ?
+                                                next_fail : this->output_link_[next_fail];
+                    queue.push_back(next);
+                }
+            }
+        }
+
+        // Number the states have any output after all of the others (the root has
+        // no output, it's still 0), and premultiply the states to row offsets.
+        std::vector<uint32_t> renumber(num_states);
+        uint32_t num_accepts = 0;
+        for (size_type state = 0; state < num_states; ++state) {
+            if (this->has_output((uint32_t)state))
+                num_accepts++;
+        }
+
+        uint32_t next_state = 0;
+        uint32_t next_accept = (uint32_t)num_states - num_accepts;
+        for (size_type state = 0; state < num_states; ++state) {
+            renumber[state] = this->has_output((uint32_t)state) ? next_accept++ : next_state++;
+        }
+
+        std::vector<state_type> delta(this->delta_.size());
+        std::vector<uint32_t> first_output(num_states);
+        std::vector<uint32_t> output_link(num_states);
+        for (size_type state = 0; state < num_states; ++state) {
+            const size_type row = state * num_classes;
+            const size_type new_row = renumber[state] * num_classes;
+            for (size_type c = 0; c < num_classes; ++c) {
+                delta[new_row + c] = (state_type)(renumber[this->delta_[row + c]] * num_classes);
+            }
+            uint32_t link = this->output_link_[state];
+            first_output[renumber[state]] = this->first_output_[state];
+            output_link[renumber[state]] = (link != kNone) ? renumber[link] : kNone;
+        }
+
+        this->delta_.swap(delta);
+        this->first_output_.swap(first_output);
+        this->output_link_.swap(output_link);
+        this->accept_row_ = (state_type)(next_state * num_classes);
+
+        this->compiled_ = true;
+        return true;
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (likely(this->add_pattern(0, pattern, length)))
+            return this->compile();
+        else
+            return false;
+    }
+
+    /* Searching all patterns, call callback(pattern_id, start, end) for every match, the range is [start, end). */
+    template <typename Callback>
+    size_type search_all(const char_type * text, size_type text_len, Callback && callback) const {
+        assert(text != nullptr);
+        if (unlikely(!this->compiled_))
+            return 0;
+
+        const state_type * delta = this->delta_.data();
+        const class_type * class_map = this->class_map_.data();
+        const state_type accept_row = this->accept_row_;
+
+        size_type matches = 0;
+        state_type state = 0;
+        for (size_type pos = 0; pos < text_len; ++pos) {
+            if (likely(state == 0)) {
+                pos = this_type::skip_root(delta, class_map, text, pos, text_len, state);
+                if (unlikely(pos >= text_len))
+                    break;
+            }
+            else {
+                state = delta[state + this_type::class_of(class_map, text[pos])];
+            }
+            if (unlikely(state >= accept_row)) {
+                uint32_t terminal = this->state_index(state);
+                if (this->first_output_[terminal] == kNone)
+                    terminal = this->output_link_[terminal];
+                while (terminal != kNone) {
+                    for (uint32_t i = this->first_output_[terminal]; i != kNone; i = this->outputs_[i].next) {
+                        const output_type & output = this->outputs_[i];
+                        callback(output.id, pos + 1 - (size_type)output.length, pos + 1);
+                        matches++;
+                    }
+                    terminal = this->output_link_[terminal];
+                }
+            }
+        }
+        return matches;
+    }
+
+    /* Searching */
+    SM_NOINLINE_DECLARE(Long)
+    search(const char_type * text, size_type text_len,
+           const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        SM_UNUSED_VAR(pattern);
+
+        if (likely(pattern_len <= text_len && this->compiled_)) {
+            const state_type * delta = this->delta_.data();
+            const class_type * class_map = this->class_map_.data();
+            const state_type accept_row = this->accept_row_;
+
+            state_type state = 0;
+            for (size_type pos = 0; pos < text_len; ++pos) {
+                if (likely(state == 0)) {
+                    pos = this_type::skip_root(delta, class_map, text, pos, text_len, state);
+                    if (unlikely(pos >= text_len))
+                        break;
+                }
+                else {
+                    state = delta[state + this_type::class_of(class_map, text[pos])];
+                }
+                if (unlikely(state >= accept_row)) {
+                    // Has found
+                    return (Long)(pos + 1) - this->match_length(state);
+                }
+            }
+        }
+
+        return Status::NotFound;
+    }
+
+    struct cursor_type {
+        size_type pos;          // The next char of text to be scanned.
+        state_type state;       // The current state of DFA.
+        size_type length;       // The length of the last match.
+
+        cursor_type() : pos(0), state(0), length(0) {}
+    };
+
+    /* Searching the next match in a stream, the cursor keeps all of the state
+       between the chunks, set cursor.pos to 0 for every new chunk. Return the
+       end of the match in this chunk, the match may start in the chunks before. */
+    SM_NOINLINE_DECLARE(Long)
+    search_stream(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len,
+                cursor_type & cursor, MatchMode::Type mode) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        assert(pattern_len != 0);
+        SM_UNUSED_VAR(pattern);
+
+        if (likely(this->compiled_)) {
+            const state_type * delta = this->delta_.data();
+            const class_type * class_map = this->class_map_.data();
+            const state_type accept_row = this->accept_row_;
+
+            state_type state = cursor.state;
+            for (size_type pos = cursor.pos; pos < text_len; ++pos) {
+                if (likely(state == 0)) {
+                    pos = this_type::skip_root(delta, class_map, text, pos, text_len, state);
+                    if (unlikely(pos >= text_len))
+                        break;
+                }
+                else {
+                    state = delta[state + this_type::class_of(class_map, text[pos])];
+                }
+                if (unlikely(state >= accept_row)) {
+                    // Has found, the non-overlapping match restarts from root.
+                    cursor.pos = pos + 1;
+                    cursor.state = (mode == MatchMode::Overlapping) ? state : 0;
+                    cursor.length = (size_type)this->match_length(state);
+                    return (Long)(pos + 1);
+                }
+            }
+            cursor.state = state;
+        }
+
+        cursor.pos = text_len;
+        return Status::NotFound;
+    }
+
+    /* Searching the next match, continue from the cursor. */
+    Long search_next(const char_type * text, size_type text_len,
+                     const char_type * pattern, size_type pattern_len,
+                     cursor_type & cursor, MatchMode::Type mode) const {
+        Long match_end = this->search_stream(text, text_len, pattern, pattern_len, cursor, mode);
+        if (likely(match_end >= 0))
+            return (match_end - (Long)cursor.length);
+        else
+            return Status::NotFound;
+    }
+
+private:
+    static inline
+    size_type class_of(const class_type * class_map, char_type ch) {
+        uchar_type uch = (uchar_type)ch;
+        if (sizeof(char_type) == 1 || (size_type)uch < kMaxClassMap)
+            return class_map[uch];
+        else
+            return 0;
+    }
+
+    // In the root, the next state doesn't depend on the last one, so the loads of
+    // the chars which stay in the root are independent and can run ahead, it's
+    // the fast path of the texts which rarely hit the first chars of the patterns.
+    // Return the position of the first char leaves the root, or text_len.
+    static inline
+    size_type skip_root(const state_type * delta, const class_type * class_map,
+                        const char_type * text, size_type pos, size_type text_len,
+                        state_type & state) {
+        for (; pos < text_len; ++pos) {
+            state_type next = delta[this_type::class_of(class_map, text[pos])];
+            if (unlikely(next != 0)) {
+                state = next;
+                break;
+            }
+        }
+        return pos;
+    }
+
+    uint32_t state_index(state_type state) const {
+        return (uint32_t)(state / this->num_classes_);
+    }
+
+    bool has_output(uint32_t state) const {
+        return (this->first_output_[state] != kNone || this->output_link_[state] != kNone);
+    }
+
+    // The length of the longest pattern ends at this state.
+    Long match_length(state_type state) const {
+        uint32_t terminal = this->state_index(state);
+        if (this->first_output_[terminal] == kNone)
+            terminal = this->output_link_[terminal];
+        assert(terminal != kNone);
+        return (Long)this->outputs_[this->first_output_[terminal]].length;
+    }
+
+    uint32_t new_state() {
+        uint32_t state = (uint32_t)this->first_output_.size();
+        this->delta_.resize(this->delta_.size() + this->num_classes_, 0);
+        this->first_output_.push_back(kNone);
+        this->output_link_.push_back(kNone);
+        return state;
+    }
+
+    void clear_automation() {
+        this->class_map_.clear();
+        this->num_classes_ = 0;
+        this->delta_.clear();
+        this->accept_row_ = kMaxRow;
+        this->first_output_.clear();
+        this->output_link_.clear();
+        this->outputs_.clear();
+        this->compiled_ = false;
+    }
+};
+
+template <typename CharTy>
+const typename CompactAhoCorasickImpl<CharTy>::size_type CompactAhoCorasickImpl<CharTy>::kMaxClassMap;
+
+template <typename CharTy>
+const typename CompactAhoCorasickImpl<CharTy>::size_type CompactAhoCorasickImpl<CharTy>::kMaxClasses;
+
+template <typename CharTy>
+const typename CompactAhoCorasickImpl<CharTy>::state_type CompactAhoCorasickImpl<CharTy>::kMaxRow;
+
+template <typename CharTy>
+const uint32_t CompactAhoCorasickImpl<CharTy>::kNone;
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< CompactAhoCorasickImpl<char> >    CompactAhoCorasick;
+}
+
+namespace UnicodeString {
+    typedef AlgorithmWrapper< CompactAhoCorasickImpl<wchar_t> > CompactAhoCorasick;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_COMPACT_AHO_CORASICK_H
@@ -0,0 +1,406 @@
+
+#ifndef STRING_MATCH_FDR_H
+#define STRING_MATCH_FDR_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+
+//
+// FDR: a bucketed shift-or over the hashed 2 bytes domains, for the medium
+// sets (100 - 10,000) of literals, from the literal matcher of Hyperscan.
+//
+// See: https://github.com/intel/hyperscan/tree/master/src/fdr (fdr.c)
+//
+// The literals are sorted by the length and split into 8 buckets, so the short
+// literals don't weaken the filter of the long ones. The 64 bits state has a
+// byte per char of a window of 8 chars, and a bit per bucket in every byte.
+// A char of the text and the char in front of it are hashed into the domain
+// (10 - 14 bits), the reach table of the domain has the bit (t, bucket) cleared
+// if a literal of the bucket may have the 2 chars at the distance t from its
+// end. For every char: state = (state << 8) | reach[hash], the loads don't
+// depend on the state, and the zero bits of the top byte are the buckets which
+// may have a literal ending at the char.
+//
+// The confirm stage looks up a hash table of the literals by the bucket and the
+// last 1 - 4 chars (the shortest literal of the bucket), and compares them by
+// memcmp(). The matches are reported in the order of their end positions, as
+// AhoCorasick does.
+//
+
+namespace StringMatch {
+
+template <typename CharTy>
+class FdrImpl {
+public:
+    typedef FdrImpl<CharTy>             this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                        uchar_type;
+
+    // The reach table is hashed from the bytes of the text.
+    static_assert(sizeof(CharTy) == 1, "FdrImpl<CharTy>: only the byte strings are supported.");
+
+    static const size_type kBuckets = 8;
+    static const size_type kWindow = 8;
+    static const size_type kMinDomainBits = 10;
+    static const size_type kMaxDomainBits = 14;
+    static const size_type kMaxConfirmLen = 4;
+
+    static const uint32_t kNone = 0xFFFFFFFFUL;
+
+private:
+    struct Literal {
+        uint32_t offset;        // The offset in storage_.
+        uint32_t length;
+        int      id;
+        uint32_t bucket;
+        uint32_t next;          // The next literal of the same slot of confirm table, kNone is end.
+    };
+
+    std::string storage_;
+    std::vector<Literal> literals_;
+    std::vector<uint64_t> reach_;
+    std::vector<uint32_t> confirm_;         // The head of the literals of every slot.
+    uint32_t confirm_len_[kBuckets];        // The chars of the key of every bucket, 0 if it's empty.
+    size_type domain_bits_;
+    size_type confirm_bits_;
+    bool compiled_;
+
+public:
+    FdrImpl() : domain_bits_(kMinDomainBits), confirm_bits_(0), compiled_(false) {}
+    ~FdrImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "FDR"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    size_type num_patterns() const { return this->literals_.size(); }
+    size_type domain_bits() const { return this->domain_bits_; }
+
+    // For the reports of the multi-pattern benchmark, a state per pattern.
+    size_type state_count() const { return this->literals_.size(); }
+    size_type memory_usage() const {
+        return (this->storage_.capacity() +
+                this->literals_.capacity() * sizeof(Literal) +
+                this->reach_.capacity() * sizeof(uint64_t) +
+                this->confirm_.capacity() * sizeof(uint32_t));
+    }
+
+    void destroy() {
+        this->storage_.clear();
+        this->literals_.clear();
+        this->reach_.clear();
+        this->confirm_.clear();
+        this->compiled_ = false;
+    }
+
+    // Return false if the pattern is empty.
+    bool add_pattern(int id, const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (unlikely(length == 0))
+            return false;
+
+        Literal literal;
+        literal.offset = (uint32_t)this->storage_.size();
+        literal.length = (uint32_t)length;
+        literal.id = id;
+        literal.bucket = 0;
+        literal.next = kNone;
+        this->storage_.append((const char *)pattern, length);
+        this->literals_.push_back(literal);
+        this->compiled_ = false;
+        return true;
+    }
+
+    bool add_pattern(int id, const char_type * first, const char_type * last) {
+        assert(first <= last);
+        return this->add_pattern(id, first, (size_type)(last - first));
+    }
+
+    bool compile() {
+        const size_type num_literals = this->literals_.size();
+        if (unlikely(num_literals == 0))
+            return false;
+
+        // About 4 entries per literal, a table of 8 KB - 128 KB.
+        this->domain_bits_ = kMinDomainBits;
+        while (this->domain_bits_ < kMaxDomainBits &&
+               ((size_type)1 << this->domain_bits_) < num_literals * 4) {
+            this->domain_bits_++;
+        }
+
+        std::stable_sort(this->literals_.begin(), this->literals_.end(),
+            [](const Literal & a, const Literal & b) {
+                return (a.length < b.length);
+            });
+
+        // The literals are sorted by the length, the first one of a bucket is the shortest.
+        for (size_type bucket = 0; bucket < kBuckets; ++bucket)
+            this->confirm_len_[bucket] = 0;
+        for (size_type i = 0; i < num_literals; ++i) {
+            Literal & literal = this->literals_[i];
+            literal.bucket = (uint32_t)(i * kBuckets / num_literals);
+            if (this->confirm_len_[literal.bucket] == 0)
+                this->confirm_len_[literal.bucket] = (uint32_t)sm_min((size_type)literal.length, kMaxConfirmLen);
+        }
+
+        this->build_reach();
+        this->build_confirm();
+
+        this->compiled_ = true;
+        return true;
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        this->destroy();
+        if (likely(this->add_pattern(0, pattern, length)))
+            return this->compile();
+        else
+            return false;
+    }
+
+    /* Searching all patterns, call callback(pattern_id, start, end) for every match, the range is [start, end). */
+    template <typename Callback>
+    size_type search_all(const char_type * text, size_type text_len, Callback && callback) const {
+        assert(text != nullptr);
+        if (unlikely(!this->compiled_))
+            return 0;
+
+        const uint8_t * s = (const uint8_t *)text;
+        size_type matches = 0;
+        auto confirm = [this, s, &matches, &callback](size_type pos, uint32_t buckets) -> bool {
+            this->confirm(s, pos, buckets, [&matches, &callback](const Literal & literal, size_type end) -> bool {
+                callback(literal.id, end - literal.length, end);
+                matches++;
+                return false;
+            });
+            return false;
+        };
+        this->scan(s, text_len, confirm);
+        return matches;
+    }
+
+    /* Searching, return the start of the match which ends first. */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        SM_UNUSED_VAR(pattern);
+        SM_UNUSED_VAR(pattern_len);
+        if (unlikely(!this->compiled_))
+            return Status::NotFound;
+
+        const uint8_t * s = (const uint8_t *)text;
+        Long index_of = Status::NotFound;
+        auto confirm = [this, s, &index_of](size_type pos, uint32_t buckets) -> bool {
+            return this->confirm(s, pos, buckets, [&index_of](const Literal & literal, size_type end) -> bool {
+                index_of = (Long)(end - literal.length);
+                return true;
+            });
+        };
+        this->scan(s, text_len, confirm);
+        return index_of;
+    }
+
+private:
+    uint32_t domain_hash(uint32_t prev, uint32_t ch) const {
+        return (((prev << (this->domain_bits_ - 8)) ^ ch) & (((uint32_t)1 << this->domain_bits_) - 1));
+    }
+
+    uint32_t confirm_hash(uint32_t key, uint32_t bucket) const {
+        return ((uint32_t)((key ^ (bucket << 29)) * 0x9E3779B1UL) >> (32 - this->confirm_bits_));
+    }
+
+    // The last len chars which end at s[end - 1].
+    static uint32_t confirm_key(const uint8_t * s, size_type end, uint32_t len) {
+        uint32_t key = 0;
+        for (uint32_t i = 1; i <= len; ++i)
+            key = (key << 8) | s[end - i];
+        return key;
+    }
+
+    void build_reach() {
+        const size_type domain_size = (size_type)1 << this->domain_bits_;
+        this->reach_.assign(domain_size, ~(uint64_t)0);
+
+        // The window of a bucket is shorter than 8 chars if it has a shorter literal,
+        // the chars in front of the shortest literal are any chars.
+        uint64_t any_mask = ~(uint64_t)0;
+        for (size_type bucket = 0; bucket < kBuckets; ++bucket) {
+            const uint32_t min_len = this->min_length(bucket);
+            if (min_len == 0)
+                continue;
+            for (size_type t = min_len; t < kWindow; ++t)
+                any_mask &= ~((uint64_t)1 << ((kWindow - 1 - t) * 8 + bucket));
+        }
+        for (size_type h = 0; h < domain_size; ++h)
+            this->reach_[h] &= any_mask;
+
+        const uint8_t * storage = (const uint8_t *)this->storage_.data();
+        for (size_type i = 0; i < this->literals_.size(); ++i) {
+            const Literal & literal = this->literals_[i];
+            const uint8_t * chars = storage + literal.offset;
+            const size_type window = sm_min((size_type)literal.length, kWindow);
+            for (size_type t = 0; t < window; ++t) {
+                const uint64_t bit = (uint64_t)1 << ((kWindow - 1 - t) * 8 + literal.bucket);
+                const size_type last = literal.length - 1 - t;
+                if (last > 0) {
+                    this->reach_[this->domain_hash(chars[last - 1], chars[last])] &= ~bit;
+                }
+                else {
+                    // The first char of literal, the char in front of it is any char.
+                    for (uint32_t prev = 0; prev < 256; ++prev)
+                        this->reach_[this->domain_hash(prev, chars[0])] &= ~bit;
+                }
+            }
+        }
+    }
+
+    void build_confirm() {
+        this->confirm_bits_ = 4;
+        while (((size_type)1 << this->confirm_bits_) < this->literals_.size() * 2)
+            this->confirm_bits_++;
+        this->confirm_.assign((size_type)1 << this->confirm_bits_, (uint32_t)kNone);
+
+        // Link the literals in the reverse order, so a chain is in the order of the length.
+        const uint8_t * storage = (const uint8_t *)this->storage_.data();
+        for (size_type i = this->literals_.size(); i > 0; --i) {
+            Literal & literal = this->literals_[i - 1];
+            uint32_t key = this_type::confirm_key(storage + literal.offset, literal.length,
+                                                   this->confirm_len_[literal.bucket]);
+            uint32_t slot = this->confirm_hash(key, literal.bucket);
+            literal.next = this->confirm_[slot];
+            this->confirm_[slot] = (uint32_t)(i - 1);
+        }
+    }
+
+    uint32_t min_length(size_type bucket) const {
+        for (size_type i = 0; i < this->literals_.size(); ++i) {
+            if (this->literals_[i].bucket == bucket)
+                return this->literals_[i].length;
+        }
+        return 0;
+    }
+
+    // Call report(literal, end) for the literals of the buckets which end at s[pos],
+    // until it returns true.
+    template <typename Report>
+    bool confirm(const uint8_t * s, size_type pos, uint32_t buckets, Report && report) const {
+        const uint8_t * storage = (const uint8_t *)this->storage_.data();
+        const size_type end = pos + 1;
+        do {
+            unsigned long bucket;
+            __BitScanForward(bucket, buckets);
+            const uint32_t key_len = this->confirm_len_[bucket];
+            if (likely(end >= key_len)) {
+                uint32_t key = this_type::confirm_key(s, end, key_len);
+                for (uint32_t i = this->confirm_[this->confirm_hash(key, (uint32_t)bucket)];
+                     i != kNone; i = this->literals_[i].next) {
+                    const Literal & literal = this->literals_[i];
+                    if (literal.bucket == (uint32_t)bucket && end >= literal.length &&
+                        ::memcmp(s + end - literal.length, storage + literal.offset, literal.length) == 0) {
+                        if (report(literal, end))
+                            return true;
+                    }
+                }
+            }
+            buckets &= buckets - 1;
+        } while (buckets != 0);
+        return false;
+    }
+
+    // Call confirm(pos, buckets) for every candidate end position, until it returns true.
+    template <typename Confirm>
+    void scan(const uint8_t * text, size_type text_len, Confirm & confirm) const {
+        const uint64_t * reach = this->reach_.data();
+        const uint32_t shift = (uint32_t)(this->domain_bits_ - 8);
+        const uint32_t domain_mask = ((uint32_t)1 << this->domain_bits_) - 1;
+
+        //
+        // 8 chars per iteration: the state of the char k of the block is the OR of
+        // the reaches of the 8 chars end at it, so the reach of the char k is
+        // shifted by (7 - k) bytes into a 128 bits window (lo, hi), and the top
+        // byte of the state of the char j is the byte (14 - j) of the window.
+        // The low half of the window of the last block is the carry of the high
+        // half. The chars in front of the text are any chars.
+        //
+        uint32_t prev = 0;
+        uint64_t carry = 0;
+        size_type pos = 0;
+        if (likely(text_len >= kWindow)) {
+            const size_type last_block = text_len - kWindow;
+            for (; pos <= last_block; pos += kWindow) {
+                uint64_t r[kWindow];
+                for (size_type k = 0; k < kWindow; ++k) {
+                    const uint32_t ch = text[pos + k];
+                    r[k] = reach[((prev << shift) ^ ch) & domain_mask];
+                    prev = ch;
+                }
+                uint64_t lo = r[7], hi = carry;
+                for (size_type k = 0; k < kWindow - 1; ++k) {
+                    lo |= r[k] << ((kWindow - 1 - k) * 8);
+                    hi |= r[k] >> ((k + 1) * 8);
+                }
+                carry = lo;
+
+                if (unlikely((lo >> 56) != 0xFF || (hi | 0xFF00000000000000ULL) != ~(uint64_t)0)) {
+                    for (size_type j = 0; j < kWindow; ++j) {
+                        uint32_t top = (uint32_t)(((j < kWindow - 1) ? (hi >> ((6 - j) * 8)) : (lo >> 56)) & 0xFF);
+                        if (top != 0xFF) {
+                            if (confirm(pos + j, ~top & 0xFF))
+                                return;
+                        }
+                    }
+                }
+            }
+        }
+
+        // The tail: replay the last 7 chars to restore the state.
+        size_type first = (pos >= kWindow - 1) ? (pos - (kWindow - 1)) : 0;
+        uint64_t state = 0;
+        prev = (first > 0) ? text[first - 1] : 0;
+        for (size_type i = first; i < pos; ++i) {
+            const uint32_t ch = text[i];
+            state = (state << 8) | reach[((prev << shift) ^ ch) & domain_mask];
+            prev = ch;
+        }
+        for (; pos < text_len; ++pos) {
+            const uint32_t ch = text[pos];
+            state = (state << 8) | reach[((prev << shift) ^ ch) & domain_mask];
+            prev = ch;
+            if (unlikely((state >> 56) != 0xFF)) {
+                if (confirm(pos, (uint32_t)(~state >> 56)))
+                    return;
+            }
+        }
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< FdrImpl<char> >   FDR;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_FDR_H
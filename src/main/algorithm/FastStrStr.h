@@ -31,11 +31,16 @@ namespace StringMatch {
 /**
  * Finds the first occurrence of the sub-string needle in the string haystack.
  * Returns NULL if needle was not found.
+ *
+ * The search statistics are counted to the StatsKey algorithm.
  */
+template <typename StatsKey = void>
 static
 SM_NOINLINE_DECLARE(void *)
 fast_strstr(const char * haystack, const char * needle)
 {
+    SM_STATS_INC_OF(StatsKey, searches);
+
     // Empty needle.
     if (!*needle) {
         return (char *)haystack;
@@ -47,10 +52,12 @@ fast_strstr(const char * haystack, const char * needle)
     // algorithmic complexity for discarding the first non-matching characters.
 
     // First character of haystack is in the needle.
-    haystack = ::strchr(haystack, (unsigned char)needle_first);   
-    if (haystack == nullptr) {
+    const char * haystack_first = ::strchr(haystack, (unsigned char)needle_first);
+    if (haystack_first == nullptr) {
         return nullptr;
     }
+    SM_STATS_SHIFT_OF(StatsKey, haystack_first - haystack);
+    haystack = haystack_first;
 
     // First characters of haystack and needle are the same now. Both are
     // guaranteed to be at least one character long.
@@ -64,6 +71,7 @@ fast_strstr(const char * haystack, const char * needle)
     unsigned int sums_diff = 0;
 
     while (*i_haystack && *i_needle) {
+        SM_STATS_INC_OF(StatsKey, comparisons);
         sums_diff += *i_haystack;
         sums_diff -= *i_needle;
         identical &= (*i_haystack++ == *i_needle++);
@@ -85,14 +93,19 @@ fast_strstr(const char * haystack, const char * needle)
     for (sub_start = haystack; *i_haystack; i_haystack++) {
         sums_diff -= *sub_start++;
         sums_diff += *i_haystack;
+        SM_STATS_SHIFT_OF(StatsKey, 1);
 
         // Since the sum of the characters is already known to be equal at that
         // point, it is enough to check just needle_len-1 characters for
         // equality.
-        if (sums_diff == 0 &&
-            needle_first == *sub_start && // Avoids some calls to memcmp.
-            ::memcmp(sub_start + 1, needle + 1, needle_len_1) == 0) {
-            return (char *)sub_start;
+        if (sums_diff == 0) {
+            SM_STATS_INC_OF(StatsKey, filter_hits);
+            SM_STATS_INC_OF(StatsKey, verifications);
+            if (needle_first == *sub_start && // Avoids some calls to memcmp.
+                ::memcmp(sub_start + 1, needle + 1, needle_len_1) == 0) {
+                return (char *)sub_start;
+            }
+            SM_STATS_INC_OF(StatsKey, false_positives);
         }
     }
 
@@ -106,6 +119,9 @@ public:
     typedef CharTy                  char_type;
     typedef std::size_t             size_type;
 
+    // Search by the strstr() family, the text must be null-terminated.
+    static const bool kNullTerminated = true;
+
     FastStrStrImpl() {}
     ~FastStrStrImpl() {
         this->destroy();
@@ -132,7 +148,7 @@ public:
                 const char_type * pattern, size_type pattern_len) const {
         assert(text != nullptr);
         assert(pattern != nullptr);
-        const char_type * haystack = (const char_type *)fast_strstr((const char *)text, (const char *)pattern);
+        const char_type * haystack = (const char_type *)fast_strstr<this_type>((const char *)text, (const char *)pattern);
         if (likely(haystack != nullptr))
             return (Long)(haystack - text);
         else
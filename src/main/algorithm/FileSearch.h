@@ -0,0 +1,163 @@
+
+#ifndef STRING_MATCH_FILE_SEARCH_H
+#define STRING_MATCH_FILE_SEARCH_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/StreamMatcher.h"
+#include "support/MappedFile.h"
+
+//
+// search_file(): search a file with a compiled Pattern of any AlgorithmWrapper.
+//
+// The regular files are mapped and the mapping is searched in place, without
+// any copy. The pipes and the files can't be mapped are read in chunks of
+// buffer_size bytes and searched by StreamMatcher.
+//
+// The mapping and the read buffer aren't null-terminated, so the algorithm must
+// honour text_len, the strstr() family (need_null_terminated) is rejected at
+// compile time.
+//
+
+namespace StringMatch {
+
+struct FileSearchOptions : public MappedFile::Options {
+    std::size_t buffer_size;    // The buffer size of the read path, in bytes.
+
+    FileSearchOptions() : MappedFile::Options(), buffer_size(1024 * 1024) {}
+};
+
+namespace detail {
+
+// Read the file chunk by chunk, call feed(chunk, length) until it returns false.
+template <typename CharTy, typename Feeder>
+bool read_file_chunks(MappedFile & file, std::size_t buffer_size, Feeder && feed) {
+    std::size_t chunk_len = buffer_size / sizeof(CharTy);
+    if (chunk_len == 0)
+        chunk_len = 1;
+    std::vector<CharTy> buffer(chunk_len);
+
+    for (;;) {
+        // Fill the whole buffer, so every chunk is made of the whole chars.
+        int64_t bytes = file.read_fully((void *)buffer.data(), chunk_len * sizeof(CharTy));
+        if (bytes < 0)
+            return false;
+        std::size_t length = (std::size_t)bytes / sizeof(CharTy);
+        if (length != 0) {
+            if (!feed((const CharTy *)buffer.data(), length))
+                break;
+        }
+        if ((std::size_t)bytes < chunk_len * sizeof(CharTy))
+            break;
+    }
+    return true;
+}
+
+} // namespace detail
+
+//
+// Return the offset of the first match in the file (in chars),
+// Status::NotFound, or Status::IOError if the file can't be read.
+//
+template <typename PatternTy>
+int64_t search_file(const char * path, const PatternTy & pattern,
+                    const FileSearchOptions & options = FileSearchOptions()) {
+    typedef typename PatternTy::wrapper_type    wrapper_type;
+    typedef typename wrapper_type::char_type    char_type;
+    typedef typename wrapper_type::size_type    size_type;
+
+    static_assert(!need_null_terminated<typename wrapper_type::algorithm_type>::value,
+                  "search_file(): the file isn't null-terminated, the strstr() family can't be used.");
+
+    MappedFile file;
+    if (!file.open(path, options))
+        return Status::IOError;
+
+    // The same as Pattern::match(), an empty pattern matches at 0.
+    if (unlikely(pattern.size() == 0))
+        return 0;
+
+    if (file.is_mapped()) {
+        const char_type * text = (const char_type *)file.data();
+        size_type length = file.size() / sizeof(char_type);
+        if (unlikely(pattern.size() > length))
+            return Status::NotFound;
+        Long index_of = pattern.match(text, length);
+        return ((index_of >= 0) ? (int64_t)index_of : (int64_t)Status::NotFound);
+    }
+
+    // The matches are reported in order, so stop at the first one.
+    StreamMatcher<wrapper_type> stream(pattern);
+    int64_t first = Status::NotFound;
+    bool success = detail::read_file_chunks<char_type>(file, options.buffer_size,
+        [&](const char_type * chunk, size_type length) -> bool {
+            stream.feed(chunk, length, [&first](uint64_t offset) {
+                if (first < 0)
+                    first = (int64_t)offset;
+            });
+            return (first < 0);
+        });
+    if (!success)
+        return Status::IOError;
+    return first;
+}
+
+//
+// Call visitor(offset) for every match in the file in order (offset is uint64_t,
+// in chars), return the numbers of the matches, or Status::IOError.
+//
+template <typename PatternTy, typename Visitor>
+int64_t search_file_all(const char * path, const PatternTy & pattern, Visitor && visitor,
+                        MatchMode::Type mode = MatchMode::Overlapping,
+                        const FileSearchOptions & options = FileSearchOptions()) {
+    typedef typename PatternTy::wrapper_type    wrapper_type;
+    typedef typename wrapper_type::char_type    char_type;
+    typedef typename wrapper_type::size_type    size_type;
+
+    static_assert(!need_null_terminated<typename wrapper_type::algorithm_type>::value,
+                  "search_file_all(): the file isn't null-terminated, the strstr() family can't be used.");
+
+    MappedFile file;
+    if (!file.open(path, options))
+        return Status::IOError;
+
+    if (unlikely(pattern.size() == 0))
+        return 0;
+
+    if (file.is_mapped()) {
+        const char_type * text = (const char_type *)file.data();
+        size_type length = file.size() / sizeof(char_type);
+        if (unlikely(pattern.size() > length))
+            return 0;
+        size_type matches = pattern.match_all(text, length, [&visitor](Long index_of) {
+            visitor((uint64_t)index_of);
+        }, mode);
+        return (int64_t)matches;
+    }
+
+    StreamMatcher<wrapper_type> stream(pattern, mode);
+    bool success = detail::read_file_chunks<char_type>(file, options.buffer_size,
+        [&](const char_type * chunk, size_type length) -> bool {
+            stream.feed(chunk, length, visitor);
+            return true;
+        });
+    if (!success)
+        return Status::IOError;
+    return (int64_t)stream.finish();
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_FILE_SEARCH_H
@@ -241,6 +241,9 @@ public:
     typedef CharTy                      char_type;
     typedef std::size_t                 size_type;
 
+    // Search by the strstr() family, the text must be null-terminated.
+    static const bool kNullTerminated = true;
+
     GlibcStrStrOldImpl() {}
     ~GlibcStrStrOldImpl() {
         this->destroy();
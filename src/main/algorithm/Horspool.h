@@ -18,6 +18,7 @@
 
 #include "StringMatch.h"
 #include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AlgorithmUtils.h"
 
 //
 // See: http://www-igm.univ-mlv.fr/~lecroq/string/node18.html#SECTION00180
@@ -33,6 +34,7 @@ public:
     typedef std::size_t             size_type;
     typedef typename jstd::uchar_traits<CharTy>::type
                                     uchar_type;
+    typedef BadCharHash<CharTy>     hash_type;
 
     static const size_t kMaxAscii = 256;
 
@@ -62,7 +64,7 @@ public:
             this->hpBc_[i] = (int)length;
         }
         for (Long i = 0; i < ((Long)length - 1); ++i) {
-            this->hpBc_[(uchar_type)pattern[i]] = (int)((Long)length - 1 - i);
+            this->hpBc_[hash_type::index(pattern[i])] = (int)((Long)length - 1 - i);
         }
 
         return true;
@@ -75,8 +77,9 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
-            int * shift = (int *)&this->hpBc_[0];
+            const int * shift = &this->hpBc_[0];
             assert(shift != nullptr);
 
             const char_type * pattern_end = pattern + pattern_len;
@@ -89,10 +92,12 @@ public:
                 assert(source >= text && source < (text + text_len));
 
                 // Save the last compare char.
-                uchar_type last_char = (uchar_type)*source;
+                size_type last_char = hash_type::index(*source);
 
                 while (likely(target >= pattern)) {
+                    SM_STATS_INC(comparisons);
                     if (likely(*source != *target)) {
+                        SM_STATS_SHIFT(shift[last_char]);
                         index += shift[last_char];
                         break;
                     }
@@ -119,6 +124,14 @@ namespace UnicodeString {
     typedef AlgorithmWrapper< HorspoolImpl<wchar_t> >   Horspool;
 }
 
+namespace Utf16String {
+    typedef AlgorithmWrapper< HorspoolImpl<char16_t> >  Horspool;
+}
+
+namespace Utf32String {
+    typedef AlgorithmWrapper< HorspoolImpl<char32_t> >  Horspool;
+}
+
 } // namespace StringMatch
 
 #endif // STRING_MATCH_HORSPOOL_H
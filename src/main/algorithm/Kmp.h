@@ -52,14 +52,20 @@ public:
         assert(pattern != nullptr);
         int * kmp_next = new int[length + 1];
         if (kmp_next != nullptr) {
+            // kmp_next[i]: the length of the longest proper border of pattern[0, i).
             kmp_next[0] = -1;
-            kmp_next[1] = 0;
+            if (likely(length > 0))
+                kmp_next[1] = 0;
             for (size_type index = 1; index < length; ++index) {
-                if (likely(pattern[index] != pattern[kmp_next[index - 1]])) {
+                int border = kmp_next[index];
+                while (border > 0 && pattern[index] != pattern[border]) {
+                    border = kmp_next[border];
+                }
+                if (likely(pattern[index] != pattern[border])) {
                     kmp_next[index + 1] = 0;
                 }
                 else {
-                    kmp_next[index + 1] = kmp_next[index] + 1;
+                    kmp_next[index + 1] = border + 1;
                 }
             }
         }
@@ -74,9 +80,10 @@ public:
         assert(text_first != nullptr);
         assert(pattern_first != nullptr);
 
-        int * kmp_next = this->kmp_next_.get();
+        const int * kmp_next = this->kmp_next_.get();
         assert(kmp_next != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
             register const char_type * text = text_first;
             register const char_type * pattern = pattern_first;
@@ -84,9 +91,11 @@ public:
             const char_type * text_end = text_first + (text_len - pattern_len);
             const char_type * pattern_end = pattern + pattern_len;
             do {
+                SM_STATS_INC(comparisons);
                 if (likely(*text != *pattern)) {
                     int matched_chars = (int)(pattern - pattern_first);
                     if (likely(matched_chars == 0)) {
+                        SM_STATS_SHIFT(1);
                         text++;
                         if (likely(text <= text_end)) {
                             // continue
@@ -98,12 +107,12 @@ public:
                     }
                     else {
                         assert(matched_chars >= 1);
+                        // Keep the text, only fall back the pattern to the border.
                         int partial_matched = kmp_next[matched_chars];
-                        int text_offset = matched_chars - partial_matched;
-                        assert(text_offset >= 1);
+                        assert(partial_matched < matched_chars);
+                        SM_STATS_SHIFT(matched_chars - partial_matched);
                         pattern = pattern_first + partial_matched;
-                        text = text + text_offset;
-                        if (unlikely(text > text_end)) {
+                        if (unlikely((text - partial_matched) > text_end)) {
                             // Not found
                             return Status::NotFound;
                         }
@@ -125,6 +134,70 @@ public:
 
         return Status::NotFound;
     }
+
+    struct cursor_type {
+        size_type pos;          // The next char of text to be compared.
+        size_type matched;      // The numbers of pattern chars have been matched.
+
+        cursor_type() : pos(0), matched(0) {}
+    };
+
+    /* Searching the next match in a stream, the cursor keeps all of the state
+       between the chunks, set cursor.pos to 0 for every new chunk. Return the
+       end of the match in this chunk, the match may start in the chunks before. */
+    SM_NOINLINE_DECLARE(Long)
+    search_stream(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len,
+                cursor_type & cursor, MatchMode::Type mode) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        assert(pattern_len != 0);
+
+        const int * kmp_next = this->kmp_next_.get();
+        assert(kmp_next != nullptr);
+
+        SM_STATS_INC(searches);
+        size_type pos = cursor.pos;
+        size_type matched = cursor.matched;
+        while (likely(pos < text_len)) {
+            SM_STATS_INC(comparisons);
+            if (likely(text[pos] != pattern[matched])) {
+                if (likely(matched == 0)) {
+                    SM_STATS_SHIFT(1);
+                    pos++;
+                }
+                else {
+                    SM_STATS_SHIFT(matched - (size_type)kmp_next[matched]);
+                    matched = (size_type)kmp_next[matched];
+                }
+            }
+            else {
+                pos++;
+                matched++;
+                if (unlikely(matched >= pattern_len)) {
+                    // Has found, the overlapping match continues from the border.
+                    cursor.pos = pos;
+                    cursor.matched = (mode == MatchMode::Overlapping) ? (size_type)kmp_next[pattern_len] : 0;
+                    return (Long)pos;
+                }
+            }
+        }
+
+        cursor.pos = pos;
+        cursor.matched = matched;
+        return Status::NotFound;
+    }
+
+    /* Searching the next match, continue from the cursor. */
+    Long search_next(const char_type * text, size_type text_len,
+                     const char_type * pattern, size_type pattern_len,
+                     cursor_type & cursor, MatchMode::Type mode) const {
+        Long match_end = this->search_stream(text, text_len, pattern, pattern_len, cursor, mode);
+        if (likely(match_end >= 0))
+            return (match_end - (Long)pattern_len);
+        else
+            return Status::NotFound;
+    }
 };
 
 namespace AnsiString {
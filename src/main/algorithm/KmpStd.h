@@ -77,9 +77,10 @@ public:
         assert(text_start != nullptr);
         assert(pattern_start != nullptr);
 
-        int * kmp_next = this->kmp_next_.get();
+        const int * kmp_next = this->kmp_next_.get();
         assert(kmp_next != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
             register const char_type * text = text_start;
             register const char_type * pattern = pattern_start;
@@ -87,8 +88,13 @@ public:
             const char_type * text_end = text_start + text_len;
             int pattern_idx = 0;
             while (text < text_end) {
-                while (pattern_idx > -1 && *text != pattern[pattern_idx])
+                while (pattern_idx > -1) {
+                    SM_STATS_INC(comparisons);
+                    if (*text == pattern[pattern_idx])
+                        break;
+                    SM_STATS_SHIFT(pattern_idx - kmp_next[pattern_idx]);
                     pattern_idx = kmp_next[pattern_idx];
+                }
                 pattern_idx++;
                 text++;
                 if (pattern_idx >= (Long)pattern_len) {
@@ -0,0 +1,230 @@
+
+#ifndef STRING_MATCH_MULTI_PATTERN_H
+#define STRING_MATCH_MULTI_PATTERN_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/Teddy.h"
+#include "algorithm/FDR.h"
+#include "algorithm/CompactAhoCorasick.h"
+
+//
+// The front end of the multi-pattern engines, chooses one by the numbers of
+// the literals in compile():
+//
+//   1 - 64          Teddy (algorithm/Teddy.h)
+//   65 - 10,000     FDR (algorithm/FDR.h)
+//   more            AhoCorasick (Compact) (algorithm/CompactAhoCorasick.h)
+//
+// The interface is the same as the engines: add_pattern() / compile() /
+// search_all(). The order of the matches reported by search_all() and the
+// match returned by search() follow the engine: Teddy reports them by the
+// start positions, the others by the end positions.
+//
+
+namespace StringMatch {
+
+struct MultiPatternEngine {
+    enum Type {
+        None,
+        Teddy,
+        FDR,
+        CompactAC,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Teddy:     return "Teddy";
+            case FDR:       return "FDR";
+            case CompactAC: return "AhoCorasick (Compact)";
+            default:        return "None";
+        }
+    }
+};
+
+template <typename CharTy>
+class MultiPatternImpl {
+public:
+    typedef MultiPatternImpl<CharTy>    this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+
+    // Teddy and FDR are byte only.
+    static_assert(sizeof(CharTy) == 1, "MultiPatternImpl<CharTy>: only the byte strings are supported.");
+
+    static const size_type kMaxTeddyPatterns = TeddyImpl<CharTy>::kMaxPatterns;
+    static const size_type kMaxFdrPatterns = 10000;
+
+private:
+    struct keyword_type {
+        int id;
+        size_type offset;
+        size_type length;
+    };
+
+    std::vector<char_type> keyword_chars_;  // The patterns added, until compile().
+    std::vector<keyword_type> keywords_;
+
+    TeddyImpl<CharTy> teddy_;
+    FdrImpl<CharTy> fdr_;
+    CompactAhoCorasickImpl<CharTy> compact_ac_;
+    MultiPatternEngine::Type engine_;
+
+public:
+    MultiPatternImpl() : engine_(MultiPatternEngine::None) {}
+    ~MultiPatternImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "MultiPattern"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    MultiPatternEngine::Type engine() const { return this->engine_; }
+    const char * engine_name() const { return MultiPatternEngine::name(this->engine_); }
+
+    size_type state_count() const {
+        switch (this->engine_) {
+            case MultiPatternEngine::Teddy:     return this->teddy_.state_count();
+            case MultiPatternEngine::FDR:       return this->fdr_.state_count();
+            case MultiPatternEngine::CompactAC: return this->compact_ac_.state_count();
+            default:                            return 0;
+        }
+    }
+
+    size_type memory_usage() const {
+        switch (this->engine_) {
+            case MultiPatternEngine::Teddy:     return this->teddy_.memory_usage();
+            case MultiPatternEngine::FDR:       return this->fdr_.memory_usage();
+            case MultiPatternEngine::CompactAC: return this->compact_ac_.memory_usage();
+            default:                            return 0;
+        }
+    }
+
+    void destroy() {
+        this->keyword_chars_.clear();
+        this->keywords_.clear();
+        this->teddy_.destroy();
+        this->fdr_.destroy();
+        this->compact_ac_.destroy();
+        this->engine_ = MultiPatternEngine::None;
+    }
+
+    // Return false if the pattern is empty.
+    bool add_pattern(int id, const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (unlikely(length == 0))
+            return false;
+
+        keyword_type keyword;
+        keyword.id = id;
+        keyword.offset = this->keyword_chars_.size();
+        keyword.length = length;
+        this->keyword_chars_.insert(this->keyword_chars_.end(), pattern, pattern + length);
+        this->keywords_.push_back(keyword);
+        return true;
+    }
+
+    bool add_pattern(int id, const char_type * first, const char_type * last) {
+        assert(first <= last);
+        return this->add_pattern(id, first, (size_type)(last - first));
+    }
+
+    bool compile() {
+        const size_type num_patterns = this->keywords_.size();
+        if (unlikely(num_patterns == 0))
+            return false;
+
+        this->teddy_.destroy();
+        this->fdr_.destroy();
+        this->compact_ac_.destroy();
+
+        if (num_patterns <= kMaxTeddyPatterns) {
+            this->engine_ = MultiPatternEngine::Teddy;
+            return this->compile_engine(this->teddy_);
+        }
+        else if (num_patterns <= kMaxFdrPatterns) {
+            this->engine_ = MultiPatternEngine::FDR;
+            return this->compile_engine(this->fdr_);
+        }
+        else {
+            this->engine_ = MultiPatternEngine::CompactAC;
+            return this->compile_engine(this->compact_ac_);
+        }
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        this->destroy();
+        if (likely(this->add_pattern(0, pattern, length)))
+            return this->compile();
+        else
+            return false;
+    }
+
+    /* Searching all patterns, call callback(pattern_id, start, end) for every match, the range is [start, end). */
+    template <typename Callback>
+    size_type search_all(const char_type * text, size_type text_len, Callback && callback) const {
+        switch (this->engine_) {
+            case MultiPatternEngine::Teddy:
+                return this->teddy_.search_all(text, text_len, callback);
+            case MultiPatternEngine::FDR:
+                return this->fdr_.search_all(text, text_len, callback);
+            case MultiPatternEngine::CompactAC:
+                return this->compact_ac_.search_all(text, text_len, callback);
+            default:
+                return 0;
+        }
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        switch (this->engine_) {
+            case MultiPatternEngine::Teddy:
+                return this->teddy_.search(text, text_len, pattern, pattern_len);
+            case MultiPatternEngine::FDR:
+                return this->fdr_.search(text, text_len, pattern, pattern_len);
+            case MultiPatternEngine::CompactAC:
+                return this->compact_ac_.search(text, text_len, pattern, pattern_len);
+            default:
+                return Status::NotFound;
+        }
+    }
+
+private:
+    // The patterns are kept, so it can be compiled again after more patterns are added.
+    template <typename EngineTy>
+    bool compile_engine(EngineTy & engine) {
+        for (size_type i = 0; i < this->keywords_.size(); ++i) {
+            const keyword_type & keyword = this->keywords_[i];
+            if (!engine.add_pattern(keyword.id, &this->keyword_chars_[keyword.offset], keyword.length))
+                return false;
+        }
+        return engine.compile();
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< MultiPatternImpl<char> >  MultiPattern;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_MULTI_PATTERN_H
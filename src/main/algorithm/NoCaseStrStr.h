@@ -0,0 +1,424 @@
+
+#ifndef STRING_MATCH_NOCASE_STRSTR_H
+#define STRING_MATCH_NOCASE_STRSTR_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+#include <immintrin.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AutoStrStr.h"
+#include "support/CaseFold.h"
+#include "support/bitscan_forward.h"
+
+//
+// Case-insensitive substring searching, without a lowercase copy of the text.
+//
+// The ASCII path: the pattern is lowercased, and every byte of it has a fold
+// mask, 0x20 for the letters and 0 for the others. A byte of the text matches
+// if (byte | mask) equals the lowercased byte of the pattern, which is exact,
+// only 'A' and 'a' or-ed with 0x20 are 'a'. So the first/last char filter of
+// AvxStrStr (see: algorithm/AvxStrStr.h) is kept, with one more OR per load,
+// and the candidates are verified 8 bytes at a time.
+//
+// The UTF-8 path, CaseFold::Utf8 and a non-ASCII pattern: the text and the
+// pattern are decoded and compared by the simple case folding of Unicode
+// (see: support/CaseFold.h), one code point at a time, so it is much slower.
+// A match may have a different length of bytes from the pattern, e.g. the
+// KELVIN SIGN (U+212A, 3 bytes) matches 'k', but the cursor of
+// MatchMode::NonOverlapping still skips the length of the pattern. In the
+// ASCII path, the non-ASCII chars of the text are never folded into ASCII.
+//
+// Usage: AnsiString::NoCaseStrStr::Pattern pattern(str, len, CaseFold::Utf8);
+//
+
+namespace StringMatch {
+
+struct NoCaseKernel {
+    enum Type {
+        Scalar,
+        SSE42,
+        AVX2,
+        AVX512,
+        Utf8,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Scalar:    return "Scalar";
+            case SSE42:     return "SSE 4.2";
+            case AVX2:      return "AVX2";
+            case AVX512:    return "AVX-512";
+            case Utf8:      return "UTF-8";
+            default:        return "Unknown";
+        }
+    }
+};
+
+template <typename CharTy>
+class NoCaseStrStrImpl {
+public:
+    typedef NoCaseStrStrImpl<CharTy>    this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                        uchar_type;
+
+private:
+    std::string folded_;                // The lowercased pattern.
+    std::string fold_mask_;             // 0x20 for the letters, or else 0.
+    std::vector<uint32_t> code_points_; // The folded code points, only for the UTF-8 path.
+    CaseFold::Type fold_;
+    NoCaseKernel::Type kernel_;
+
+public:
+    NoCaseStrStrImpl() : fold_(CaseFold::Ascii), kernel_(NoCaseKernel::Scalar) {}
+    ~NoCaseStrStrImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "NoCaseStrStr"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+        this->folded_.clear();
+        this->fold_mask_.clear();
+        this->code_points_.clear();
+    }
+
+    CaseFold::Type case_fold() const { return this->fold_; }
+    NoCaseKernel::Type kernel() const { return this->kernel_; }
+
+    // Call it before preprocessing().
+    void set_case_fold(CaseFold::Type fold) {
+        this->fold_ = fold;
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+
+        this->folded_.resize(length);
+        this->fold_mask_.resize(length);
+        bool is_ascii = true;
+        for (size_type i = 0; i < length; ++i) {
+            uint32_t ch = (uchar_type)pattern[i];
+            this->folded_[i] = (char)detail::ascii_fold(ch);
+            this->fold_mask_[i] = (char)detail::ascii_fold_mask(ch);
+            is_ascii = is_ascii && (ch < 0x80);
+        }
+
+        this->code_points_.clear();
+        if (this->fold_ == CaseFold::Utf8 && !is_ascii) {
+            const uint8_t * s = (const uint8_t *)pattern;
+            size_type pos = 0;
+            while (pos < length) {
+                uint32_t cp;
+                pos += detail::utf8_decode(s + pos, length - pos, cp);
+                this->code_points_.push_back(detail::unicode_simple_fold(cp));
+            }
+            this->kernel_ = NoCaseKernel::Utf8;
+        }
+        else {
+            this->kernel_ = this_type::select();
+        }
+        return true;
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        assert(pattern_len == this->folded_.size());
+        SM_UNUSED_VAR(pattern);
+
+        if (unlikely(pattern_len == 0))
+            return 0;
+        if (this->kernel_ == NoCaseKernel::Utf8)
+            return this->search_utf8((const uint8_t *)text, text_len);
+        if (unlikely(pattern_len > text_len))
+            return Status::NotFound;
+
+        switch (this->kernel_) {
+#if STRING_MATCH_HAVE_AVX512BW
+            case NoCaseKernel::AVX512:
+                return this->search_avx512((const uint8_t *)text, text_len);
+#endif
+            case NoCaseKernel::AVX2:
+                return this->search_avx2((const uint8_t *)text, text_len);
+            case NoCaseKernel::SSE42:
+                return this->search_sse42((const uint8_t *)text, text_len);
+            default:
+                return this->search_scalar((const uint8_t *)text, 0, text_len - pattern_len + 1);
+        }
+    }
+
+private:
+    static NoCaseKernel::Type select() {
+#if STRING_MATCH_HAVE_AVX512BW
+        if (CpuInstrSet::has_avx512bw())
+            return NoCaseKernel::AVX512;
+#endif
+        if (CpuInstrSet::has_avx2())
+            return NoCaseKernel::AVX2;
+        if (CpuInstrSet::has_sse42())
+            return NoCaseKernel::SSE42;
+        return NoCaseKernel::Scalar;
+    }
+
+    static uint64_t load_u64(const void * p) {
+        uint64_t value;
+        ::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    // Compare the whole pattern with the text at candidate, case-insensitively.
+    bool verify(const uint8_t * candidate) const {
+        const size_type length = this->folded_.size();
+        const char * folded = this->folded_.data();
+        const char * mask = this->fold_mask_.data();
+        if (likely(length >= 8)) {
+            size_type i = 0;
+            for (; i + 8 <= length; i += 8) {
+                if ((load_u64(candidate + i) | load_u64(mask + i)) != load_u64(folded + i))
+                    return false;
+            }
+            // The last 8 bytes overlap the previous ones.
+            if (i < length) {
+                i = length - 8;
+                if ((load_u64(candidate + i) | load_u64(mask + i)) != load_u64(folded + i))
+                    return false;
+            }
+            return true;
+        }
+        for (size_type i = 0; i < length; ++i) {
+            if ((uint8_t)(candidate[i] | (uint8_t)mask[i]) != (uint8_t)folded[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Scan the candidate positions [first, last).
+    Long search_scalar(const uint8_t * text, size_type first, size_type last) const {
+        const size_type pattern_last = this->folded_.size() - 1;
+        const uint8_t first_char = (uint8_t)this->folded_[0];
+        const uint8_t first_mask = (uint8_t)this->fold_mask_[0];
+        const uint8_t last_char  = (uint8_t)this->folded_[pattern_last];
+        const uint8_t last_mask  = (uint8_t)this->fold_mask_[pattern_last];
+        for (size_type index = first; index < last; ++index) {
+            if (likely((uint8_t)(text[index] | first_mask) != first_char ||
+                       (uint8_t)(text[index + pattern_last] | last_mask) != last_char)) {
+                continue;
+            }
+            if (this->verify(text + index))
+                return (Long)index;
+        }
+        return Status::NotFound;
+    }
+
+    SM_TARGET_SSE42
+    Long search_sse42(const uint8_t * text, size_type text_len) const {
+        static const size_type kMaxSize = sizeof(__m128i);
+
+        const size_type pattern_last = this->folded_.size() - 1;
+        const size_type scan_len = text_len - pattern_last;
+        if (unlikely(scan_len < kMaxSize))
+            return this->search_scalar(text, 0, scan_len);
+
+        const __m128i __first      = _mm_set1_epi8(this->folded_[0]);
+        const __m128i __first_mask = _mm_set1_epi8(this->fold_mask_[0]);
+        const __m128i __last       = _mm_set1_epi8(this->folded_[pattern_last]);
+        const __m128i __last_mask  = _mm_set1_epi8(this->fold_mask_[pattern_last]);
+
+        // The last block overlaps the previous one, see: avx2_memmem().
+        const size_type last_block = scan_len - kMaxSize;
+        uint32_t skip_mask = 0xFFFFUL;
+        size_type index = 0;
+        do {
+            __m128i __block_first = _mm_loadu_si128((const __m128i *)(text + index));
+            __m128i __block_last  = _mm_loadu_si128((const __m128i *)(text + index + pattern_last));
+            __block_first = _mm_or_si128(__block_first, __first_mask);
+            __block_last  = _mm_or_si128(__block_last, __last_mask);
+
+            __m128i __eq_first = _mm_cmpeq_epi8(__first, __block_first);
+            __m128i __eq_last  = _mm_cmpeq_epi8(__last, __block_last);
+
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(__eq_first, __eq_last));
+            mask &= skip_mask;
+            while (unlikely(mask != 0)) {
+                unsigned long bit_pos;
+                __BitScanForward(bit_pos, mask);
+                if (this->verify(text + index + bit_pos))
+                    return (Long)(index + bit_pos);
+                mask &= (mask - 1);
+            }
+
+            if (likely(index < last_block)) {
+                size_type next_index = index + kMaxSize;
+                if (unlikely(next_index > last_block)) {
+                    skip_mask = (0xFFFFUL << (next_index - last_block)) & 0xFFFFUL;
+                    next_index = last_block;
+                }
+                index = next_index;
+            }
+            else break;
+        } while (1);
+
+        return Status::NotFound;
+    }
+
+    SM_TARGET_AVX2
+    Long search_avx2(const uint8_t * text, size_type text_len) const {
+        static const size_type kMaxSize = sizeof(__m256i);
+
+        const size_type pattern_last = this->folded_.size() - 1;
+        const size_type scan_len = text_len - pattern_last;
+        if (unlikely(scan_len < kMaxSize))
+            return this->search_scalar(text, 0, scan_len);
+
+        const __m256i __first      = _mm256_set1_epi8(this->folded_[0]);
+        const __m256i __first_mask = _mm256_set1_epi8(this->fold_mask_[0]);
+        const __m256i __last       = _mm256_set1_epi8(this->folded_[pattern_last]);
+        const __m256i __last_mask  = _mm256_set1_epi8(this->fold_mask_[pattern_last]);
+
+        const size_type last_block = scan_len - kMaxSize;
+        uint32_t skip_mask = 0xFFFFFFFFUL;
+        size_type index = 0;
+        do {
+            __m256i __block_first = _mm256_loadu_si256((const __m256i *)(text + index));
+            __m256i __block_last  = _mm256_loadu_si256((const __m256i *)(text + index + pattern_last));
+            __block_first = _mm256_or_si256(__block_first, __first_mask);
+            __block_last  = _mm256_or_si256(__block_last, __last_mask);
+
+            __m256i __eq_first = _mm256_cmpeq_epi8(__first, __block_first);
+            __m256i __eq_last  = _mm256_cmpeq_epi8(__last, __block_last);
+
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(__eq_first, __eq_last));
+            mask &= skip_mask;
+            while (unlikely(mask != 0)) {
+                unsigned long bit_pos;
+                __BitScanForward(bit_pos, mask);
+                if (this->verify(text + index + bit_pos))
+                    return (Long)(index + bit_pos);
+                mask &= (mask - 1);
+            }
+
+            if (likely(index < last_block)) {
+                size_type next_index = index + kMaxSize;
+                if (unlikely(next_index > last_block)) {
+                    skip_mask = 0xFFFFFFFFUL << (next_index - last_block);
+                    next_index = last_block;
+                }
+                index = next_index;
+            }
+            else break;
+        } while (1);
+
+        return Status::NotFound;
+    }
+
+#if STRING_MATCH_HAVE_AVX512BW
+    SM_TARGET_AVX512BW
+    Long search_avx512(const uint8_t * text, size_type text_len) const {
+        static const size_type kMaxSize = sizeof(__m512i);
+
+        const size_type pattern_last = this->folded_.size() - 1;
+        const size_type scan_len = text_len - pattern_last;
+
+        const __m512i __first      = _mm512_set1_epi8(this->folded_[0]);
+        const __m512i __first_mask = _mm512_set1_epi8(this->fold_mask_[0]);
+        const __m512i __last       = _mm512_set1_epi8(this->folded_[pattern_last]);
+        const __m512i __last_mask  = _mm512_set1_epi8(this->fold_mask_[pattern_last]);
+
+        // The tail is loaded with the mask registers, see: avx512_memmem().
+        size_type index = 0;
+        __mmask64 load_mask = ~(__mmask64)0;
+        do {
+            size_type remain = scan_len - index;
+            if (unlikely(remain < kMaxSize))
+                load_mask = (__mmask64)(((uint64_t)1 << remain) - 1);
+
+            __m512i __block_first = _mm512_maskz_loadu_epi8(load_mask, text + index);
+            __m512i __block_last  = _mm512_maskz_loadu_epi8(load_mask, text + index + pattern_last);
+            __block_first = _mm512_or_si512(__block_first, __first_mask);
+            __block_last  = _mm512_or_si512(__block_last, __last_mask);
+
+            __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(load_mask, __first, __block_first);
+            mask = _mm512_mask_cmpeq_epi8_mask(mask, __last, __block_last);
+            while (unlikely(mask != 0)) {
+                unsigned long bit_pos;
+                __BitScanForward64(bit_pos, (uint64_t)mask);
+                if (this->verify(text + index + bit_pos))
+                    return (Long)(index + bit_pos);
+                mask &= (__mmask64)(mask - 1);
+            }
+
+            index += kMaxSize;
+        } while (likely(index < scan_len));
+
+        return Status::NotFound;
+    }
+#endif // STRING_MATCH_HAVE_AVX512BW
+
+    // Whether the folded code points of the text at s are the ones of the pattern,
+    // from the second one.
+    bool verify_utf8(const uint8_t * s, size_type len) const {
+        size_type pos = 0;
+        for (size_type i = 1; i < this->code_points_.size(); ++i) {
+            if (unlikely(pos >= len))
+                return false;
+            uint32_t cp;
+            pos += detail::utf8_decode(s + pos, len - pos, cp);
+            if (detail::unicode_simple_fold(cp) != this->code_points_[i])
+                return false;
+        }
+        return true;
+    }
+
+    Long search_utf8(const uint8_t * text, size_type text_len) const {
+        const uint32_t first_cp = this->code_points_[0];
+        // Only the ASCII chars are folded into the ASCII chars.
+        const bool skip_ascii = (first_cp >= 0x80);
+        size_type pos = 0;
+        while (pos < text_len) {
+            if (skip_ascii) {
+                while (pos < text_len && text[pos] < 0x80)
+                    ++pos;
+                if (pos >= text_len)
+                    break;
+            }
+            uint32_t cp;
+            size_type n = detail::utf8_decode(text + pos, text_len - pos, cp);
+            if (detail::unicode_simple_fold(cp) == first_cp &&
+                this->verify_utf8(text + pos + n, text_len - pos - n)) {
+                return (Long)pos;
+            }
+            pos += n;
+        }
+        return Status::NotFound;
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< NoCaseStrStrImpl<char> >  NoCaseStrStr;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_NOCASE_STRSTR_H
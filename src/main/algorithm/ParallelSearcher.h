@@ -0,0 +1,234 @@
+
+#ifndef STRING_MATCH_PARALLEL_SEARCHER_H
+#define STRING_MATCH_PARALLEL_SEARCHER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <atomic>
+#include <vector>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "support/ThreadPool.h"
+
+//
+// ParallelSearcher: search a large buffer on a thread pool.
+//
+// The start positions of the text are split into chunks of chunk_size chars,
+// and every chunk is searched in the window [start, end + pattern_len - 1), so
+// the matches across the boundary are found by the lower chunk only once.
+// The threads take the chunks from low to high one by one.
+//
+// It works with any AlgorithmWrapper<T>, the compiled Pattern is shared by all
+// of the threads (search() is const and has no side effect).
+//
+
+namespace StringMatch {
+
+template <typename AlgorithmTy>
+class ParallelSearcher {
+public:
+    typedef ParallelSearcher<AlgorithmTy>       this_type;
+    typedef AlgorithmTy                         algorithm_type;
+    typedef typename AlgorithmTy::Pattern       pattern_type;
+    typedef typename AlgorithmTy::char_type     char_type;
+    typedef typename AlgorithmTy::size_type     size_type;
+
+    // About the size of the L2 cache.
+    static const size_type kDefaultChunkBytes = 256 * 1024;
+
+private:
+    ThreadPool pool_;
+    size_type chunk_size_;      // In chars.
+
+    struct Layout {
+        size_type chunk_size;
+        size_type chunks;
+        size_type scan_end;     // The numbers of the start positions.
+        size_type overlap;
+    };
+
+public:
+    // thread_num = 0 means std::thread::hardware_concurrency().
+    explicit ParallelSearcher(size_type thread_num = 0,
+                              size_type chunk_bytes = kDefaultChunkBytes)
+        : pool_(thread_num),
+          chunk_size_((chunk_bytes >= sizeof(char_type)) ? (chunk_bytes / sizeof(char_type)) : 1) {
+    }
+
+    ~ParallelSearcher() {}
+
+    ParallelSearcher(const ParallelSearcher &) = delete;
+    ParallelSearcher & operator = (const ParallelSearcher &) = delete;
+
+    size_type thread_count() const { return this->pool_.size(); }
+    size_type chunk_size() const { return this->chunk_size_; }
+
+    // Return the leftmost match. A chunk is skipped if a lower chunk has found
+    // a match before it, the chunks in flight below the match run to the end.
+    Long search(const pattern_type & pattern, const char_type * text, size_type text_len) {
+        assert(text != nullptr);
+        size_type pattern_len = pattern.size();
+        if (unlikely(pattern_len == 0 || pattern_len > text_len))
+            return pattern.match(text, text_len);
+
+        Layout layout = this->layout(text_len, pattern_len);
+        if (layout.chunks <= 1 || this->pool_.size() <= 1)
+            return pattern.match(text, text_len);
+
+        static const Long kNoMatch = (std::numeric_limits<Long>::max)();
+        std::atomic<size_type> next_chunk(0);
+        std::atomic<Long> leftmost(kNoMatch);
+
+        this->pool_.run([&](size_type thread_id) {
+            SM_UNUSED_VAR(thread_id);
+            for (;;) {
+                size_type chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= layout.chunks)
+                    break;
+                size_type start = chunk * layout.chunk_size;
+                // The chunks behind it start even higher, so stop.
+                if ((Long)start > leftmost.load(std::memory_order_relaxed))
+                    break;
+
+                size_type window = this_type::window_size(layout, text_len, start);
+                Long index_of = pattern.match(text + start, window);
+                if (index_of >= 0) {
+                    Long index = (Long)start + index_of;
+                    Long current = leftmost.load(std::memory_order_relaxed);
+                    while (index < current &&
+                           !leftmost.compare_exchange_weak(current, index, std::memory_order_relaxed)) {
+                        // Retry
+                    }
+                    break;
+                }
+            }
+        });
+
+        Long index = leftmost.load(std::memory_order_relaxed);
+        return ((index != kNoMatch) ? index : Status::NotFound);
+    }
+
+    // Append all of the matches in order to matches, return the numbers of them.
+    size_type search_all(const pattern_type & pattern, const char_type * text, size_type text_len,
+                         std::vector<Long> & matches,
+                         MatchMode::Type mode = MatchMode::Overlapping) {
+        assert(text != nullptr);
+        size_type pattern_len = pattern.size();
+        size_type old_size = matches.size();
+        if (unlikely(pattern_len == 0 || pattern_len > text_len))
+            return 0;
+
+        Layout layout = this->layout(text_len, pattern_len);
+        if (layout.chunks <= 1 || this->pool_.size() <= 1) {
+            pattern.match_all(text, text_len, [&matches](Long index_of) {
+                matches.push_back(index_of);
+            }, mode);
+            return (matches.size() - old_size);
+        }
+
+        // Every chunk reports the overlapping matches, the non-overlapping
+        // matches are picked up from them in order at the end.
+        std::vector<std::vector<Long>> chunk_matches(layout.chunks);
+        std::atomic<size_type> next_chunk(0);
+
+        this->pool_.run([&](size_type thread_id) {
+            SM_UNUSED_VAR(thread_id);
+            for (;;) {
+                size_type chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= layout.chunks)
+                    break;
+                size_type start = chunk * layout.chunk_size;
+                size_type window = this_type::window_size(layout, text_len, start);
+                std::vector<Long> & found = chunk_matches[chunk];
+                pattern.match_all(text + start, window, [&found, start](Long index_of) {
+                    found.push_back((Long)start + index_of);
+                }, MatchMode::Overlapping);
+            }
+        });
+
+        Long next_allowed = 0;
+        for (size_type chunk = 0; chunk < layout.chunks; ++chunk) {
+            const std::vector<Long> & found = chunk_matches[chunk];
+            for (size_type i = 0; i < found.size(); ++i) {
+                if (mode == MatchMode::Overlapping) {
+                    matches.push_back(found[i]);
+                }
+                else if (found[i] >= next_allowed) {
+                    matches.push_back(found[i]);
+                    next_allowed = found[i] + (Long)pattern_len;
+                }
+            }
+        }
+        return (matches.size() - old_size);
+    }
+
+    // Return the numbers of the matches.
+    size_type count(const pattern_type & pattern, const char_type * text, size_type text_len,
+                    MatchMode::Type mode = MatchMode::Overlapping) {
+        assert(text != nullptr);
+        size_type pattern_len = pattern.size();
+        if (unlikely(pattern_len == 0 || pattern_len > text_len))
+            return 0;
+
+        Layout layout = this->layout(text_len, pattern_len);
+        if (mode != MatchMode::Overlapping || layout.chunks <= 1 || this->pool_.size() <= 1) {
+            std::vector<Long> matches;
+            return this->search_all(pattern, text, text_len, matches, mode);
+        }
+
+        std::atomic<size_type> next_chunk(0);
+        std::atomic<size_type> total(0);
+
+        this->pool_.run([&](size_type thread_id) {
+            SM_UNUSED_VAR(thread_id);
+            size_type sum = 0;
+            for (;;) {
+                size_type chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= layout.chunks)
+                    break;
+                size_type start = chunk * layout.chunk_size;
+                size_type window = this_type::window_size(layout, text_len, start);
+                sum += pattern.count(text + start, window, MatchMode::Overlapping);
+            }
+            total.fetch_add(sum, std::memory_order_relaxed);
+        });
+
+        return total.load(std::memory_order_relaxed);
+    }
+
+private:
+    Layout layout(size_type text_len, size_type pattern_len) const {
+        assert(pattern_len != 0 && pattern_len <= text_len);
+        Layout layout;
+        // The chunk must be larger than the overlap, or it's too wasteful.
+        layout.chunk_size = (this->chunk_size_ >= pattern_len) ? this->chunk_size_ : pattern_len;
+        layout.scan_end = text_len - pattern_len + 1;
+        layout.chunks = (layout.scan_end + layout.chunk_size - 1) / layout.chunk_size;
+        layout.overlap = pattern_len - 1;
+        return layout;
+    }
+
+    static size_type window_size(const Layout & layout, size_type text_len, size_type start) {
+        size_type end = start + layout.chunk_size;
+        if (end > layout.scan_end)
+            end = layout.scan_end;
+        size_type window = end - start + layout.overlap;
+        assert(start + window <= text_len);
+        SM_UNUSED_VAR(text_len);
+        return window;
+    }
+};
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_PARALLEL_SEARCHER_H
@@ -12,6 +12,7 @@
 
 #include "StringMatch.h"
 #include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AlgorithmUtils.h"
 
 //
 // See: http://www-igm.univ-mlv.fr/~lecroq/string/node19.html#SECTION00190
@@ -27,6 +28,7 @@ public:
     typedef std::size_t             size_type;
     typedef typename jstd::uchar_traits<CharTy>::type
                                     uchar_type;
+    typedef BadCharHash<CharTy>     hash_type;
 
     static const size_t kMaxAscii = 256;
 
@@ -56,7 +58,7 @@ public:
             this->qsBc_[i] = (int)(length + 1);
         }
         for (Long i = 0; i < (Long)length; ++i) {
-            this->qsBc_[(uchar_type)pattern[i]] = (int)(length - i);
+            this->qsBc_[hash_type::index(pattern[i])] = (int)(length - i);
         }
 
         return true;
@@ -69,8 +71,9 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
-            int * shift = (int *)&this->qsBc_[0];
+            const int * shift = &this->qsBc_[0];
             assert(shift != nullptr);
 
             const char_type * pattern_end = pattern + pattern_len;
@@ -82,12 +85,14 @@ public:
                 register const char_type * target = pattern + pattern_last;
                 assert(source >= text && source < (text + text_len));
 
-                // Save the next char of the last compare char.
-                uchar_type next_char = (uchar_type)*(source + 1);
-
                 while (likely(target >= pattern)) {
+                    SM_STATS_INC(comparisons);
                     if (likely(*source != *target)) {
-                        index += shift[next_char];
+                        // It's the last window, the next char is out of the text.
+                        if (unlikely(index >= scan_len))
+                            return Status::NotFound;
+                        SM_STATS_SHIFT(shift[hash_type::index(text[index + pattern_len])]);
+                        index += shift[hash_type::index(text[index + pattern_len])];
                         break;
                     }
                     source--;
@@ -103,6 +108,66 @@ public:
 
         return Status::NotFound;
     }
+
+    struct cursor_type {
+        Long index;             // The offset of text to be compared.
+
+        cursor_type() : index(0) {}
+    };
+
+    /* Searching the next match, continue from the cursor. */
+    SM_NOINLINE_DECLARE(Long)
+    search_next(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len,
+                cursor_type & cursor, MatchMode::Type mode) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        assert(pattern_len != 0);
+
+        SM_STATS_INC(searches);
+        if (likely(pattern_len <= text_len)) {
+            const int * shift = &this->qsBc_[0];
+            assert(shift != nullptr);
+
+            const Long scan_len = (Long)(text_len - pattern_len);
+            const Long pattern_last = (Long)pattern_len - 1;
+            Long index = cursor.index;
+            while (likely(index <= scan_len)) {
+                register const char_type * source = text + pattern_last + index;
+                register const char_type * target = pattern + pattern_last;
+                assert(source >= text && source < (text + text_len));
+
+                while (likely(target >= pattern)) {
+                    SM_STATS_INC(comparisons);
+                    if (likely(*source != *target)) {
+                        // It's the last window, the next char is out of the text.
+                        if (unlikely(index >= scan_len)) {
+                            index = scan_len + 1;
+                            break;
+                        }
+                        SM_STATS_SHIFT(shift[hash_type::index(text[index + pattern_len])]);
+                        index += shift[hash_type::index(text[index + pattern_len])];
+                        break;
+                    }
+                    source--;
+                    target--;
+                    if (likely(target < pattern)) {
+                        // Has found, the shift of next char is also safe for a full match.
+                        assert(index >= 0 && index < (Long)text_len);
+                        if (mode == MatchMode::Overlapping)
+                            cursor.index = (index < scan_len) ? (index + shift[hash_type::index(text[index + pattern_len])])
+                                                              : (scan_len + 1);
+                        else
+                            cursor.index = index + (Long)pattern_len;
+                        return index;
+                    }
+                }
+            }
+            cursor.index = index;
+        }
+
+        return Status::NotFound;
+    }
 };
 
 namespace AnsiString {
@@ -113,6 +178,14 @@ namespace UnicodeString {
     typedef AlgorithmWrapper< QuickSearchImpl<wchar_t> >    QuickSearch;
 }
 
+namespace Utf16String {
+    typedef AlgorithmWrapper< QuickSearchImpl<char16_t> >   QuickSearch;
+}
+
+namespace Utf32String {
+    typedef AlgorithmWrapper< QuickSearchImpl<char32_t> >   QuickSearch;
+}
+
 } // namespace StringMatch
 
 #endif // STRING_MATCH_QUICK_SEARCH_H
@@ -102,6 +102,7 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
             const char_type * text_first = text;
 #if 1
@@ -128,6 +129,7 @@ public:
 search_start:
 #endif
             size_type offset = text - text_first;
+            SM_STATS_SHIFT(offset);
             ssize_t scan_len = ssize_t(text_len - offset - pattern_len);
             if (scan_len < 0) {
                 return Status::NotFound;
@@ -142,14 +144,18 @@ search_start:
             while (text <= text_limit) {
                 // Double check: a + bcd + e, abcd
                 if (unlikely(hash_code == this->pattern_hash_)) {
+                    SM_STATS_INC(filter_hits);
+                    SM_STATS_INC(verifications);
                     if (::memcmp((const void *)text, (const void *)&pattern[0],
                                  pattern_len * sizeof(char_type)) == 0) {
                         return Long(text - text_first);
                     }
+                    SM_STATS_INC(false_positives);
                 }
 
                 // Move the hash value to next char.
                 hash_code = next_hash(hash_code, *text, *(text + pattern_len));
+                SM_STATS_SHIFT(1);
                 text++;
             }
         }
@@ -8,55 +8,45 @@
 
 #include <nmmintrin.h>  // For SSE 4.2
 
+#include <cstddef>
+
 namespace StringMatch {
 
-template <typename CharTy>
-struct SSEHelper {
-    static const int _SIDD_CHAR_OPS = _SIDD_UBYTE_OPS;
-    static const int kMaxSize = 16;
-    static const int kWordSize = 1;
+//
+// The SSE 4.2 string instructions (pcmpistri, pcmpestri) only support the 8 bits
+// and the 16 bits chars, so the helper is selected by the size of char: wchar_t
+// is 16 bits on Windows, and it's 32 bits on gcc and clang, which has no helper,
+// so a 32 bits char is a compile error instead of being searched as the pairs
+// of 16 bits chars.
+//
+template <std::size_t CharSize>
+struct SSEHelperOfSize {
 };
 
 template <>
-struct SSEHelper<char> {
+struct SSEHelperOfSize<1> {
     static const int _SIDD_CHAR_OPS = _SIDD_UBYTE_OPS;
     static const int kMaxSize = 16;
     static const int kWordSize = 1;
-};
 
-template <>
-struct SSEHelper<signed char> {
-    static const int _SIDD_CHAR_OPS = _SIDD_UBYTE_OPS;
-    static const int kMaxSize = 16;
-    static const int kWordSize = 1;
-};
-
-template <>
-struct SSEHelper<unsigned char> {
-    static const int _SIDD_CHAR_OPS = _SIDD_UBYTE_OPS;
-    static const int kMaxSize = 16;
-    static const int kWordSize = 1;
+    // The chars equal, e.g. find the '\0' of a pattern.
+    static __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a, b); }
 };
 
 template <>
-struct SSEHelper<short> {
+struct SSEHelperOfSize<2> {
     static const int _SIDD_CHAR_OPS = _SIDD_UWORD_OPS;
     static const int kMaxSize = 8;
     static const int kWordSize = 2;
-};
 
-template <>
-struct SSEHelper<unsigned short> {
-    static const int _SIDD_CHAR_OPS = _SIDD_UWORD_OPS;
-    static const int kMaxSize = 8;
-    static const int kWordSize = 2;
+    // Not _mm_cmpeq_epi8(), a zero byte (e.g. the high byte of an ASCII char)
+    // isn't a '\0' of the 16 bits chars.
+    static __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
 };
 
-template <>
-struct SSEHelper<wchar_t> {
-    static const int _SIDD_CHAR_OPS = _SIDD_UWORD_OPS;
-    static const int kMaxSize = 8;
-    static const int kWordSize = 2;
+// char, signed char, unsigned char, short, unsigned short, wchar_t, char16_t.
+template <typename CharTy>
+struct SSEHelper : public SSEHelperOfSize<sizeof(CharTy)> {
 };
 
 } // namespace StringMatch
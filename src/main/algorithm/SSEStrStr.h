@@ -61,6 +61,7 @@ strstr_sse42(const char_type * text, const char_type * pattern,
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1a(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -90,7 +91,7 @@ strstr_sse42_v1a(const char_type * text, const char_type * pattern) {
     // pmovmskb     edx,  xmm1
     //__zero = _mm_xor_si128(__zero, __zero);
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
     //offset = _mm_movemask_epi8(__mask);
     
     //_mm_store_si128((__m128i *)mask_128i, __mask);
@@ -253,6 +254,7 @@ STRSTR_MAIN_LOOP:
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1b(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -282,7 +284,7 @@ strstr_sse42_v1b(const char_type * text, const char_type * pattern) {
     // pmovmskb     edx,  xmm1
     //__zero = _mm_xor_si128(__zero, __zero);
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
     //offset = _mm_movemask_epi8(__mask);
     
     //_mm_store_si128((__m128i *)mask_128i, __mask);
@@ -399,6 +401,7 @@ STRSTR_MAIN_LOOP:
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1c(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -425,7 +428,7 @@ strstr_sse42_v1c(const char_type * text, const char_type * pattern) {
     __pattern = _mm_loadu_si128((const __m128i *)pattern);
 
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
 
     uint64_t * mask_128i = (uint64_t *)&__mask;
     if (likely(mask_128i[0] != 0 || mask_128i[1] != 0)) {
@@ -534,6 +537,7 @@ STRSTR_MAIN_LOOP:
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1c2(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -560,7 +564,7 @@ strstr_sse42_v1c2(const char_type * text, const char_type * pattern) {
     __pattern = _mm_loadu_si128((const __m128i *)pattern);
 
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
 
     uint64_t * mask_128i = (uint64_t *)&__mask;
     if (likely(mask_128i[0] != 0 || mask_128i[1] != 0)) {
@@ -668,6 +672,7 @@ STRSTR_MAIN_LOOP:
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1d(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -693,7 +698,7 @@ strstr_sse42_v1d(const char_type * text, const char_type * pattern) {
     __pattern = _mm_loadu_si128((const __m128i *)pattern);
 
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
     
     uint64_t * mask_128i = (uint64_t *)&__mask;
     if (likely(mask_128i[0] != 0 || mask_128i[1] != 0)) {
@@ -803,6 +808,7 @@ STRSTR_MAIN_LOOP:
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1e(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -828,7 +834,7 @@ strstr_sse42_v1e(const char_type * text, const char_type * pattern) {
     __pattern = _mm_loadu_si128((const __m128i *)pattern);
 
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
     
     uint64_t * mask_128i = (uint64_t *)&__mask;
     if (likely(mask_128i[0] != 0 || mask_128i[1] != 0)) {
@@ -949,6 +955,9 @@ public:
     typedef CharTy                  char_type;
     typedef std::size_t             size_type;
 
+    // Search by the strstr() family, the text must be null-terminated.
+    static const bool kNullTerminated = true;
+
     SSEStrStrImpl() {}
     ~SSEStrStrImpl() {
         this->destroy();
@@ -987,14 +996,67 @@ public:
     }
 };
 
+//
+// The length-aware version of SSEStrStr by memmem_sse42(), it honours text_len
+// and pattern_len, so the text may contain '\0' and needn't be null-terminated.
+//
+// The string instructions only support the 8 bits and 16 bits chars (see
+// SSEHelper), so AnsiString and Utf16String are provided.
+//
+template <typename CharTy>
+class SSEMemMemImpl {
+public:
+    typedef SSEMemMemImpl<CharTy>   this_type;
+    typedef CharTy                  char_type;
+    typedef std::size_t             size_type;
+
+    SSEMemMemImpl() {}
+    ~SSEMemMemImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "memmem_sse42()"; }
+    static bool need_preprocessing() { return false; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        /* Don't need to do preprocessing. */
+        SM_UNUSED_VAR(pattern);
+        SM_UNUSED_VAR(length);
+        return true;
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        const char_type * substr = memmem_sse42(text, text_len, pattern, pattern_len);
+        if (likely(substr != nullptr))
+            return (Long)(substr - text);
+        else
+            return Status::NotFound;
+    }
+};
+
 namespace AnsiString {
     typedef AlgorithmWrapper< SSEStrStrImpl<char> >     SSEStrStr;
+    typedef AlgorithmWrapper< SSEMemMemImpl<char> >     SSEMemMem;
 }
 
 namespace UnicodeString {
     typedef AlgorithmWrapper< SSEStrStrImpl<wchar_t> >  SSEStrStr;
 }
 
+namespace Utf16String {
+    typedef AlgorithmWrapper< SSEMemMemImpl<char16_t> > SSEMemMem;
+}
+
 } // namespace StringMatch
 
 #endif // STRING_MATCH_SSE_STRSTR_H
@@ -68,6 +68,7 @@ namespace StringMatch {
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v2a(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -106,7 +107,7 @@ strstr_sse42_v2a(const char_type * text, const char_type * pattern) {
     // pmovmskb     edx,  xmm1
     //__zero = _mm_xor_si128(__zero, __zero);
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
 
     uint64_t * mask_128i = (uint64_t *)&__mask;
     if (likely(mask_128i[0] != 0 || mask_128i[1] != 0)) {
@@ -214,6 +215,7 @@ strstr_sse42_v2a(const char_type * text, const char_type * pattern) {
 //
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v2b(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -298,6 +300,7 @@ strstr_sse42_v2b(const char_type * text, const char_type * pattern) {
 //
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v2(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -394,6 +397,9 @@ public:
     typedef CharTy                  char_type;
     typedef std::size_t             size_type;
 
+    // Search by the strstr() family, the text must be null-terminated.
+    static const bool kNullTerminated = true;
+
     SSEStrStr2Impl() {}
     ~SSEStrStr2Impl() {
         this->destroy();
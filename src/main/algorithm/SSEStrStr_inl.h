@@ -12,6 +12,7 @@ namespace StringMatch {
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -41,7 +42,7 @@ strstr_sse42(const char_type * text, const char_type * pattern) {
     // pmovmskb     edx,  xmm1
     //__zero = _mm_xor_si128(__zero, __zero);
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
     //offset = _mm_movemask_epi8(__mask);
     
     //_mm_store_si128((__m128i *)mask_128i, __mask);
@@ -174,6 +175,7 @@ STRSTR_MAIN_LOOP:
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1_old(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -203,7 +205,7 @@ strstr_sse42_v1_old(const char_type * text, const char_type * pattern) {
     // pmovmskb     edx,  xmm1
     //__zero = _mm_xor_si128(__zero, __zero);
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
     //offset = _mm_movemask_epi8(__mask);
     
     //_mm_store_si128((__m128i *)mask_128i, __mask);
@@ -336,6 +338,7 @@ STRSTR_MAIN_LOOP:
 
 template <typename char_type>
 static
+SM_TARGET_SSE42
 SM_NOINLINE_DECLARE(const char_type *)
 strstr_sse42_v1(const char_type * text, const char_type * pattern) {
     static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
@@ -366,7 +369,7 @@ strstr_sse42_v1(const char_type * text, const char_type * pattern) {
     // pmovmskb     edx,  xmm1
     //__zero = _mm_xor_si128(__zero, __zero);
     __zero = _mm_setzero_si128();
-    __mask = _mm_cmpeq_epi8(__pattern, __zero);
+    __mask = SSEHelper<char_type>::cmpeq(__pattern, __zero);
     //offset = _mm_movemask_epi8(__mask);
     
     //_mm_store_si128((__m128i *)mask_128i, __mask);
@@ -516,3 +519,160 @@ STRSTR_MAIN_LOOP:
 #endif // STRING_MATCH_SSE_STRSTR_INL_H
 
 #endif // STRING_MATCH_SSE_STRSTR_H
+
+//
+// The strstr_sse42() versions above are only compiled when this file is included
+// alone, the length-aware versions below are always compiled (by SSEStrStr.h).
+//
+
+#ifndef STRING_MATCH_SSE_MEMMEM_INL_H
+#define STRING_MATCH_SSE_MEMMEM_INL_H
+
+namespace StringMatch {
+
+//
+// The length-aware versions, the lengths are given by the caller (not by '\0'),
+// so the text and the pattern may contain '\0' (e.g. the binary protocol buffers).
+// They use the explicit length instructions _mm_cmpestri() instead of _mm_cmpistri().
+//
+
+//
+// Load the first len (0 < len < kMaxSize) chars of p, the chars after len are
+// undefined. The 16 bytes are read in the page of p if they fit in it, otherwise
+// the 16 bytes end at (p + len) are read and shifted down, so it never reads
+// across the end of a buffer into an unmapped page. (AddressSanitizer reports
+// the bytes read after the buffer in the same page, they are harmless.)
+//
+template <typename char_type>
+static inline
+SM_TARGET_SSE42
+__m128i sse42_load_partial(const char_type * p, int len) {
+    static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
+    static const uintptr_t kPageSize = 4096;
+
+    // The index of pshufb, 0x80 writes a zero.
+    static const uint8_t kShiftMask[32] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+    };
+
+    assert(len > 0 && len < kMaxSize);
+    if (likely(((uintptr_t)p & (kPageSize - 1)) <= (kPageSize - 16))) {
+        return _mm_loadu_si128((const __m128i *)p);
+    }
+    else {
+        int shift = (kMaxSize - len) * (int)sizeof(char_type);
+        __m128i data = _mm_loadu_si128((const __m128i *)(p + len - kMaxSize));
+        __m128i mask = _mm_loadu_si128((const __m128i *)&kShiftMask[shift]);
+        return _mm_shuffle_epi8(data, mask);
+    }
+}
+
+//
+// Verify the chars after the first kMaxSize chars, pattern_len > kMaxSize.
+// The last block is the last kMaxSize chars, it overlaps the chars have been verified.
+//
+template <typename char_type>
+static inline
+SM_TARGET_SSE42
+bool memmem_sse42_verify(const char_type * text, const char_type * pattern,
+                         size_t pattern_len) {
+    static const size_t kMaxSize = SSEHelper<char_type>::kMaxSize;
+
+    assert(pattern_len > kMaxSize);
+    size_t i = kMaxSize;
+    for (; (i + kMaxSize) <= pattern_len; i += kMaxSize) {
+        __m128i __text    = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i __pattern = _mm_loadu_si128((const __m128i *)(pattern + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(__text, __pattern)) != 0xFFFF)
+            return false;
+    }
+    if (i < pattern_len) {
+        i = pattern_len - kMaxSize;
+        __m128i __text    = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i __pattern = _mm_loadu_si128((const __m128i *)(pattern + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(__text, __pattern)) != 0xFFFF)
+            return false;
+    }
+    return true;
+}
+
+template <typename char_type>
+static
+SM_TARGET_SSE42
+SM_NOINLINE_DECLARE(const char_type *)
+memmem_sse42(const char_type * text, size_t text_len,
+             const char_type * pattern, size_t pattern_len) {
+    static const int kMaxSize = SSEHelper<char_type>::kMaxSize;
+    static const int _SIDD_CHAR_OPS = SSEHelper<char_type>::_SIDD_CHAR_OPS;
+
+    static const int kEqualOrdered = _SIDD_CHAR_OPS | _SIDD_CMP_EQUAL_ORDERED
+                                   | _SIDD_POSITIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT;
+
+    assert(text != nullptr);
+    assert(pattern != nullptr);
+
+    if (unlikely(pattern_len == 0))
+        return text;
+    if (unlikely(pattern_len > text_len))
+        return nullptr;
+
+    // The first kMaxSize (16 or 8) chars of pattern are searched by pcmpestri,
+    // the rest are verified by memmem_sse42_verify().
+    __m128i __text, __pattern;
+    int head_len;
+    if (likely(pattern_len >= (size_t)kMaxSize)) {
+        head_len = kMaxSize;
+        __pattern = _mm_loadu_si128((const __m128i *)pattern);
+    }
+    else {
+        head_len = (int)pattern_len;
+        __pattern = sse42_load_partial(pattern, head_len);
+    }
+
+    const size_t scan_len = text_len - pattern_len;
+    size_t pos = 0;
+    int text_block = kMaxSize;
+    while (pos <= scan_len) {
+        if (likely((text_len - pos) >= (size_t)kMaxSize)) {
+            __text = _mm_loadu_si128((const __m128i *)(text + pos));
+        }
+        else {
+            text_block = (int)(text_len - pos);
+            __text = sse42_load_partial(text + pos, text_block);
+        }
+
+        // The index of the first char of the first full match, or of a partial
+        // match at the end of the block, or kMaxSize if no match.
+        int offset = _mm_cmpestri(__pattern, head_len, __text, text_block, kEqualOrdered);
+        if (likely(offset >= kMaxSize)) {
+            pos += kMaxSize;
+            continue;
+        }
+
+        pos += offset;
+        if (unlikely(pos > scan_len))
+            break;
+
+        if (unlikely((offset + head_len) > text_block)) {
+            // A partial match at the end of the block (offset > 0),
+            // load the next block begin at it.
+            continue;
+        }
+
+        if (likely(pattern_len <= (size_t)kMaxSize) ||
+            memmem_sse42_verify(text + pos, pattern, pattern_len)) {
+            // Has found
+            return (text + pos);
+        }
+        pos++;
+    }
+
+    return nullptr;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_SSE_MEMMEM_INL_H
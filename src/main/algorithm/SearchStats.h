@@ -0,0 +1,118 @@
+
+#ifndef STRING_MATCH_SEARCH_STATS_H
+#define STRING_MATCH_SEARCH_STATS_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+
+#include <cstdint>
+#include <cstddef>
+
+//
+// The internal statistics of the searching, to explain how an algorithm behaves
+// on a kind of text (e.g. the short shifts and the false positive verifications
+// on the low-entropy texts).
+//
+// They are compiled only if STRING_MATCH_ENABLE_STATS is 1 (the CMake option
+// STRING_MATCH_ENABLE_STATS), otherwise the SM_STATS_XXX() macros expand to
+// nothing and the search loops are the same as before.
+//
+// The statistics are kept per algorithm (the Impl type) and per thread, read
+// and reset them by AlgorithmWrapper<Impl>::stats() and reset_stats().
+//
+
+#ifndef STRING_MATCH_ENABLE_STATS
+#define STRING_MATCH_ENABLE_STATS   0
+#endif
+
+namespace StringMatch {
+
+struct SearchStats {
+    uint64_t searches;          // The calls of search(), search_next() and search_stream().
+    uint64_t comparisons;       // The chars compared one by one (memcmp() isn't counted),
+                                // or the chars scanned by the bit-parallel algorithms.
+    uint64_t shifts;            // The moves of the window.
+    uint64_t shift_total;       // The total chars of the moves.
+    uint64_t filter_hits;       // The windows passed the filter (the hash, the sum, the last char).
+    uint64_t verifications;     // The verifications of the candidate windows.
+    uint64_t false_positives;   // The verifications failed.
+
+    SearchStats() {
+        this->reset();
+    }
+
+    void reset() {
+        this->searches = 0;
+        this->comparisons = 0;
+        this->shifts = 0;
+        this->shift_total = 0;
+        this->filter_hits = 0;
+        this->verifications = 0;
+        this->false_positives = 0;
+    }
+
+    void add_shift(int64_t length) {
+        if (length > 0) {
+            this->shifts++;
+            this->shift_total += (uint64_t)length;
+        }
+    }
+
+    double average_shift() const {
+        return ((this->shifts != 0) ? ((double)this->shift_total / (double)this->shifts) : 0.0);
+    }
+
+    // The ratio of the failed verifications.
+    double false_positive_rate() const {
+        return ((this->verifications != 0) ?
+                ((double)this->false_positives / (double)this->verifications) : 0.0);
+    }
+
+    SearchStats & operator += (const SearchStats & other) {
+        this->searches += other.searches;
+        this->comparisons += other.comparisons;
+        this->shifts += other.shifts;
+        this->shift_total += other.shift_total;
+        this->filter_hits += other.filter_hits;
+        this->verifications += other.verifications;
+        this->false_positives += other.false_positives;
+        return *this;
+    }
+};
+
+//
+// The statistics of the calling thread, keyed by the Impl type.
+//
+template <typename AlgorithmImpl>
+struct SearchStatsOf {
+    static SearchStats & get() {
+        static thread_local SearchStats stats;
+        return stats;
+    }
+};
+
+} // namespace StringMatch
+
+//
+// Used in the member functions of an Impl (key is this_type), or in a free
+// function with an explicit key by the SM_STATS_XXX_OF() versions.
+//
+#if STRING_MATCH_ENABLE_STATS
+#define SM_STATS_ADD_OF(key, field, n)  (void)(::StringMatch::SearchStatsOf<key>::get().field += (uint64_t)(n))
+#define SM_STATS_SHIFT_OF(key, n)       ::StringMatch::SearchStatsOf<key>::get().add_shift((int64_t)(n))
+#else
+#define SM_STATS_ADD_OF(key, field, n)  ((void)0)
+#define SM_STATS_SHIFT_OF(key, n)       ((void)0)
+#endif // STRING_MATCH_ENABLE_STATS
+
+#define SM_STATS_INC_OF(key, field)     SM_STATS_ADD_OF(key, field, 1)
+
+#define SM_STATS_ADD(field, n)          SM_STATS_ADD_OF(this_type, field, n)
+#define SM_STATS_INC(field)             SM_STATS_ADD_OF(this_type, field, 1)
+#define SM_STATS_SHIFT(n)               SM_STATS_SHIFT_OF(this_type, n)
+
+#endif // STRING_MATCH_SEARCH_STATS_H
@@ -12,6 +12,11 @@
 #include "StringMatch.h"
 #include "algorithm/AlgorithmWrapper.h"
 
+//
+// The pattern is limited to the bits of mask_type (kMaxPatternLen), preprocessing()
+// returns false for a longer one, and search() returns Status::InvalidParameter.
+//
+
 namespace StringMatch {
 
 template <typename CharTy, typename MaskTy = uint64_t>
@@ -25,6 +30,7 @@ public:
                                                 uchar_type;
 
     static const size_type kMaxAscii = 256;
+    static const size_type kMaxPatternLen = sizeof(mask_type) * 8;
 
 private:
     mask_type mask_;
@@ -56,12 +62,15 @@ public:
 #endif
 
         mask_type mask = 1;
+        mask_type last_mask = 0;
         for (size_type i = 0; i < length; ++i) {
             this->bitmap_[(uchar_type)pattern[i]] |= mask;
+            // The mask is shifted out when length = the bits of mask_type.
+            last_mask = mask;
             mask <<= 1;
         }
-        this->mask_ = mask >> 1;
-        return true;
+        this->mask_ = last_mask;
+        return (length <= kMaxPatternLen);
     }
 
     /* Searching */
@@ -71,14 +80,20 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        // The longer pattern is truncated by preprocessing(), don't report its false matches.
+        if (unlikely(pattern_len > kMaxPatternLen))
+            return Status::InvalidParameter;
+
         mask_type mask = this->mask_;
         const mask_type * bitmap = &this->bitmap_[0];
 
         assert(bitmap != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
             register mask_type state = 0;
             for (size_type i = 0; i < text_len; ++i) {
+                SM_STATS_INC(comparisons);
                 state = ((state << 1) | 1) & bitmap[(uchar_type)text[i]];
                 if (unlikely((state & mask) != 0))
                     return (Long)(i + 1 - pattern_len);
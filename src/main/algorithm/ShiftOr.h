@@ -15,6 +15,10 @@
 //
 // See: http://www-igm.univ-mlv.fr/~lecroq/string/node6.html#SECTION0060
 //
+// The pattern is limited to the bits of mask_type (kMaxPatternLen), preprocessing()
+// returns false for a longer one, and search() returns Status::InvalidParameter.
+// Use ShiftOrWide (algorithm/ShiftOrWide.h) for the patterns up to 512 chars.
+//
 
 namespace StringMatch {
 
@@ -29,6 +33,7 @@ public:
                                             uchar_type;
 
     static const size_type kMaxAscii = 256;
+    static const size_type kMaxPatternLen = sizeof(mask_type) * 8;
 
 private:
     mask_type limit_;
@@ -69,7 +74,7 @@ public:
         limit = ~(limit >> 1);
 
         this->limit_ = limit;
-        return true;
+        return (length <= kMaxPatternLen);
     }
 
     /* Searching */
@@ -79,17 +84,23 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        // The longer pattern is truncated by preprocessing(), don't report its false matches.
+        if (unlikely(pattern_len > kMaxPatternLen))
+            return Status::InvalidParameter;
+
         mask_type limit = this->limit_;
         const mask_type * bitmap = &this->bitmap_[0];
 
         assert(bitmap != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
 #if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
  || defined(_M_IA64) || defined(_M_ARM64) || defined(__amd64__) || defined(__x86_64__)
   #if 1
             register mask_type state = ~0;
             for (size_type i = 0; i < text_len; ++i) {
+                SM_STATS_INC(comparisons);
                 state = (state << 1) | bitmap[(uchar_type)text[i]];
                 if (unlikely(state < limit))
                     return (Long)(i + 1 - pattern_len);
@@ -142,6 +153,7 @@ public:
 #else
             register mask_type state = ~0;
             for (size_type i = 0; i < text_len; ++i) {
+                SM_STATS_INC(comparisons);
                 state = (state << 1) | bitmap[(uchar_type)text[i]];
                 if (unlikely(state < limit))
                     return (Long)(i + 1 - pattern_len);
@@ -151,6 +163,61 @@ public:
 
         return Status::NotFound;
     }
+
+    struct cursor_type {
+        size_type pos;          // The next char of text to be scanned.
+        mask_type state;        // The state of the partial matches.
+
+        cursor_type() : pos(0), state((mask_type)~0) {}
+    };
+
+    /* Searching the next match in a stream, the cursor keeps all of the state
+       between the chunks, set cursor.pos to 0 for every new chunk. Return the
+       end of the match in this chunk, the match may start in the chunks before. */
+    SM_NOINLINE_DECLARE(Long)
+    search_stream(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len,
+                cursor_type & cursor, MatchMode::Type mode) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        assert(pattern_len != 0);
+
+        if (unlikely(pattern_len > kMaxPatternLen))
+            return Status::InvalidParameter;
+
+        mask_type limit = this->limit_;
+        const mask_type * bitmap = &this->bitmap_[0];
+
+        assert(bitmap != nullptr);
+
+        SM_STATS_INC(searches);
+        register mask_type state = cursor.state;
+        for (size_type i = cursor.pos; i < text_len; ++i) {
+            SM_STATS_INC(comparisons);
+            state = (state << 1) | bitmap[(uchar_type)text[i]];
+            if (unlikely(state < limit)) {
+                // Has found, the non-overlapping match drops all partial matches.
+                cursor.pos = i + 1;
+                cursor.state = (mode == MatchMode::Overlapping) ? state : (mask_type)~0;
+                return (Long)(i + 1);
+            }
+        }
+
+        cursor.pos = text_len;
+        cursor.state = state;
+        return Status::NotFound;
+    }
+
+    /* Searching the next match, continue from the cursor. */
+    Long search_next(const char_type * text, size_type text_len,
+                     const char_type * pattern, size_type pattern_len,
+                     cursor_type & cursor, MatchMode::Type mode) const {
+        Long match_end = this->search_stream(text, text_len, pattern, pattern_len, cursor, mode);
+        if (likely(match_end >= 0))
+            return (match_end - (Long)pattern_len);
+        else
+            return match_end;
+    }
 };
 
 #if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
@@ -0,0 +1,660 @@
+
+#ifndef STRING_MATCH_SHIFTOR_WIDE_H
+#define STRING_MATCH_SHIFTOR_WIDE_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+#include <immintrin.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AutoStrStr.h"
+#include "support/bitscan_forward.h"
+
+//
+// The SIMD versions of ShiftOr, see: algorithm/ShiftOr.h
+//
+// ShiftOrWideImpl: one pattern of up to 512 chars. The state is a vector of
+// 64 bits words, kept in a __m128i (SSE 4.2), a __m256i or two (AVX2), or a
+// __m512i (AVX-512), the kernel is the narrowest one the pattern fits in, and
+// is selected by the CPU of the host in preprocessing(). Shifting the state
+// carries the top bit of every word into the next word. A pattern of up to 64
+// chars uses a table of one word per char and the scalar kernel of ShiftOr,
+// which is faster than any vector of one word.
+//
+// ShiftOrMultiImpl: up to 64 patterns of up to 64 chars, 8 patterns per bank,
+// a bank is one __m512i (or two __m256i) of 8 independent states, so 8 short
+// patterns are matched by the same instructions as one.
+//
+// The bit masks are indexed by bytes, so only AnsiString is provided.
+//
+
+namespace StringMatch {
+
+struct ShiftOrKernel {
+    enum Type {
+        Scalar,
+        SSE42,
+        AVX2,
+        AVX2x2,
+        AVX512,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Scalar:    return "Scalar";
+            case SSE42:     return "SSE 4.2";
+            case AVX2:      return "AVX2";
+            case AVX2x2:    return "AVX2 x 2";
+            case AVX512:    return "AVX-512";
+            default:        return "Unknown";
+        }
+    }
+};
+
+template <typename CharTy>
+class ShiftOrWideImpl {
+public:
+    typedef ShiftOrWideImpl<CharTy>     this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                        uchar_type;
+
+    static const size_type kMaxAscii = 256;
+    static const size_type kMaxWords = 8;
+    static const size_type kMaxPatternLen = kMaxWords * 64;
+
+private:
+    size_type words_;
+    ShiftOrKernel::Type kernel_;
+    uint64_t limit_;                // One word: the state is a match if it's less than this.
+    uint64_t bitmap_[kMaxAscii];    // One word: the same as ShiftOr.
+    uint64_t match_[kMaxWords];     // Only the bit of the last char of pattern is set.
+    // The rows of kMaxWords words, allocated for the patterns longer than 64 chars
+    // only, so the object of a short pattern is as small as the one of ShiftOr.
+    std::vector<uint64_t> wide_bitmap_;
+
+public:
+    ShiftOrWideImpl() : words_(1), kernel_(ShiftOrKernel::Scalar), limit_(0) {}
+    ~ShiftOrWideImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "ShiftOrWide"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    size_type words() const { return this->words_; }
+    ShiftOrKernel::Type kernel() const { return this->kernel_; }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+
+        size_type limit = sm_min(length, kMaxPatternLen);
+        this->words_ = sm_max((limit + 63) / 64, (size_type)1);
+        this->kernel_ = this_type::select(this->words_);
+
+        if (this->words_ == 1) {
+            // The same as ShiftOr, the wide masks are never read.
+            ::memset((void *)&this->bitmap_[0], 0xFF, sizeof(this->bitmap_));
+            uint64_t mask = 1;
+            uint64_t used = 0;
+            for (size_type i = 0; i < limit; mask <<= 1, ++i) {
+                this->bitmap_[(uchar_type)pattern[i]] &= ~mask;
+                used |= mask;
+            }
+            this->limit_ = ~(used >> 1);
+            return (length <= kMaxPatternLen);
+        }
+
+        if (this->wide_bitmap_.empty())
+            this->wide_bitmap_.resize(kMaxAscii * kMaxWords);
+
+        // Only the words loaded by the kernel are initialized.
+        switch (this_type::kernel_words(this->kernel_, this->words_)) {
+            case 2:  this->template fill_masks<2>(); break;
+            case 4:  this->template fill_masks<4>(); break;
+            default: this->template fill_masks<kMaxWords>(); break;
+        }
+        ::memset((void *)&this->match_[0], 0, sizeof(this->match_));
+
+        for (size_type i = 0; i < limit; ++i) {
+            this->wide_bitmap_[(uchar_type)pattern[i] * kMaxWords + i / 64] &= ~((uint64_t)1 << (i % 64));
+        }
+        if (likely(limit != 0))
+            this->match_[(limit - 1) / 64] = (uint64_t)1 << ((limit - 1) % 64);
+
+        return (length <= kMaxPatternLen);
+    }
+
+    /* Searching */
+    SM_NOINLINE_DECLARE(Long)
+    search(const char_type * text, size_type text_len,
+           const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+
+        // The longer pattern is truncated by preprocessing(), don't report its false matches.
+        if (unlikely(pattern_len > kMaxPatternLen))
+            return Status::InvalidParameter;
+
+        SM_STATS_INC(searches);
+        if (unlikely(pattern_len == 0))
+            return 0;
+
+        if (likely(pattern_len <= text_len)) {
+            Long match_end;
+            switch (this->kernel_) {
+                case ShiftOrKernel::SSE42:
+                    match_end = this->search_sse42(text, text_len);
+                    break;
+                case ShiftOrKernel::AVX2:
+                    match_end = this->search_avx2(text, text_len);
+                    break;
+                case ShiftOrKernel::AVX2x2:
+                    match_end = this->search_avx2x2(text, text_len);
+                    break;
+#if STRING_MATCH_HAVE_AVX512BW
+                case ShiftOrKernel::AVX512:
+                    match_end = this->search_avx512(text, text_len);
+                    break;
+#endif
+                default:
+                    match_end = this->search_scalar(text, text_len);
+                    break;
+            }
+            SM_STATS_ADD(comparisons, (match_end >= 0) ? match_end : (Long)text_len);
+            if (match_end >= 0)
+                return (match_end - (Long)pattern_len);
+        }
+
+        return Status::NotFound;
+    }
+
+private:
+    static ShiftOrKernel::Type select(size_type words) {
+        if (words <= 1)
+            return ShiftOrKernel::Scalar;
+        if (words <= 2 && CpuInstrSet::has_sse42())
+            return ShiftOrKernel::SSE42;
+        if (words <= 4 && CpuInstrSet::has_avx2())
+            return ShiftOrKernel::AVX2;
+#if STRING_MATCH_HAVE_AVX512BW
+        if (CpuInstrSet::has_avx512bw())
+            return ShiftOrKernel::AVX512;
+#endif
+        if (CpuInstrSet::has_avx2())
+            return ShiftOrKernel::AVX2x2;
+        return ShiftOrKernel::Scalar;
+    }
+
+    // The words of a mask loaded by the kernel: 2, 4 or 8.
+    static size_type kernel_words(ShiftOrKernel::Type kernel, size_type words) {
+        switch (kernel) {
+            case ShiftOrKernel::SSE42:  return 2;
+            case ShiftOrKernel::AVX2:   return 4;
+            case ShiftOrKernel::AVX2x2:
+            case ShiftOrKernel::AVX512: return kMaxWords;
+            default:
+                return ((words <= 2) ? words : ((words <= 4) ? 4 : kMaxWords));
+        }
+    }
+
+    // A constant width, the stores are inlined instead of 256 calls of memset().
+    template <size_type Width>
+    void fill_masks() {
+        uint64_t * row = this->wide_bitmap_.data();
+        for (size_type ch = 0; ch < kMaxAscii; ++ch, row += kMaxWords) {
+            for (size_type w = 0; w < Width; ++w)
+                row[w] = ~(uint64_t)0;
+        }
+    }
+
+    const uint64_t * masks(char_type ch) const {
+        return &this->wide_bitmap_[(uchar_type)ch * kMaxWords];
+    }
+
+    // The kernels return the end of the first match, or Status::NotFound.
+
+    Long search_scalar(const char_type * text, size_type text_len) const {
+        const size_type last = this->words_ - 1;
+        if (last == 0) {
+            const uint64_t limit = this->limit_;
+            const uint64_t * bitmap = &this->bitmap_[0];
+            uint64_t state = ~(uint64_t)0;
+            for (size_type i = 0; i < text_len; ++i) {
+                state = (state << 1) | bitmap[(uchar_type)text[i]];
+                if (unlikely(state < limit))
+                    return (Long)(i + 1);
+            }
+        }
+        else {
+            const uint64_t match = this->match_[last];
+            uint64_t state[kMaxWords];
+            for (size_type w = 0; w < kMaxWords; ++w)
+                state[w] = ~(uint64_t)0;
+            for (size_type i = 0; i < text_len; ++i) {
+                const uint64_t * mask = this->masks(text[i]);
+                // From the top word, the lower word is still the old one.
+                for (size_type w = last; w > 0; --w)
+                    state[w] = (state[w] << 1) | (state[w - 1] >> 63) | mask[w];
+                state[0] = (state[0] << 1) | mask[0];
+                if (unlikely((state[last] & match) == 0))
+                    return (Long)(i + 1);
+            }
+        }
+        return Status::NotFound;
+    }
+
+    SM_TARGET_SSE42
+    Long search_sse42(const char_type * text, size_type text_len) const {
+        const __m128i match = _mm_loadu_si128((const __m128i *)&this->match_[0]);
+        __m128i state = _mm_set1_epi32(-1);
+        for (size_type i = 0; i < text_len; ++i) {
+            const __m128i mask = _mm_loadu_si128((const __m128i *)this->masks(text[i]));
+            // The top bit of word 0 is carried into word 1.
+            __m128i carry = _mm_srli_epi64(_mm_slli_si128(state, 8), 63);
+            state = _mm_or_si128(_mm_or_si128(_mm_slli_epi64(state, 1), carry), mask);
+            if (unlikely(_mm_testz_si128(state, match) != 0))
+                return (Long)(i + 1);
+        }
+        return Status::NotFound;
+    }
+
+    SM_TARGET_AVX2
+    Long search_avx2(const char_type * text, size_type text_len) const {
+        const __m256i match = _mm256_loadu_si256((const __m256i *)&this->match_[0]);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i state = _mm256_set1_epi32(-1);
+        for (size_type i = 0; i < text_len; ++i) {
+            const __m256i mask = _mm256_loadu_si256((const __m256i *)this->masks(text[i]));
+            // The words 0, 1, 2 are moved up to 1, 2, 3, and 0 is shifted in.
+            __m256i lower = _mm256_permute4x64_epi64(state, _MM_SHUFFLE(2, 1, 0, 3));
+            lower = _mm256_blend_epi32(lower, zero, 0x03);
+            __m256i carry = _mm256_srli_epi64(lower, 63);
+            state = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(state, 1), carry), mask);
+            if (unlikely(_mm256_testz_si256(state, match) != 0))
+                return (Long)(i + 1);
+        }
+        return Status::NotFound;
+    }
+
+    SM_TARGET_AVX2
+    Long search_avx2x2(const char_type * text, size_type text_len) const {
+        // The last char of pattern is always in the high half (words 4 to 7).
+        assert(this->words_ > 4);
+        const __m256i match = _mm256_loadu_si256((const __m256i *)&this->match_[4]);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i state_lo = _mm256_set1_epi32(-1);
+        __m256i state_hi = _mm256_set1_epi32(-1);
+        for (size_type i = 0; i < text_len; ++i) {
+            const uint64_t * masks = this->masks(text[i]);
+            const __m256i mask_lo = _mm256_loadu_si256((const __m256i *)&masks[0]);
+            const __m256i mask_hi = _mm256_loadu_si256((const __m256i *)&masks[4]);
+            __m256i lower_lo = _mm256_permute4x64_epi64(state_lo, _MM_SHUFFLE(2, 1, 0, 3));
+            __m256i lower_hi = _mm256_permute4x64_epi64(state_hi, _MM_SHUFFLE(2, 1, 0, 3));
+            // The word 3 of the low half is carried into the word 0 of the high half.
+            lower_hi = _mm256_blend_epi32(lower_hi, lower_lo, 0x03);
+            lower_lo = _mm256_blend_epi32(lower_lo, zero, 0x03);
+            state_lo = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(state_lo, 1),
+                                                       _mm256_srli_epi64(lower_lo, 63)), mask_lo);
+            state_hi = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(state_hi, 1),
+                                                       _mm256_srli_epi64(lower_hi, 63)), mask_hi);
+            if (unlikely(_mm256_testz_si256(state_hi, match) != 0))
+                return (Long)(i + 1);
+        }
+        return Status::NotFound;
+    }
+
+#if STRING_MATCH_HAVE_AVX512BW
+    SM_TARGET_AVX512BW
+    Long search_avx512(const char_type * text, size_type text_len) const {
+        const __m512i match = _mm512_loadu_si512((const void *)&this->match_[0]);
+        const __m512i zero = _mm512_setzero_si512();
+        __m512i state = _mm512_set1_epi64(-1);
+        for (size_type i = 0; i < text_len; ++i) {
+            const __m512i mask = _mm512_loadu_si512((const void *)this->masks(text[i]));
+            // The words 0 to 6 are moved up to 1 to 7, and 0 is shifted in.
+            // The maskz_xxx() and (state + state) forms are the same as the plain
+            // alignr, srli and slli, but never read an undefined source
+            // (GCC's -Wmaybe-uninitialized).
+            __m512i lower = _mm512_maskz_alignr_epi64(0xFF, state, zero, 7);
+            // 0xFE: a | b | c
+            state = _mm512_ternarylogic_epi64(_mm512_add_epi64(state, state),
+                                              _mm512_maskz_srli_epi64(0xFF, lower, 63),
+                                              mask, 0xFE);
+            if (unlikely(_mm512_test_epi64_mask(state, match) == 0))
+                return (Long)(i + 1);
+        }
+        return Status::NotFound;
+    }
+#endif // STRING_MATCH_HAVE_AVX512BW
+};
+
+template <typename CharTy>
+class ShiftOrMultiImpl {
+public:
+    typedef ShiftOrMultiImpl<CharTy>    this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                        uchar_type;
+
+    static const size_type kMaxAscii = 256;
+    static const size_type kLanes = 8;
+    static const size_type kMaxBanks = 8;
+    static const size_type kMaxPatterns = kLanes * kMaxBanks;
+    static const size_type kMaxPatternLen = 64;
+
+private:
+    // 8 patterns, one 64 bits lane per pattern. The match bits of the empty lanes
+    // are all ones, and their states are never cleared, so they never match.
+    struct Bank {
+        uint64_t bitmap[kMaxAscii][kLanes];
+        uint64_t match[kLanes];
+        int      id[kLanes];
+        int      length[kLanes];
+    };
+
+    std::vector<Bank> banks_;
+    size_type num_patterns_;
+    ShiftOrKernel::Type kernel_;
+
+public:
+    ShiftOrMultiImpl() : num_patterns_(0), kernel_(ShiftOrKernel::Scalar) {}
+    ~ShiftOrMultiImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "ShiftOrMulti"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    size_type num_patterns() const { return this->num_patterns_; }
+    ShiftOrKernel::Type kernel() const { return this->kernel_; }
+
+    // For the reports of the multi-pattern benchmark, a state per pattern.
+    size_type state_count() const { return this->num_patterns_; }
+    size_type memory_usage() const { return (this->banks_.size() * sizeof(Bank)); }
+
+    void destroy() {
+        this->banks_.clear();
+        this->num_patterns_ = 0;
+    }
+
+    // Return false if the pattern is empty or longer than 64 chars, or there are 64 patterns.
+    bool add_pattern(int id, const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (unlikely(length == 0 || length > kMaxPatternLen || this->num_patterns_ >= kMaxPatterns))
+            return false;
+
+        size_type lane = this->num_patterns_ % kLanes;
+        if (lane == 0) {
+            this->banks_.push_back(Bank());
+            Bank & bank = this->banks_.back();
+            ::memset((void *)&bank.bitmap[0][0], 0xFF, sizeof(bank.bitmap));
+            ::memset((void *)&bank.match[0], 0xFF, sizeof(bank.match));
+        }
+
+        Bank & bank = this->banks_.back();
+        for (size_type i = 0; i < length; ++i) {
+            bank.bitmap[(uchar_type)pattern[i]][lane] &= ~((uint64_t)1 << i);
+        }
+        bank.match[lane] = (uint64_t)1 << (length - 1);
+        bank.id[lane] = id;
+        bank.length[lane] = (int)length;
+        this->num_patterns_++;
+        return true;
+    }
+
+    bool add_pattern(int id, const char_type * first, const char_type * last) {
+        assert(first <= last);
+        return this->add_pattern(id, first, (size_type)(last - first));
+    }
+
+    bool compile() {
+#if STRING_MATCH_HAVE_AVX512BW
+        if (CpuInstrSet::has_avx512bw()) {
+            this->kernel_ = ShiftOrKernel::AVX512;
+            return true;
+        }
+#endif
+        if (CpuInstrSet::has_avx2())
+            this->kernel_ = ShiftOrKernel::AVX2x2;
+        else
+            this->kernel_ = ShiftOrKernel::Scalar;
+        return true;
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        this->destroy();
+        if (likely(this->add_pattern(0, pattern, length)))
+            return this->compile();
+        else
+            return false;
+    }
+
+    /* Searching all patterns, call callback(pattern_id, start, end) for every match, the range is [start, end). */
+    template <typename Callback>
+    size_type search_all(const char_type * text, size_type text_len, Callback && callback) const {
+        assert(text != nullptr);
+
+        size_type matches = 0;
+        uint64_t state[kMaxPatterns];
+        for (size_type i = 0; i < kMaxPatterns; ++i)
+            state[i] = ~(uint64_t)0;
+
+        size_type pos = 0;
+        while (pos < text_len) {
+            uint64_t hits = 0;
+            pos = this->scan(state, text, pos, text_len, hits);
+            if (pos >= text_len)
+                break;
+            // The bit (bank * 8 + lane) of hits is the pattern matched at pos.
+            do {
+                unsigned long index;
+                __BitScanForward64(index, hits);
+                const Bank & bank = this->banks_[index / kLanes];
+                size_type lane = index % kLanes;
+                callback(bank.id[lane], pos + 1 - (size_type)bank.length[lane], pos + 1);
+                matches++;
+                hits &= hits - 1;
+            } while (hits != 0);
+            pos++;
+        }
+        return matches;
+    }
+
+    /* Searching, return the start of the match which ends first. */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        SM_UNUSED_VAR(pattern);
+        SM_UNUSED_VAR(pattern_len);
+
+        SM_STATS_INC(searches);
+        uint64_t state[kMaxPatterns];
+        for (size_type i = 0; i < kMaxPatterns; ++i)
+            state[i] = ~(uint64_t)0;
+
+        uint64_t hits = 0;
+        size_type pos = this->scan(state, text, 0, text_len, hits);
+        SM_STATS_ADD(comparisons, sm_min(pos + 1, text_len));
+        if (pos < text_len) {
+            unsigned long index;
+            __BitScanForward64(index, hits);
+            const Bank & bank = this->banks_[index / kLanes];
+            return (Long)(pos + 1 - (size_type)bank.length[index % kLanes]);
+        }
+        return Status::NotFound;
+    }
+
+private:
+    // Scan from pos, return the position of the first char that some patterns end
+    // at, and the matched patterns in hits, or text_len. The states are kept in state[].
+    size_type scan(uint64_t * state, const char_type * text, size_type pos,
+                   size_type text_len, uint64_t & hits) const {
+        switch (this->kernel_) {
+#if STRING_MATCH_HAVE_AVX512BW
+            case ShiftOrKernel::AVX512:
+                switch (this->banks_.size()) {
+                    case 1:  return this->template scan_avx512<1>(state, text, pos, text_len, hits);
+                    case 2:  return this->template scan_avx512<2>(state, text, pos, text_len, hits);
+                    case 3:  return this->template scan_avx512<3>(state, text, pos, text_len, hits);
+                    case 4:  return this->template scan_avx512<4>(state, text, pos, text_len, hits);
+                    case 5:  return this->template scan_avx512<5>(state, text, pos, text_len, hits);
+                    case 6:  return this->template scan_avx512<6>(state, text, pos, text_len, hits);
+                    case 7:  return this->template scan_avx512<7>(state, text, pos, text_len, hits);
+                    case 8:  return this->template scan_avx512<8>(state, text, pos, text_len, hits);
+                    default: return text_len;
+                }
+#endif
+            case ShiftOrKernel::AVX2x2:
+                switch (this->banks_.size()) {
+                    case 1:  return this->template scan_avx2<1>(state, text, pos, text_len, hits);
+                    case 2:  return this->template scan_avx2<2>(state, text, pos, text_len, hits);
+                    case 3:  return this->template scan_avx2<3>(state, text, pos, text_len, hits);
+                    case 4:  return this->template scan_avx2<4>(state, text, pos, text_len, hits);
+                    case 5:  return this->template scan_avx2<5>(state, text, pos, text_len, hits);
+                    case 6:  return this->template scan_avx2<6>(state, text, pos, text_len, hits);
+                    case 7:  return this->template scan_avx2<7>(state, text, pos, text_len, hits);
+                    case 8:  return this->template scan_avx2<8>(state, text, pos, text_len, hits);
+                    default: return text_len;
+                }
+            default:
+                return this->scan_scalar(state, text, pos, text_len, hits);
+        }
+    }
+
+    size_type scan_scalar(uint64_t * state, const char_type * text, size_type pos,
+                          size_type text_len, uint64_t & hits) const {
+        const size_type num_lanes = this->banks_.size() * kLanes;
+        for (; pos < text_len; ++pos) {
+            const uchar_type ch = (uchar_type)text[pos];
+            uint64_t found = 0;
+            for (size_type i = 0; i < num_lanes; ++i) {
+                const Bank & bank = this->banks_[i / kLanes];
+                state[i] = (state[i] << 1) | bank.bitmap[ch][i % kLanes];
+                if (unlikely((state[i] & bank.match[i % kLanes]) == 0))
+                    found |= (uint64_t)1 << i;
+            }
+            if (unlikely(found != 0)) {
+                hits = found;
+                return pos;
+            }
+        }
+        return text_len;
+    }
+
+    // The states of all banks are kept in the registers.
+    template <size_type NumBanks>
+    SM_TARGET_AVX2
+    size_type scan_avx2(uint64_t * state, const char_type * text, size_type pos,
+                        size_type text_len, uint64_t & hits) const {
+        const Bank * banks = this->banks_.data();
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i states_lo[NumBanks], states_hi[NumBanks];
+        __m256i match_lo[NumBanks], match_hi[NumBanks];
+        for (size_type b = 0; b < NumBanks; ++b) {
+            states_lo[b] = _mm256_loadu_si256((const __m256i *)&state[b * kLanes]);
+            states_hi[b] = _mm256_loadu_si256((const __m256i *)&state[b * kLanes + 4]);
+            match_lo[b] = _mm256_loadu_si256((const __m256i *)&banks[b].match[0]);
+            match_hi[b] = _mm256_loadu_si256((const __m256i *)&banks[b].match[4]);
+        }
+
+        for (; pos < text_len; ++pos) {
+            const uchar_type ch = (uchar_type)text[pos];
+            __m256i ended = zero;
+            for (size_type b = 0; b < NumBanks; ++b) {
+                const uint64_t * masks = banks[b].bitmap[ch];
+                states_lo[b] = _mm256_or_si256(_mm256_slli_epi64(states_lo[b], 1),
+                                               _mm256_loadu_si256((const __m256i *)&masks[0]));
+                states_hi[b] = _mm256_or_si256(_mm256_slli_epi64(states_hi[b], 1),
+                                               _mm256_loadu_si256((const __m256i *)&masks[4]));
+                ended = _mm256_or_si256(ended, _mm256_cmpeq_epi64(_mm256_and_si256(states_lo[b], match_lo[b]), zero));
+                ended = _mm256_or_si256(ended, _mm256_cmpeq_epi64(_mm256_and_si256(states_hi[b], match_hi[b]), zero));
+            }
+            if (unlikely(_mm256_testz_si256(ended, ended) == 0)) {
+                uint64_t found = 0;
+                for (size_type b = 0; b < NumBanks; ++b) {
+                    uint32_t lo = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(
+                        _mm256_cmpeq_epi64(_mm256_and_si256(states_lo[b], match_lo[b]), zero)));
+                    uint32_t hi = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(
+                        _mm256_cmpeq_epi64(_mm256_and_si256(states_hi[b], match_hi[b]), zero)));
+                    found |= (uint64_t)(lo | (hi << 4)) << (b * kLanes);
+                }
+                hits = found;
+                break;
+            }
+        }
+
+        for (size_type b = 0; b < NumBanks; ++b) {
+            _mm256_storeu_si256((__m256i *)&state[b * kLanes], states_lo[b]);
+            _mm256_storeu_si256((__m256i *)&state[b * kLanes + 4], states_hi[b]);
+        }
+        return sm_min(pos, text_len);
+    }
+
+#if STRING_MATCH_HAVE_AVX512BW
+    // The states of all banks are kept in the registers.
+    template <size_type NumBanks>
+    SM_TARGET_AVX512BW
+    size_type scan_avx512(uint64_t * state, const char_type * text, size_type pos,
+                          size_type text_len, uint64_t & hits) const {
+        const Bank * banks = this->banks_.data();
+        __m512i states[NumBanks], match[NumBanks];
+        for (size_type b = 0; b < NumBanks; ++b) {
+            states[b] = _mm512_loadu_si512((const void *)&state[b * kLanes]);
+            match[b] = _mm512_loadu_si512((const void *)&banks[b].match[0]);
+        }
+
+        for (; pos < text_len; ++pos) {
+            const uchar_type ch = (uchar_type)text[pos];
+            uint64_t found = 0;
+            for (size_type b = 0; b < NumBanks; ++b) {
+                states[b] = _mm512_or_si512(_mm512_add_epi64(states[b], states[b]),
+                                            _mm512_loadu_si512((const void *)banks[b].bitmap[ch]));
+                found |= (uint64_t)_mm512_testn_epi64_mask(states[b], match[b]) << (b * kLanes);
+            }
+            if (unlikely(found != 0)) {
+                hits = found;
+                break;
+            }
+        }
+
+        for (size_type b = 0; b < NumBanks; ++b)
+            _mm512_storeu_si512((void *)&state[b * kLanes], states[b]);
+        return sm_min(pos, text_len);
+    }
+#endif // STRING_MATCH_HAVE_AVX512BW
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< ShiftOrWideImpl<char> >   ShiftOrWide;
+    typedef AlgorithmWrapper< ShiftOrMultiImpl<char> >  ShiftOrMulti;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_SHIFTOR_WIDE_H
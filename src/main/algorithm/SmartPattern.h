@@ -0,0 +1,406 @@
+
+#ifndef STRING_MATCH_SMART_PATTERN_H
+#define STRING_MATCH_SMART_PATTERN_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AutoStrStr.h"
+#include "algorithm/TwoWay.h"
+#include "algorithm/Horspool.h"
+#include "algorithm/BMTuned.h"
+
+//
+// SmartPattern: pick the engine from the statistics of the pattern.
+//
+// preprocessing() analyses the pattern: the length, the numbers of the distinct
+// chars, the period (by the critical factorization of Two-Way), and the rarest
+// byte (by a rank of the byte frequencies of the common texts), then selects:
+//
+//   Memchr:    the patterns of one char.
+//   TwoWay:    the periodic patterns, which are the worst cases of the filters
+//              and the bad character shifts, and the long patterns of a small
+//              alphabet (e.g. DNA).
+//   Simd:      the short patterns, the SIMD first/last char filter of AutoStrStr.
+//   RareByte:  memchr() the rarest byte of the pattern, then verify the window.
+//   Horspool:  the medium patterns.
+//   BMTuned:   the long patterns.
+//
+// The thresholds are SmartThresholds::global(), "StringMatch --calibrate" measures
+// the crossovers of the engines on the host and writes a calibration file. The
+// file of the environment variable STRING_MATCH_CALIBRATION is loaded at the first
+// use, or load one by SmartThresholds::load() and set_global() at startup, before
+// any pattern is compiled.
+//
+// All engines honour text_len. The wide chars are always searched by Simd.
+//
+
+namespace StringMatch {
+
+struct SmartEngine {
+    enum Type {
+        Memchr,
+        Simd,
+        TwoWay,
+        RareByte,
+        Horspool,
+        BMTuned,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Memchr:    return "memchr";
+            case Simd:      return "simd";
+            case TwoWay:    return "two-way";
+            case RareByte:  return "rare-byte";
+            case Horspool:  return "horspool";
+            case BMTuned:   return "bm-tuned";
+            default:        return "unknown";
+        }
+    }
+};
+
+struct SmartProfile {
+    std::size_t length;
+    std::size_t distinct;       // The numbers of the distinct bytes.
+    std::size_t period;         // The period of the pattern, or length if it's not periodic.
+    bool periodic;              // The pattern is made of at least two repetitions of the period.
+    std::size_t rare_index;     // The offset of the rarest byte.
+    uint8_t rare_byte;
+    int rare_rank;              // 0 (rarest) to 255 (most frequent).
+
+    SmartProfile() : length(0), distinct(0), period(0), periodic(false),
+                     rare_index(0), rare_byte(0), rare_rank(255) {}
+
+    //
+    // The approximate frequency of a byte in the texts and the binaries:
+    // the letters, the digits and the common punctuations of the texts are
+    // frequent, '\0' and 0xFF are frequent in the binaries, the UTF-8 bytes
+    // are between them, the other punctuations and the control bytes are rare.
+    //
+    static int byte_rank(uint8_t ch) {
+        struct RankTable {
+            uint8_t rank[256];
+
+            RankTable() {
+                static const char kCommon[] = " etaoinsrhldcumfpgwybvkxjqz"
+                                              "ETAOINSRHLDCUMFPGWYBVKXJQZ"
+                                              "0123456789.,\n-_'\"/:;()=\r\t";
+                for (int i = 0; i < 256; ++i) {
+                    if (i == 0x00 || i == 0xFF)
+                        this->rank[i] = 128;
+                    else if (i >= 0x80)
+                        this->rank[i] = 64;
+                    else if (i >= 0x20 && i < 0x7F)
+                        this->rank[i] = 32;
+                    else
+                        this->rank[i] = 0;
+                }
+                for (int i = 0; i < (int)sizeof(kCommon) - 1; ++i)
+                    this->rank[(uint8_t)kCommon[i]] = (uint8_t)(255 - i);
+            }
+        };
+
+        static const RankTable table;
+        return (int)table.rank[ch];
+    }
+
+    template <typename CharTy>
+    static SmartProfile analyse(const CharTy * pattern, std::size_t length) {
+        typedef typename jstd::uchar_traits<CharTy>::type uchar_type;
+
+        SmartProfile profile;
+        profile.length = length;
+        profile.period = length;
+        if (length == 0)
+            return profile;
+
+        bool seen[256];
+        ::memset(seen, 0, sizeof(seen));
+        for (std::size_t i = 0; i < length; ++i) {
+            uint8_t ch = (uint8_t)(uchar_type)pattern[i];
+            if (!seen[ch]) {
+                seen[ch] = true;
+                profile.distinct++;
+            }
+            int rank = byte_rank(ch);
+            if (rank < profile.rare_rank) {
+                profile.rare_rank = rank;
+                profile.rare_byte = ch;
+                profile.rare_index = i;
+            }
+        }
+
+        if (sizeof(CharTy) == 1) {
+            TwoWayImpl<CharTy> two_way;
+            two_way.preprocessing(pattern, length);
+            if (two_way.is_periodic() && two_way.period() * 2 <= length) {
+                profile.period = two_way.period();
+                profile.periodic = true;
+            }
+        }
+        return profile;
+    }
+};
+
+struct SmartThresholds {
+    std::size_t simd_max_len;       // The patterns up to it are searched by Simd.
+    std::size_t long_min_len;       // The patterns from it are searched by BMTuned.
+    std::size_t two_way_min_len;    // The periodic patterns from it are searched by TwoWay.
+    std::size_t periodic_repeats;   // The patterns of so many repetitions of the period are periodic.
+    std::size_t small_alphabet;     // The long patterns of at most so many distinct bytes are searched by TwoWay.
+    int rare_byte_rank;             // The long patterns have a byte of at most this rank are searched by RareByte.
+
+    SmartThresholds() : simd_max_len(64), long_min_len(256), two_way_min_len(32),
+                        periodic_repeats(4), small_alphabet(4), rare_byte_rank(32) {}
+
+    SmartEngine::Type select(const SmartProfile & profile, std::size_t char_size) const {
+        if (char_size != 1)
+            return SmartEngine::Simd;
+        if (profile.length <= 1)
+            return SmartEngine::Memchr;
+        // The filters verify a periodic pattern again and again on a periodic text,
+        // Two-Way is linear.
+        if (profile.periodic && profile.period * this->periodic_repeats <= profile.length &&
+            profile.length >= this->two_way_min_len)
+            return SmartEngine::TwoWay;
+        if (profile.length <= this->simd_max_len)
+            return SmartEngine::Simd;
+        if (profile.rare_rank <= this->rare_byte_rank)
+            return SmartEngine::RareByte;
+        if (profile.distinct <= this->small_alphabet)
+            return SmartEngine::TwoWay;
+        if (profile.length >= this->long_min_len)
+            return SmartEngine::BMTuned;
+        else
+            return SmartEngine::Horspool;
+    }
+
+    //
+    // The calibration file, one "key = value" a line, '#' starts a comment,
+    // the unknown keys are ignored. Return false if it can't be read or a
+    // value is invalid, the thresholds are not changed then.
+    //
+    bool load(const char * path) {
+        FILE * fp = ::fopen(path, "r");
+        if (fp == nullptr)
+            return false;
+
+        SmartThresholds thresholds = *this;
+        bool success = true;
+        char line[256];
+        while (::fgets(line, sizeof(line), fp) != nullptr) {
+            char * comment = ::strchr(line, '#');
+            if (comment != nullptr)
+                *comment = '\0';
+            char key[64];
+            char value[64];
+            int fields = ::sscanf(line, " %63[^= \t\r\n] = %63s", key, value);
+            if (fields <= 0)
+                continue;
+            char * end = nullptr;
+            unsigned long long number = (fields == 2) ? ::strtoull(value, &end, 10) : 0;
+            if (fields != 2 || end == value || *end != '\0') {
+                success = false;
+                break;
+            }
+            if (::strcmp(key, "simd_max_len") == 0)
+                thresholds.simd_max_len = (std::size_t)number;
+            else if (::strcmp(key, "long_min_len") == 0)
+                thresholds.long_min_len = (std::size_t)number;
+            else if (::strcmp(key, "two_way_min_len") == 0)
+                thresholds.two_way_min_len = (std::size_t)number;
+            else if (::strcmp(key, "periodic_repeats") == 0)
+                thresholds.periodic_repeats = (std::size_t)number;
+            else if (::strcmp(key, "small_alphabet") == 0)
+                thresholds.small_alphabet = (std::size_t)number;
+            else if (::strcmp(key, "rare_byte_rank") == 0)
+                thresholds.rare_byte_rank = (int)number;
+        }
+        success = success && (::ferror(fp) == 0);
+        ::fclose(fp);
+
+        if (success)
+            *this = thresholds;
+        return success;
+    }
+
+    bool save(const char * path) const {
+        FILE * fp = ::fopen(path, "w");
+        if (fp == nullptr)
+            return false;
+        ::fprintf(fp, "# The SmartPattern thresholds, see: StringMatch --calibrate\n");
+        ::fprintf(fp, "simd_max_len = %llu\n", (unsigned long long)this->simd_max_len);
+        ::fprintf(fp, "long_min_len = %llu\n", (unsigned long long)this->long_min_len);
+        ::fprintf(fp, "two_way_min_len = %llu\n", (unsigned long long)this->two_way_min_len);
+        ::fprintf(fp, "periodic_repeats = %llu\n", (unsigned long long)this->periodic_repeats);
+        ::fprintf(fp, "small_alphabet = %llu\n", (unsigned long long)this->small_alphabet);
+        ::fprintf(fp, "rare_byte_rank = %d\n", this->rare_byte_rank);
+        bool success = (::ferror(fp) == 0);
+        success = (::fclose(fp) == 0) && success;
+        return success;
+    }
+
+    // The thresholds of the new patterns, from STRING_MATCH_CALIBRATION if it's set.
+    static SmartThresholds & global() {
+        static SmartThresholds thresholds = SmartThresholds::from_env();
+        return thresholds;
+    }
+
+    // Not thread safe, call it at startup.
+    static void set_global(const SmartThresholds & thresholds) {
+        SmartThresholds::global() = thresholds;
+    }
+
+private:
+    static SmartThresholds from_env() {
+        SmartThresholds thresholds;
+        const char * path = ::getenv("STRING_MATCH_CALIBRATION");
+        if (path != nullptr && *path != '\0') {
+            if (!thresholds.load(path))
+                ::fprintf(stderr, "StringMatch: can not load the calibration file: %s\n", path);
+        }
+        return thresholds;
+    }
+};
+
+template <typename CharTy>
+class SmartPatternImpl {
+public:
+    typedef SmartPatternImpl<CharTy>    this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                        uchar_type;
+
+private:
+    SmartEngine::Type engine_;
+    SmartProfile profile_;
+    AutoStrStrImpl<char_type> simd_;
+    TwoWayImpl<char_type> two_way_;
+    HorspoolImpl<char_type> horspool_;
+    BMTunedImpl<char_type> bm_tuned_;
+
+public:
+    SmartPatternImpl() : engine_(SmartEngine::Simd) {}
+    ~SmartPatternImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "SmartPattern"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    SmartEngine::Type engine() const { return this->engine_; }
+    const SmartProfile & profile() const { return this->profile_; }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+
+        this->profile_ = SmartProfile::analyse(pattern, length);
+        this->engine_ = SmartThresholds::global().select(this->profile_, sizeof(char_type));
+
+        switch (this->engine_) {
+            case SmartEngine::TwoWay:
+                return this->two_way_.preprocessing(pattern, length);
+            case SmartEngine::Horspool:
+                return this->horspool_.preprocessing(pattern, length);
+            case SmartEngine::BMTuned:
+                return this->bm_tuned_.preprocessing(pattern, length);
+            default:
+                return this->simd_.preprocessing(pattern, length);
+        }
+    }
+
+    /* Searching */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+
+        switch (this->engine_) {
+            case SmartEngine::Memchr:
+                return this->search_memchr(text, text_len, pattern, pattern_len);
+            case SmartEngine::TwoWay:
+                return this->two_way_.search(text, text_len, pattern, pattern_len);
+            case SmartEngine::RareByte:
+                return this->search_rare_byte(text, text_len, pattern, pattern_len);
+            case SmartEngine::Horspool:
+                return this->horspool_.search(text, text_len, pattern, pattern_len);
+            case SmartEngine::BMTuned:
+                return this->bm_tuned_.search(text, text_len, pattern, pattern_len);
+            default:
+                return this->simd_.search(text, text_len, pattern, pattern_len);
+        }
+    }
+
+private:
+    Long search_memchr(const char_type * text, size_type text_len,
+                       const char_type * pattern, size_type pattern_len) const {
+        if (unlikely(pattern_len == 0))
+            return 0;
+        const char_type * found = (const char_type *)::memchr((const void *)text,
+                                                              (uchar_type)pattern[0], text_len);
+        if (likely(found != nullptr))
+            return (Long)(found - text);
+        else
+            return Status::NotFound;
+    }
+
+    // memchr() the rarest byte at its offset of every window, then verify the window.
+    Long search_rare_byte(const char_type * text, size_type text_len,
+                          const char_type * pattern, size_type pattern_len) const {
+        if (likely(pattern_len <= text_len)) {
+            const size_type rare_index = this->profile_.rare_index;
+            const int rare_byte = this->profile_.rare_byte;
+            assert(rare_index < pattern_len);
+            const char_type * first = text + rare_index;
+            const char_type * last = first + (text_len - pattern_len);
+            while (first <= last) {
+                const char_type * found = (const char_type *)::memchr((const void *)first, rare_byte,
+                                                                      (size_t)(last - first) + 1);
+                if (found == nullptr)
+                    break;
+                const char_type * window = found - rare_index;
+                if (::memcmp((const void *)window, (const void *)pattern, pattern_len) == 0)
+                    return (Long)(window - text);
+                first = found + 1;
+            }
+        }
+        return Status::NotFound;
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< SmartPatternImpl<char> >      Smart;
+    typedef Smart::Pattern                                  SmartPattern;
+}
+
+namespace UnicodeString {
+    typedef AlgorithmWrapper< SmartPatternImpl<wchar_t> >   Smart;
+    typedef Smart::Pattern                                  SmartPattern;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_SMART_PATTERN_H
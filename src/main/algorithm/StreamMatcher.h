@@ -0,0 +1,239 @@
+
+#ifndef STRING_MATCH_STREAM_MATCHER_H
+#define STRING_MATCH_STREAM_MATCHER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+
+//
+// StreamMatcher: search a stream which arrives chunk by chunk (socket reads,
+// file blocks), and report the absolute offsets of the matches in the stream.
+//
+// Only O(pattern_len) state is kept between the chunks, the chunks are never
+// copied or buffered:
+//
+//   - The algorithms with search_stream() (Kmp, ShiftOr, AhoCorasick) carry their
+//     cursor: the partial-match index, the state word or the current node.
+//   - The others (the skip-based algorithms) carry the last pattern_len - 1 chars,
+//     the matches across the boundary are searched in carry + the head of the chunk.
+//
+// The algorithm must honour text_len, the strstr() family which needs
+// the null-terminated text can't be used.
+//
+
+namespace StringMatch {
+
+namespace detail {
+
+template <typename AlgorithmTy,
+          bool HasStreamSearch = has_stream_search<typename AlgorithmTy::algorithm_type>::value>
+class StreamScanner {
+public:
+    typedef typename AlgorithmTy::Pattern       pattern_type;
+    typedef typename AlgorithmTy::char_type     char_type;
+    typedef typename AlgorithmTy::size_type     size_type;
+    typedef uint64_t                            offset_type;
+
+private:
+    std::vector<char_type> carry_;      // The last pattern_len - 1 chars of the stream.
+    std::vector<char_type> join_;       // carry_ + the head of the new chunk.
+
+public:
+    StreamScanner() {}
+
+    void reset() {
+        this->carry_.clear();
+        this->join_.clear();
+    }
+
+    // Call report(offset) for every overlapping match ends in this chunk.
+    template <typename Reporter>
+    void scan(const pattern_type & pattern, MatchMode::Type mode,
+              const char_type * chunk, size_type length, offset_type base,
+              Reporter & report) {
+        SM_UNUSED_VAR(mode);
+        size_type pattern_len = pattern.size();
+        assert(pattern_len != 0);
+        size_type keep_len = pattern_len - 1;
+
+        // The matches start in the carry and end in this chunk.
+        size_type carry_len = this->carry_.size();
+        if (carry_len > 0) {
+            size_type head_len = (length < keep_len) ? length : keep_len;
+            this->join_.assign(this->carry_.begin(), this->carry_.end());
+            this->join_.insert(this->join_.end(), chunk, chunk + head_len);
+            if (this->join_.size() >= pattern_len) {
+                pattern.match_all(this->join_.data(), this->join_.size(),
+                    [&](Long index_of) {
+                        if ((size_type)index_of < carry_len)
+                            report(base - carry_len + (offset_type)index_of);
+                    }, MatchMode::Overlapping);
+            }
+        }
+
+        // The matches inside this chunk.
+        if (length >= pattern_len) {
+            pattern.match_all(chunk, length,
+                [&](Long index_of) {
+                    report(base + (offset_type)index_of);
+                }, MatchMode::Overlapping);
+        }
+
+        // Keep the last pattern_len - 1 chars.
+        if (length >= keep_len) {
+            this->carry_.assign(chunk + (length - keep_len), chunk + length);
+        }
+        else {
+            this->carry_.insert(this->carry_.end(), chunk, chunk + length);
+            if (this->carry_.size() > keep_len) {
+                this->carry_.erase(this->carry_.begin(),
+                                   this->carry_.begin() + (this->carry_.size() - keep_len));
+            }
+        }
+    }
+};
+
+template <typename AlgorithmTy>
+class StreamScanner<AlgorithmTy, true> {
+public:
+    typedef typename AlgorithmTy::Pattern       pattern_type;
+    typedef typename AlgorithmTy::char_type     char_type;
+    typedef typename AlgorithmTy::size_type     size_type;
+    typedef uint64_t                            offset_type;
+
+    typedef typename AlgorithmTy::algorithm_type::cursor_type cursor_type;
+
+private:
+    cursor_type cursor_;
+
+public:
+    StreamScanner() : cursor_() {}
+
+    void reset() {
+        this->cursor_ = cursor_type();
+    }
+
+    // Call report(offset) for every match ends in this chunk.
+    template <typename Reporter>
+    void scan(const pattern_type & pattern, MatchMode::Type mode,
+              const char_type * chunk, size_type length, offset_type base,
+              Reporter & report) {
+        size_type pattern_len = pattern.size();
+        assert(pattern_len != 0);
+
+        this->cursor_.pos = 0;
+        Long match_end;
+        while ((match_end = pattern.algorithm().search_stream(chunk, length,
+                                                              pattern.c_str(), pattern_len,
+                                                              this->cursor_, mode)) >= 0) {
+            report(base + (offset_type)match_end - pattern_len);
+        }
+    }
+};
+
+} // namespace detail
+
+template <typename AlgorithmTy>
+class StreamMatcher {
+public:
+    typedef StreamMatcher<AlgorithmTy>          this_type;
+    typedef AlgorithmTy                         algorithm_type;
+    typedef typename AlgorithmTy::Pattern       pattern_type;
+    typedef typename AlgorithmTy::char_type     char_type;
+    typedef typename AlgorithmTy::size_type     size_type;
+    typedef uint64_t                            offset_type;
+
+    typedef detail::StreamScanner<AlgorithmTy>  scanner_type;
+
+private:
+    const pattern_type * pattern_;
+    MatchMode::Type mode_;
+    scanner_type scanner_;
+    offset_type position_;      // The numbers of chars have been fed.
+    offset_type next_allowed_;  // The lowest offset of the next non-overlapping match.
+    offset_type matches_;
+
+    template <typename Visitor>
+    struct Reporter {
+        this_type * matcher;
+        Visitor * visitor;
+        size_type found;
+
+        void operator () (offset_type offset) {
+            if (matcher->mode_ == MatchMode::NonOverlapping) {
+                if (offset < matcher->next_allowed_)
+                    return;
+                matcher->next_allowed_ = offset + matcher->pattern_->size();
+            }
+            (*visitor)(offset);
+            found++;
+        }
+    };
+
+public:
+    // The pattern must be compiled and live longer than the matcher.
+    explicit StreamMatcher(const pattern_type & pattern,
+                           MatchMode::Type mode = MatchMode::Overlapping)
+        : pattern_(&pattern), mode_(mode), scanner_(),
+          position_(0), next_allowed_(0), matches_(0) {
+    }
+
+    ~StreamMatcher() {}
+
+    offset_type position() const { return this->position_; }
+    offset_type matches() const { return this->matches_; }
+
+    // Feed the next chunk of the stream, call visitor(offset) for every match
+    // ends in this chunk, offset is the start of the match in the whole stream.
+    // Return the numbers of the matches in this chunk.
+    template <typename Visitor>
+    size_type feed(const char_type * chunk, size_type length, Visitor && visitor) {
+        assert(chunk != nullptr || length == 0);
+        Reporter<typename std::remove_reference<Visitor>::type> report;
+        report.matcher = this;
+        report.visitor = &visitor;
+        report.found = 0;
+
+        if (likely(this->pattern_->size() != 0 && length != 0)) {
+            this->scanner_.scan(*this->pattern_, this->mode_, chunk, length,
+                                this->position_, report);
+        }
+
+        this->position_ += length;
+        this->matches_ += report.found;
+        return report.found;
+    }
+
+    // The end of the stream, every match has been reported when its last char
+    // arrived, so nothing is left. Return the numbers of all of the matches and
+    // reset the matcher for the next stream.
+    offset_type finish() {
+        offset_type matches = this->matches_;
+        this->reset();
+        return matches;
+    }
+
+    void reset() {
+        this->scanner_.reset();
+        this->position_ = 0;
+        this->next_allowed_ = 0;
+        this->matches_ = 0;
+    }
+};
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_STREAM_MATCHER_H
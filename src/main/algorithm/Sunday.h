@@ -18,6 +18,7 @@
 
 #include "StringMatch.h"
 #include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AlgorithmUtils.h"
 
 //
 // See: https://blog.csdn.net/q547550831/article/details/51860017
@@ -34,6 +35,7 @@ public:
     typedef std::size_t             size_type;
     typedef typename jstd::uchar_traits<CharTy>::type
                                     uchar_type;
+    typedef BadCharHash<CharTy>     hash_type;
 
     static const size_t kMaxAscii = 256;
 
@@ -63,7 +65,7 @@ public:
             this->shift_[i] = (int)(length + 1);
         }
         for (size_type i = 0; i < length; ++i) {
-            this->shift_[(uchar_type)pattern[i]] = (int)(length - i);
+            this->shift_[hash_type::index(pattern[i])] = (int)(length - i);
         }
 
         return true;
@@ -76,8 +78,9 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         if (likely(pattern_len <= text_len)) {
-            int * shift = (int *)&this->shift_[0];
+            const int * shift = &this->shift_[0];
             assert(shift != nullptr);
 
             const char_type * target_end = pattern + pattern_len;
@@ -89,9 +92,13 @@ public:
                 assert(source >= text && source < (text + text_len));
 
                 while (likely(target < target_end)) {
+                    SM_STATS_INC(comparisons);
                     if (likely(*source != *target)) {
-                        index = source - text;
-                        index += shift[(uchar_type)text[index + pattern_len]];
+                        // It's the last window, the next char is out of the text.
+                        if (unlikely(index >= scan_len))
+                            return Status::NotFound;
+                        SM_STATS_SHIFT(shift[hash_type::index(text[index + pattern_len])]);
+                        index += shift[hash_type::index(text[index + pattern_len])];
                         break;
                     }
                     source++;
@@ -0,0 +1,449 @@
+
+#ifndef STRING_MATCH_TEDDY_H
+#define STRING_MATCH_TEDDY_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+#include <immintrin.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/AutoStrStr.h"
+#include "support/bitscan_forward.h"
+
+//
+// Teddy: a SIMD prefilter for the small sets (2 - 64) of literals,
+// from the literal matcher of Hyperscan.
+//
+// See: https://github.com/intel/hyperscan/tree/master/src/fdr (teddy.c)
+//
+// The literals are sorted and split into 8 buckets, a bucket is a bit of
+// a byte. For the first 1 - 3 bytes of the literals (the prefix, as long as
+// the shortest literal), every byte of the prefix has two tables of 16 masks,
+// indexed by the low and the high nibble of a byte, the bit of a bucket is
+// set if a literal in the bucket has the nibble at the byte. pshufb looks up
+// 16 (SSSE3) or 32 (AVX2) positions of text at once, and the AND of all the
+// masks is the buckets which may have a literal starting at the position.
+// Only the literals of these buckets are verified by memcmp().
+//
+// The multi-pattern interface is the same as AhoCorasick: add_pattern() /
+// compile() / search_all(), but the matches are reported in the order of
+// their start positions, and search() returns the leftmost match.
+//
+
+namespace StringMatch {
+
+struct TeddyKernel {
+    enum Type {
+        Scalar,
+        SSSE3,
+        AVX2,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Scalar:    return "Scalar";
+            case SSSE3:     return "SSSE3";
+            case AVX2:      return "AVX2";
+            default:        return "Unknown";
+        }
+    }
+};
+
+template <typename CharTy>
+class TeddyImpl {
+public:
+    typedef TeddyImpl<CharTy>           this_type;
+    typedef CharTy                      char_type;
+    typedef std::size_t                 size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                        uchar_type;
+
+    // The nibble tables and the shuffles index the text by bytes.
+    static_assert(sizeof(CharTy) == 1, "TeddyImpl<CharTy>: only the byte strings are supported.");
+
+    static const size_type kBuckets = 8;
+    static const size_type kMaxPatterns = 64;
+    static const size_type kMaxPrefix = 3;
+
+private:
+    struct Literal {
+        uint32_t offset;        // The offset in storage_.
+        uint32_t length;
+        int      id;
+    };
+
+    // The masks of a byte of the prefix, the 16 masks are repeated in the two
+    // 128 bits lanes for AVX2, pshufb only shuffles in a lane.
+    struct NibbleMasks {
+        uint8_t lo[32];
+        uint8_t hi[32];
+    };
+
+    std::string storage_;
+    std::vector<Literal> literals_;         // Sorted by the buckets after compile().
+    uint32_t bucket_first_[kBuckets + 1];   // The literals of bucket i are [first[i], first[i + 1]).
+    NibbleMasks masks_[kMaxPrefix];
+    size_type prefix_len_;
+    TeddyKernel::Type kernel_;
+    bool compiled_;
+
+public:
+    TeddyImpl() : prefix_len_(0), kernel_(TeddyKernel::Scalar), compiled_(false) {}
+    ~TeddyImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "Teddy"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    size_type num_patterns() const { return this->literals_.size(); }
+    size_type prefix_len() const { return this->prefix_len_; }
+    TeddyKernel::Type kernel() const { return this->kernel_; }
+
+    // For the reports of the multi-pattern benchmark, a state per pattern.
+    size_type state_count() const { return this->literals_.size(); }
+    size_type memory_usage() const {
+        return (sizeof(this->masks_) + this->storage_.capacity() +
+                this->literals_.capacity() * sizeof(Literal));
+    }
+
+    void destroy() {
+        this->storage_.clear();
+        this->literals_.clear();
+        this->prefix_len_ = 0;
+        this->compiled_ = false;
+    }
+
+    // Return false if the pattern is empty, or there are 64 patterns.
+    bool add_pattern(int id, const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        if (unlikely(length == 0 || this->literals_.size() >= kMaxPatterns))
+            return false;
+
+        Literal literal;
+        literal.offset = (uint32_t)this->storage_.size();
+        literal.length = (uint32_t)length;
+        literal.id = id;
+        this->storage_.append((const char *)pattern, length);
+        this->literals_.push_back(literal);
+        this->compiled_ = false;
+        return true;
+    }
+
+    bool add_pattern(int id, const char_type * first, const char_type * last) {
+        assert(first <= last);
+        return this->add_pattern(id, first, (size_type)(last - first));
+    }
+
+    bool compile() {
+        if (unlikely(this->literals_.empty()))
+            return false;
+
+        size_type min_len = this->literals_[0].length;
+        for (size_type i = 1; i < this->literals_.size(); ++i)
+            min_len = sm_min(min_len, (size_type)this->literals_[i].length);
+        this->prefix_len_ = sm_min(min_len, kMaxPrefix);
+
+        // The literals of the same prefix are put in the same bucket, it's
+        // cheaper to verify them than to have more buckets fire.
+        const char * storage = this->storage_.data();
+        const size_type prefix_len = this->prefix_len_;
+        std::stable_sort(this->literals_.begin(), this->literals_.end(),
+            [storage, prefix_len](const Literal & a, const Literal & b) {
+                return (::memcmp(storage + a.offset, storage + b.offset, prefix_len) < 0);
+            });
+
+        const size_type num_literals = this->literals_.size();
+        ::memset((void *)&this->masks_[0], 0, sizeof(this->masks_));
+        for (size_type bucket = 0; bucket < kBuckets; ++bucket) {
+            this->bucket_first_[bucket] = (uint32_t)(bucket * num_literals / kBuckets);
+        }
+        this->bucket_first_[kBuckets] = (uint32_t)num_literals;
+
+        for (size_type bucket = 0; bucket < kBuckets; ++bucket) {
+            const uint8_t bit = (uint8_t)(1U << bucket);
+            for (uint32_t i = this->bucket_first_[bucket]; i < this->bucket_first_[bucket + 1]; ++i) {
+                const uint8_t * literal = (const uint8_t *)(storage + this->literals_[i].offset);
+                for (size_type k = 0; k < prefix_len; ++k) {
+                    this->masks_[k].lo[literal[k] & 0x0F] |= bit;
+                    this->masks_[k].hi[literal[k] >> 4] |= bit;
+                }
+            }
+        }
+        for (size_type k = 0; k < prefix_len; ++k) {
+            ::memcpy(&this->masks_[k].lo[16], &this->masks_[k].lo[0], 16);
+            ::memcpy(&this->masks_[k].hi[16], &this->masks_[k].hi[0], 16);
+        }
+
+        if (CpuInstrSet::has_avx2())
+            this->kernel_ = TeddyKernel::AVX2;
+        else if (CpuInstrSet::has_ssse3())
+            this->kernel_ = TeddyKernel::SSSE3;
+        else
+            this->kernel_ = TeddyKernel::Scalar;
+
+        this->compiled_ = true;
+        return true;
+    }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+        this->destroy();
+        if (likely(this->add_pattern(0, pattern, length)))
+            return this->compile();
+        else
+            return false;
+    }
+
+    /* Searching all patterns, call callback(pattern_id, start, end) for every match, the range is [start, end). */
+    template <typename Callback>
+    size_type search_all(const char_type * text, size_type text_len, Callback && callback) const {
+        assert(text != nullptr);
+        if (unlikely(!this->compiled_ || text_len < this->prefix_len_))
+            return 0;
+
+        const uint8_t * s = (const uint8_t *)text;
+        size_type matches = 0;
+        auto confirm = [this, s, text_len, &matches, &callback](size_type pos, uint32_t buckets) -> bool {
+            do {
+                unsigned long bucket;
+                __BitScanForward(bucket, buckets);
+                for (uint32_t i = this->bucket_first_[bucket]; i < this->bucket_first_[bucket + 1]; ++i) {
+                    const Literal & literal = this->literals_[i];
+                    if (this->verify(s, text_len, pos, literal)) {
+                        callback(literal.id, pos, pos + literal.length);
+                        matches++;
+                    }
+                }
+                buckets &= buckets - 1;
+            } while (buckets != 0);
+            return false;
+        };
+        this->scan(s, text_len, confirm);
+        return matches;
+    }
+
+    /* Searching, return the leftmost match. */
+    Long search(const char_type * text, size_type text_len,
+                const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+        SM_UNUSED_VAR(pattern);
+        SM_UNUSED_VAR(pattern_len);
+        if (unlikely(!this->compiled_ || text_len < this->prefix_len_))
+            return Status::NotFound;
+
+        const uint8_t * s = (const uint8_t *)text;
+        Long index_of = Status::NotFound;
+        auto confirm = [this, s, text_len, &index_of](size_type pos, uint32_t buckets) -> bool {
+            do {
+                unsigned long bucket;
+                __BitScanForward(bucket, buckets);
+                for (uint32_t i = this->bucket_first_[bucket]; i < this->bucket_first_[bucket + 1]; ++i) {
+                    if (this->verify(s, text_len, pos, this->literals_[i])) {
+                        index_of = (Long)pos;
+                        return true;
+                    }
+                }
+                buckets &= buckets - 1;
+            } while (buckets != 0);
+            return false;
+        };
+        this->scan(s, text_len, confirm);
+        return index_of;
+    }
+
+private:
+    bool verify(const uint8_t * text, size_type text_len, size_type pos,
+                const Literal & literal) const {
+        return ((text_len - pos) >= literal.length &&
+                ::memcmp(text + pos, this->storage_.data() + literal.offset, literal.length) == 0);
+    }
+
+    // Call confirm(pos, buckets) for every candidate position, until it returns true.
+    template <typename Confirm>
+    void scan(const uint8_t * text, size_type text_len, Confirm & confirm) const {
+        switch (this->kernel_) {
+            case TeddyKernel::AVX2:
+                switch (this->prefix_len_) {
+                    case 1:  this->template scan_avx2<1>(text, text_len, confirm); break;
+                    case 2:  this->template scan_avx2<2>(text, text_len, confirm); break;
+                    default: this->template scan_avx2<3>(text, text_len, confirm); break;
+                }
+                break;
+            case TeddyKernel::SSSE3:
+                switch (this->prefix_len_) {
+                    case 1:  this->template scan_ssse3<1>(text, text_len, confirm); break;
+                    case 2:  this->template scan_ssse3<2>(text, text_len, confirm); break;
+                    default: this->template scan_ssse3<3>(text, text_len, confirm); break;
+                }
+                break;
+            default:
+                this->scan_scalar(text, 0, text_len - this->prefix_len_ + 1, confirm);
+                break;
+        }
+    }
+
+    // Scan the candidate positions [first, last).
+    template <typename Confirm>
+    bool scan_scalar(const uint8_t * text, size_type first, size_type last, Confirm & confirm) const {
+        const size_type prefix_len = this->prefix_len_;
+        for (size_type pos = first; pos < last; ++pos) {
+            uint32_t buckets = 0xFF;
+            for (size_type k = 0; k < prefix_len; ++k) {
+                const uint8_t ch = text[pos + k];
+                buckets &= (uint32_t)(this->masks_[k].lo[ch & 0x0F] & this->masks_[k].hi[ch >> 4]);
+            }
+            if (unlikely(buckets != 0)) {
+                if (confirm(pos, buckets))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    template <size_type PrefixLen, typename Confirm>
+    SM_TARGET_SSSE3
+    bool scan_ssse3(const uint8_t * text, size_type text_len, Confirm & confirm) const {
+        static const size_type kMaxSize = sizeof(__m128i);
+
+        // The numbers of candidate positions.
+        const size_type scan_len = text_len - PrefixLen + 1;
+        if (unlikely(scan_len < kMaxSize))
+            return this->scan_scalar(text, 0, scan_len, confirm);
+
+        const __m128i __nibble = _mm_set1_epi8(0x0F);
+        const __m128i __zero = _mm_setzero_si128();
+        __m128i __lo[PrefixLen], __hi[PrefixLen];
+        for (size_type k = 0; k < PrefixLen; ++k) {
+            __lo[k] = _mm_loadu_si128((const __m128i *)this->masks_[k].lo);
+            __hi[k] = _mm_loadu_si128((const __m128i *)this->masks_[k].hi);
+        }
+
+        // The last block overlaps the previous one, see: avx2_memmem().
+        const size_type last_block = scan_len - kMaxSize;
+        uint32_t skip_mask = 0xFFFFUL;
+        size_type index = 0;
+        do {
+            __m128i __buckets = _mm_set1_epi8((char)0xFF);
+            for (size_type k = 0; k < PrefixLen; ++k) {
+                __m128i __block = _mm_loadu_si128((const __m128i *)(text + index + k));
+                __m128i __lo_nibble = _mm_and_si128(__block, __nibble);
+                __m128i __hi_nibble = _mm_and_si128(_mm_srli_epi16(__block, 4), __nibble);
+                __m128i __masks = _mm_and_si128(_mm_shuffle_epi8(__lo[k], __lo_nibble),
+                                                _mm_shuffle_epi8(__hi[k], __hi_nibble));
+                __buckets = _mm_and_si128(__buckets, __masks);
+            }
+
+            uint32_t mask = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(__buckets, __zero));
+            mask &= skip_mask;
+            if (unlikely(mask != 0)) {
+                uint8_t buckets[kMaxSize];
+                _mm_storeu_si128((__m128i *)buckets, __buckets);
+                do {
+                    unsigned long bit_pos;
+                    __BitScanForward(bit_pos, mask);
+                    if (confirm(index + bit_pos, (uint32_t)buckets[bit_pos]))
+                        return true;
+                    mask &= (mask - 1);
+                } while (mask != 0);
+            }
+
+            if (likely(index < last_block)) {
+                size_type next_index = index + kMaxSize;
+                if (unlikely(next_index > last_block)) {
+                    skip_mask = (0xFFFFUL << (next_index - last_block)) & 0xFFFFUL;
+                    next_index = last_block;
+                }
+                index = next_index;
+            }
+            else break;
+        } while (1);
+
+        return false;
+    }
+
+    template <size_type PrefixLen, typename Confirm>
+    SM_TARGET_AVX2
+    bool scan_avx2(const uint8_t * text, size_type text_len, Confirm & confirm) const {
+        static const size_type kMaxSize = sizeof(__m256i);
+
+        const size_type scan_len = text_len - PrefixLen + 1;
+        if (unlikely(scan_len < kMaxSize))
+            return this->scan_scalar(text, 0, scan_len, confirm);
+
+        const __m256i __nibble = _mm256_set1_epi8(0x0F);
+        const __m256i __zero = _mm256_setzero_si256();
+        __m256i __lo[PrefixLen], __hi[PrefixLen];
+        for (size_type k = 0; k < PrefixLen; ++k) {
+            __lo[k] = _mm256_loadu_si256((const __m256i *)this->masks_[k].lo);
+            __hi[k] = _mm256_loadu_si256((const __m256i *)this->masks_[k].hi);
+        }
+
+        const size_type last_block = scan_len - kMaxSize;
+        uint32_t skip_mask = 0xFFFFFFFFUL;
+        size_type index = 0;
+        do {
+            __m256i __buckets = _mm256_set1_epi8((char)0xFF);
+            for (size_type k = 0; k < PrefixLen; ++k) {
+                __m256i __block = _mm256_loadu_si256((const __m256i *)(text + index + k));
+                __m256i __lo_nibble = _mm256_and_si256(__block, __nibble);
+                __m256i __hi_nibble = _mm256_and_si256(_mm256_srli_epi16(__block, 4), __nibble);
+                __m256i __masks = _mm256_and_si256(_mm256_shuffle_epi8(__lo[k], __lo_nibble),
+                                                   _mm256_shuffle_epi8(__hi[k], __hi_nibble));
+                __buckets = _mm256_and_si256(__buckets, __masks);
+            }
+
+            uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(__buckets, __zero));
+            mask &= skip_mask;
+            if (unlikely(mask != 0)) {
+                uint8_t buckets[kMaxSize];
+                _mm256_storeu_si256((__m256i *)buckets, __buckets);
+                do {
+                    unsigned long bit_pos;
+                    __BitScanForward(bit_pos, mask);
+                    if (confirm(index + bit_pos, (uint32_t)buckets[bit_pos]))
+                        return true;
+                    mask &= (mask - 1);
+                } while (mask != 0);
+            }
+
+            if (likely(index < last_block)) {
+                size_type next_index = index + kMaxSize;
+                if (unlikely(next_index > last_block)) {
+                    skip_mask = 0xFFFFFFFFUL << (next_index - last_block);
+                    next_index = last_block;
+                }
+                index = next_index;
+            }
+            else break;
+        } while (1);
+
+        return false;
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< TeddyImpl<char> >     Teddy;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_TEDDY_H
@@ -0,0 +1,187 @@
+
+#ifndef STRING_MATCH_TWO_WAY_H
+#define STRING_MATCH_TWO_WAY_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+
+#include "StringMatch.h"
+#include "algorithm/AlgorithmWrapper.h"
+#include "algorithm/GlibcStrStr.h"
+
+//
+// Two-Way (Crochemore-Perrin), the length bounded version.
+//
+// The critical factorization of the pattern is computed once by
+// critical_factorization() of GlibcStrStr.h in preprocessing(), and search()
+// honours text_len, so the text may contain '\0' (strstr_glibc() can't).
+// The searching is linear in the worst case with O(1) extra space, so it
+// doesn't degrade on the periodic patterns and the low-entropy texts as the
+// bad character algorithms do.
+//
+// The factorization compares the chars as bytes, so only AnsiString is provided.
+//
+// See: http://www-igm.univ-mlv.fr/~lecroq/string/node26.html
+//
+
+namespace StringMatch {
+
+template <typename CharTy>
+class TwoWayImpl {
+public:
+    typedef TwoWayImpl<CharTy>      this_type;
+    typedef CharTy                  char_type;
+    typedef std::size_t             size_type;
+    typedef typename jstd::uchar_traits<CharTy>::type
+                                    uchar_type;
+
+private:
+    size_type suffix_;      // The index of the right half of the pattern.
+    size_type period_;      // The period of the pattern, or the shift of a mismatch in the left half.
+    bool periodic_;         // Whether the entire pattern has the period.
+
+public:
+    TwoWayImpl() : suffix_(0), period_(1), periodic_(false) {}
+    ~TwoWayImpl() {
+        this->destroy();
+    }
+
+    static const char * name() { return "Two-Way"; }
+    static bool need_preprocessing() { return true; }
+
+    bool is_alive() const { return true; }
+
+    void destroy() {
+    }
+
+    size_type suffix() const { return this->suffix_; }
+    size_type period() const { return this->period_; }
+    bool is_periodic() const { return this->periodic_; }
+
+    /* Preprocessing */
+    bool preprocessing(const char_type * pattern, size_type length) {
+        assert(pattern != nullptr);
+
+        if (likely(length != 0)) {
+            size_type period = 1;
+            size_type suffix = critical_factorization(pattern, length, &period);
+            this->suffix_ = suffix;
+            if (::memcmp((const void *)pattern, (const void *)(pattern + period),
+                         suffix * sizeof(char_type)) == 0) {
+                this->period_ = period;
+                this->periodic_ = true;
+            }
+            else {
+                this->period_ = sm_max(suffix, length - suffix) + 1;
+                this->periodic_ = false;
+            }
+        }
+        else {
+            this->suffix_ = 0;
+            this->period_ = 1;
+            this->periodic_ = false;
+        }
+        return true;
+    }
+
+    /* Searching */
+    SM_NOINLINE_DECLARE(Long)
+    search(const char_type * text, size_type text_len,
+           const char_type * pattern, size_type pattern_len) const {
+        assert(text != nullptr);
+        assert(pattern != nullptr);
+
+        SM_STATS_INC(searches);
+        if (unlikely(pattern_len == 0))
+            return 0;
+
+        if (likely(pattern_len <= text_len)) {
+            const uchar_type * haystack = (const uchar_type *)text;
+            const uchar_type * needle = (const uchar_type *)pattern;
+            const size_type suffix = this->suffix_;
+            const size_type period = this->period_;
+            const size_type scan_len = text_len - pattern_len;
+            size_type i, j = 0;
+
+            if (this->periodic_) {
+                // A mismatch in the left half can only advance by the period, so the
+                // memory skips the repetitions of the period have been scanned.
+                size_type memory = 0;
+                while (j <= scan_len) {
+                    // Scan the right half from left to right.
+                    i = sm_max(suffix, memory);
+                    while (i < pattern_len && needle[i] == haystack[i + j]) {
+                        SM_STATS_INC(comparisons);
+                        ++i;
+                    }
+                    if (pattern_len <= i) {
+                        // Scan the left half from right to left.
+                        i = suffix - 1;
+                        while (memory < i + 1 && needle[i] == haystack[i + j]) {
+                            SM_STATS_INC(comparisons);
+                            --i;
+                        }
+                        if (i + 1 < memory + 1) {
+                            // Has found
+                            return (Long)j;
+                        }
+                        SM_STATS_SHIFT(period);
+                        j += period;
+                        memory = pattern_len - period;
+                    }
+                    else {
+                        SM_STATS_SHIFT(i - suffix + 1);
+                        j += i - suffix + 1;
+                        memory = 0;
+                    }
+                }
+            }
+            else {
+                // The two halves are distinct, any mismatch results in a maximal shift.
+                while (j <= scan_len) {
+                    i = suffix;
+                    while (i < pattern_len && needle[i] == haystack[i + j]) {
+                        SM_STATS_INC(comparisons);
+                        ++i;
+                    }
+                    if (pattern_len <= i) {
+                        i = suffix - 1;
+                        while (i != (size_type)-1 && needle[i] == haystack[i + j]) {
+                            SM_STATS_INC(comparisons);
+                            --i;
+                        }
+                        if (i == (size_type)-1) {
+                            // Has found
+                            return (Long)j;
+                        }
+                        SM_STATS_SHIFT(period);
+                        j += period;
+                    }
+                    else {
+                        SM_STATS_SHIFT(i - suffix + 1);
+                        j += i - suffix + 1;
+                    }
+                }
+            }
+        }
+
+        return Status::NotFound;
+    }
+};
+
+namespace AnsiString {
+    typedef AlgorithmWrapper< TwoWayImpl<char> >    TwoWay;
+}
+
+} // namespace StringMatch
+
+#endif // STRING_MATCH_TWO_WAY_H
@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <cstddef>
 #include <memory>
+#include <limits>
 #include <algorithm>
 
 #include "StringMatch.h"
@@ -85,6 +86,7 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         // check arg sizes 
         if (!((text_len < pattern_len * 2) ||
              (pattern_len < 2 * kWordSize - 1) ||
@@ -99,36 +101,46 @@ public:
                 size_type word = static_cast<size_type>(*(word_t *)src);
                 size_type offset = this->hashmap_.getv(word);
                 if (likely(offset == 0)) {
+                    SM_STATS_SHIFT(pattern_len - kWordSize + 1);
                     src += pattern_len - kWordSize + 1;
                 }
                 else {
-                    ssize_type index;
+                    // The chain isn't sorted by the offset, verify all of it and keep
+                    // the leftmost match. The matches found at the later words of text
+                    // always start behind the ones found at this word.
+                    const char_type * match_start = nullptr;
+                    SM_STATS_INC(filter_hits);
                     do {
                         const char_type * src_start = src - (offset - 1);
                         if (likely((src_start + pattern_len) <= text_end)) {
                             const char_type * target = pattern;
+                            SM_STATS_INC(verifications);
                             while (target < pattern_end) {
                                 assert(src_start >= text);
                                 assert(src_start < text_end);
+                                SM_STATS_INC(comparisons);
                                 if (*src_start++ != *target++) {
-                                    word = this->hashmap_.nextKey(word);
+                                    SM_STATS_INC(false_positives);
                                     goto SKIP_TO_NEXT_HASH;
                                 }
                             }
+
+                            src_start = src - (offset - 1);
+                            if (match_start == nullptr || src_start < match_start)
+                                match_start = src_start;
                         }
-                        else {
-                            word = this->hashmap_.nextKey(word);
-                            goto SKIP_TO_NEXT_HASH;
-                        }
+SKIP_TO_NEXT_HASH:
+                        word = this->hashmap_.nextKey(word);
+                    } while ((offset = this->hashmap_.getv(word)) != 0);
 
-                        index = src - (offset - 1) - text;
+                    if (match_start != nullptr) {
+                        ssize_type index = match_start - text;
                         assert(index >= 0);
                         assert(index < ssize_type(text_len));
                         return Long(index);
-SKIP_TO_NEXT_HASH:
-                        ;
-                    } while ((offset = this->hashmap_.getv(word)) != 0);
+                    }
 
+                    SM_STATS_SHIFT(pattern_len - kWordSize + 1);
                     src += pattern_len - kWordSize + 1;
                 }
             }
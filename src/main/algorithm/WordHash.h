@@ -144,6 +144,7 @@ public:
         assert(text != nullptr);
         assert(pattern != nullptr);
 
+        SM_STATS_INC(searches);
         // check arg sizes 
         if (!((text_len < pattern_len * 2) ||
              (pattern_len < 2 * kWordSize - 1) ||
@@ -158,12 +159,18 @@ public:
                 size_type word = static_cast<size_type>(*(word_t *)src_start);
                 size_type exists = this->hashmap_.getv(word);
                 if (likely(exists == 0)) {
+                    SM_STATS_SHIFT(pattern_len - kWordSize + 1);
                     src_start += pattern_len - kWordSize + 1;
                 }
                 else {
                     const char_type * source = src_start - (pattern_len - kWordSize);
                     const char_type * target = pattern;
+                    SM_STATS_INC(filter_hits);
+                    SM_STATS_INC(verifications);
+                    SM_STATS_INC(comparisons);
                     if (likely(*source != *target)) {
+                        SM_STATS_INC(false_positives);
+                        SM_STATS_SHIFT(1);
                         src_start += 1;
                     }
                     else {
@@ -172,7 +179,10 @@ public:
                         source++;
                         target++;
                         do {
+                            SM_STATS_INC(comparisons);
                             if (likely(*source != *target)) {
+                                SM_STATS_INC(false_positives);
+                                SM_STATS_SHIFT(1);
                                 src_start += 1;
                                 goto SKIP_TO_NEXT_POS;
                             }
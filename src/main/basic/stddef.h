@@ -188,6 +188,23 @@
 
 #endif // SM_INLINE
 
+// Declare for the instruction set of a function (target attributes),
+// so a kernel can use the intrinsics of its own ISA without global -m flags.
+
+#if (defined(__GNUC__) && ((__GNUC__ >= 5) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))) \
+ || defined(__clang__)
+#define SM_HAS_TARGET_ATTRIBUTE         1
+#define SM_TARGET(isa)                  __attribute__((target(isa)))
+#else
+#define SM_HAS_TARGET_ATTRIBUTE         0
+#define SM_TARGET(isa)
+#endif // SM_TARGET
+
+#define SM_TARGET_SSSE3                 SM_TARGET("ssse3")
+#define SM_TARGET_SSE42                 SM_TARGET("sse4.2")
+#define SM_TARGET_AVX2                  SM_TARGET("avx2")
+#define SM_TARGET_AVX512BW              SM_TARGET("avx512f,avx512bw")
+
 
 #ifndef __SM_CDECL
 #if defined(_MSC_VER) || defined(__ICL) || defined(__INTEL_COMPILER)
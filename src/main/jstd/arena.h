@@ -0,0 +1,142 @@
+
+#ifndef JSTD_ARENA_H
+#define JSTD_ARENA_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <stdlib.h>
+#include <assert.h>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+namespace jstd {
+
+//
+// A growable arena of nodes which owned by one object (e.g. an automation).
+//
+// The nodes are allocated from chunks one by one, the chunks are aligned to
+// the cache line and every node starts at a cache line. The chunk size grows
+// from kMinChunkNodes to kMaxChunkNodes. The nodes are never freed one by one,
+// destroy() releases all of the chunks at once, so the node type must be
+// trivially destructible.
+//
+template <typename T, std::size_t Alignment = 64>
+class arena {
+public:
+    typedef T                   value_type;
+    typedef arena<T, Alignment> this_type;
+    typedef std::size_t         size_type;
+
+    static const size_type kAlignment = Alignment;
+    static const size_type kNodeStride = (sizeof(value_type) + kAlignment - 1) & ~(kAlignment - 1);
+
+    static const size_type kMinChunkNodes = 16;
+    static const size_type kMaxChunkNodes = 1024;
+
+private:
+    std::vector<void *> chunks_;
+    char * cursor_;
+    char * limit_;
+    size_type chunk_nodes_;
+    size_type size_;
+    size_type capacity_bytes_;
+
+public:
+    arena() : cursor_(nullptr), limit_(nullptr), chunk_nodes_(kMinChunkNodes),
+              size_(0), capacity_bytes_(0) {
+        static_assert(std::is_trivially_destructible<value_type>::value,
+                      "jstd::arena<T>: T must be trivially destructible.");
+    }
+    ~arena() {
+        this->destroy();
+    }
+
+    arena(const arena &) = delete;
+    arena & operator = (const arena &) = delete;
+
+    // The numbers of the allocated nodes.
+    size_type size() const { return this->size_; }
+
+    // The total bytes of the chunks.
+    size_type memory_usage() const { return this->capacity_bytes_; }
+
+    void destroy() {
+        for (size_type i = 0; i < this->chunks_.size(); ++i) {
+            this_type::aligned_free(this->chunks_[i]);
+        }
+        this->chunks_.clear();
+        this->cursor_ = nullptr;
+        this->limit_ = nullptr;
+        this->chunk_nodes_ = kMinChunkNodes;
+        this->size_ = 0;
+        this->capacity_bytes_ = 0;
+    }
+
+    void * allocate() {
+        if (unlikely(this->cursor_ >= this->limit_)) {
+            if (unlikely(!this->grow()))
+                return nullptr;
+        }
+        void * node = (void *)this->cursor_;
+        this->cursor_ += kNodeStride;
+        this->size_++;
+        return node;
+    }
+
+    value_type * create() {
+        void * node_ptr = this->allocate();
+        if (likely(node_ptr != nullptr))
+            return new (node_ptr) value_type();
+        else
+            return nullptr;
+    }
+
+private:
+    bool grow() {
+        size_type chunk_bytes = this->chunk_nodes_ * kNodeStride;
+        void * chunk = this_type::aligned_malloc(chunk_bytes, kAlignment);
+        if (likely(chunk != nullptr)) {
+            this->chunks_.push_back(chunk);
+            this->cursor_ = (char *)chunk;
+            this->limit_ = (char *)chunk + chunk_bytes;
+            this->capacity_bytes_ += chunk_bytes;
+            if (this->chunk_nodes_ < kMaxChunkNodes)
+                this->chunk_nodes_ *= 2;
+            return true;
+        }
+        return false;
+    }
+
+    static void * aligned_malloc(size_type size, size_type alignment) {
+#if defined(_MSC_VER)
+        return ::_aligned_malloc(size, alignment);
+#else
+        void * ptr = nullptr;
+        int err = ::posix_memalign(&ptr, alignment, size);
+        return ((err == 0) ? ptr : nullptr);
+#endif
+    }
+
+    static void aligned_free(void * ptr) {
+#if defined(_MSC_VER)
+        ::_aligned_free(ptr);
+#else
+        ::free(ptr);
+#endif
+    }
+};
+
+} // namespace jstd
+
+#endif // JSTD_ARENA_H
@@ -6,8 +6,31 @@
 #pragma once
 #endif
 
+#include <cstddef>
+
 namespace jstd {
 
+// jstd::uchar_of_size<N>
+
+template <std::size_t CharSize>
+struct uchar_of_size {
+};
+
+template <>
+struct uchar_of_size<1> {
+    typedef unsigned char type;
+};
+
+template <>
+struct uchar_of_size<2> {
+    typedef unsigned short type;
+};
+
+template <>
+struct uchar_of_size<4> {
+    typedef unsigned int type;
+};
+
 // jstd::uchar_traits<T>
 
 template <typename CharTy>
@@ -35,6 +58,22 @@ struct uchar_traits<long> {
     typedef unsigned long type;
 };
 
+// wchar_t is 16 bits on Windows, and 32 bits on gcc and clang.
+template <>
+struct uchar_traits<wchar_t> {
+    typedef uchar_of_size<sizeof(wchar_t)>::type type;
+};
+
+template <>
+struct uchar_traits<char16_t> {
+    typedef char16_t type;
+};
+
+template <>
+struct uchar_traits<char32_t> {
+    typedef char32_t type;
+};
+
 // jstd::schar_traits<T>
 
 template <typename CharTy>
@@ -126,6 +165,16 @@ struct is_wchar<wchar_t> {
     static const bool value = true;
 };
 
+template <>
+struct is_wchar<char16_t> {
+    static const bool value = true;
+};
+
+template <>
+struct is_wchar<char32_t> {
+    static const bool value = true;
+};
+
 } // namespace jstd
 
 #endif // JSTD_CHAR_TRAITS_H
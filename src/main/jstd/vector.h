@@ -97,6 +97,10 @@ public:
         this->reserve_fast(new_capacity);
     }
 
+    void clear() {
+        this->size_ = 0;
+    }
+
     void emplace_back(const value_type & value) {
         if (unlikely(this->size_ >= this->capacity_)) {
             this->reserve_fast(this->capacity_ * 2);
@@ -7,10 +7,16 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <ctype.h>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <algorithm>
 
 #ifndef __cplusplus
 #include <stdalign.h>   // C11 defines _Alignas().  This header defines alignas()
@@ -22,9 +28,13 @@
 
 #define SWITCH_BENCHMARK_TEST       0
 #define ENABLE_AHOCORASICK_TEST     0
+#define ENABLE_MULTITHREAD_TEST     1
+#define ENABLE_PARALLEL_TEST        1
 
 #include "StringMatch.h"
 #include "support/StopWatch.h"
+#include "support/Corpus.h"
+#include "support/BenchmarkRunner.h"
 
 #include "algorithm/StrStr.h"
 #include "algorithm/MemMem.h"
@@ -36,6 +46,12 @@
 #include "algorithm/SSEStrStrA.h"
 #include "algorithm/SSEStrStrA_v0.h"
 #include "algorithm/SSEStrStrA_v2.h"
+#include "algorithm/AvxStrStr.h"
+#include "algorithm/Avx512StrStr.h"
+#include "algorithm/AutoStrStr.h"
+#include "algorithm/TwoWay.h"
+#include "algorithm/SmartPattern.h"
+#include "algorithm/AutoTune.h"
 #include "algorithm/MyMemMem.h"
 #include "algorithm/MyMemMemBw.h"
 #include "algorithm/FastStrStr.h"
@@ -50,10 +66,19 @@
 #include "algorithm/BMTuned.h"
 #include "algorithm/ShiftAnd.h"
 #include "algorithm/ShiftOr.h"
+#include "algorithm/ShiftOrWide.h"
+#include "algorithm/NoCaseStrStr.h"
+#include "algorithm/Teddy.h"
+#include "algorithm/FDR.h"
+#include "algorithm/MultiPattern.h"
 #include "algorithm/WordHash.h"
 #include "algorithm/Volnitsky.h"
 #include "algorithm/Rabin-Karp.h"
 #include "algorithm/AhoCorasick.h"
+#include "algorithm/CompactAhoCorasick.h"
+#include "algorithm/ParallelSearcher.h"
+#include "algorithm/StreamMatcher.h"
+#include "algorithm/FileSearch.h"
 
 using namespace StringMatch;
 
@@ -217,6 +242,50 @@ void StringMatch_usage_examples()
             Long pos = AnsiString::Kmp::match(matcher, pattern);
         }
     }
+
+    // Usage 7
+    {
+        AnsiString::Kmp::Pattern pattern("aa");
+        if (pattern.has_compiled()) {
+            size_t overlapping = pattern.count("aaaa");     // 3
+            size_t non_overlapping = pattern.count("aaaa", MatchMode::NonOverlapping);  // 2
+            size_t sum = pattern.match_all("aaaa", [](Long pos) { /* ... */ });
+        }
+    }
+
+    // Usage 8
+    {
+        AnsiString::Kmp::Pattern pattern("example");
+        if (pattern.has_compiled()) {
+            for (Long pos : pattern.matches("An example, another example.")) {
+                // pos = 3, 20
+            }
+        }
+    }
+
+    // Usage 9
+    {
+        AhoCorasickImpl<char> keywords;
+        keywords.add_pattern(0, "he", 2);
+        keywords.add_pattern(1, "she", 3);
+        keywords.add_pattern(2, "hers", 4);
+        if (keywords.compile()) {
+            size_t sum = keywords.search_all("ushers", 6, [](int pattern_id, size_t start, size_t end) {
+                // (1, 1, 4), (0, 2, 4), (2, 2, 6)
+            });
+        }
+    }
+
+    // Usage 10
+    {
+        AnsiString::Kmp::Pattern pattern("example");
+        StreamMatcher<AnsiString::Kmp> stream(pattern);
+        stream.feed("Here is a sample exa", 20, [](uint64_t offset) { /* ... */ });
+        stream.feed("mple.", 5, [](uint64_t offset) {
+            // offset = 17
+        });
+        uint64_t matches = stream.finish();     // 1
+    }
 }
 
 template <typename AlgorithmTy>
@@ -337,6 +406,421 @@ void StringMatch_verify()
     //printf("\n");
 }
 
+//
+// Verify a pattern of the given length, the text has a match in the middle.
+// The bit-parallel algorithms are limited to the bits of the mask word,
+// test the length of the mask word and the lengths around it.
+//
+template <typename AlgorithmTy, typename StandardAlgorithmTy>
+void StringMatch_verify_pattern_len(size_t pattern_len)
+{
+    std::string pattern;
+    for (size_t i = 0; i < pattern_len; ++i) {
+        pattern.push_back((char)('a' + (i % 26)));
+    }
+
+    std::string text(pattern_len / 2 + 7, '#');
+    text += pattern;
+    text.append(pattern_len / 2, '#');
+
+    Long index_of_1 = AlgorithmTy::match(text.c_str(), text.size(),
+                                         pattern.c_str(), pattern.size());
+    Long index_of_2 = StandardAlgorithmTy::match(text.c_str(), text.size(),
+                                                 pattern.c_str(), pattern.size());
+    if (index_of_1 != index_of_2) {
+        printf("%s: pattern_len = %" PRIuPTR "\n", AlgorithmTy::name(), pattern_len);
+        printf("index_of_1: %" PRIiPTR ", index_of_2: %" PRIiPTR "\n\n",
+               index_of_1, index_of_2);
+    }
+}
+
+//
+// Verify the periodic texts and patterns ("bbbb" in "bbbbbbbb"), a pattern matches at
+// many overlapping positions, and the first match and the overlapping count must be
+// the same as StandardAlgorithmTy.
+//
+template <typename AlgorithmTy, typename StandardAlgorithmTy>
+void StringMatch_verify_periodic()
+{
+    typedef typename AlgorithmTy::Pattern pattern_type;
+    typedef typename StandardAlgorithmTy::Pattern standard_pattern_type;
+
+    for (size_t pattern_len = 1; pattern_len <= 16; ++pattern_len) {
+        for (size_t text_len = pattern_len; text_len <= 64; ++text_len) {
+            for (size_t period = 1; period <= 2; ++period) {
+                std::string pattern, text;
+                for (size_t i = 0; i < pattern_len; ++i)
+                    pattern.push_back((char)('a' + (i % period)));
+                for (size_t i = 0; i < text_len; ++i)
+                    text.push_back((char)('a' + (i % period)));
+
+                pattern_type pattern_1(pattern.c_str(), pattern.size());
+                standard_pattern_type pattern_2(pattern.c_str(), pattern.size());
+                Long index_of_1 = pattern_1.match(text.c_str(), text.size());
+                Long index_of_2 = pattern_2.match(text.c_str(), text.size());
+                size_t matches_1 = pattern_1.count(text.c_str(), text.size());
+                size_t matches_2 = pattern_2.count(text.c_str(), text.size());
+                if (index_of_1 != index_of_2 || matches_1 != matches_2) {
+                    printf("%s: text = \"%s\", pattern = \"%s\"\n",
+                           AlgorithmTy::name(), text.c_str(), pattern.c_str());
+                    printf("index_of_1: %" PRIiPTR ", index_of_2: %" PRIiPTR ", "
+                           "matches_1: %" PRIuPTR ", matches_2: %" PRIuPTR "\n\n",
+                           index_of_1, index_of_2, matches_1, matches_2);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+//
+// Verify a case-insensitive search by StandardAlgorithmTy on the lowercase copies
+// of the text and the pattern. The cases of the letters are flipped at random,
+// and the chars next to the letters ('@', '[', '`', '{') must not be folded.
+//
+template <typename AlgorithmTy, typename StandardAlgorithmTy>
+void StringMatch_verify_nocase()
+{
+    static const char kChars[] = "aAbBzZ@[`{ 09";
+
+    test::CorpusRandom random(20201018ULL);
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < kSearchTexts; ++i) {
+        texts.push_back(SearchTexts[i]);
+    }
+    for (size_t length = 1; length <= 300; length += 7) {
+        std::string text;
+        for (size_t i = 0; i < length; ++i)
+            text.push_back(kChars[random.next(sizeof(kChars) - 1)]);
+        texts.push_back(text);
+    }
+
+    for (size_t i = 0; i < texts.size(); ++i) {
+        std::vector<std::string> patterns;
+        for (size_t j = 0; j < kPatterns; ++j) {
+            patterns.push_back(Patterns[j]);
+        }
+        for (size_t j = 0; j < 16; ++j) {
+            size_t length = 1 + random.next(sm_min(texts[i].size(), (size_t)40));
+            patterns.push_back(texts[i].substr(random.next(texts[i].size() - length + 1), length));
+        }
+
+        for (size_t j = 0; j < patterns.size(); ++j) {
+            std::string text = texts[i], pattern = patterns[j];
+            std::string lower_text = text, lower_pattern = pattern;
+            for (size_t k = 0; k < text.size(); ++k) {
+                lower_text[k] = (char)::tolower((unsigned char)text[k]);
+                if (::isalpha((unsigned char)text[k]) && random.next(2) != 0)
+                    text[k] = (char)(text[k] ^ 0x20);
+            }
+            for (size_t k = 0; k < pattern.size(); ++k) {
+                lower_pattern[k] = (char)::tolower((unsigned char)pattern[k]);
+                if (::isalpha((unsigned char)pattern[k]) && random.next(2) != 0)
+                    pattern[k] = (char)(pattern[k] ^ 0x20);
+            }
+
+            Long index_of_1 = AlgorithmTy::match(text.c_str(), text.size(),
+                                                 pattern.c_str(), pattern.size());
+            Long index_of_2 = StandardAlgorithmTy::match(lower_text.c_str(), lower_text.size(),
+                                                         lower_pattern.c_str(), lower_pattern.size());
+            if (index_of_1 != index_of_2) {
+                printf("%s: text = \"%s\",\n", AlgorithmTy::name(), text.c_str());
+                printf("pattern = \"%s\"\n", pattern.c_str());
+                printf("index_of_1: %" PRIiPTR ", index_of_2: %" PRIiPTR "\n\n",
+                       index_of_1, index_of_2);
+            }
+        }
+    }
+}
+
+//
+// The pattern longer than AlgorithmTy can handle must not be matched at a wrong position,
+// the search fails instead. Not an assert(), it's tested in the release build too.
+//
+template <typename AlgorithmTy>
+void StringMatch_verify_too_long(size_t pattern_len, size_t text_len)
+{
+    typedef typename AlgorithmTy::Pattern pattern_type;
+
+    std::string pattern(pattern_len, 'a');
+    std::string text(text_len, 'a');
+
+    pattern_type pattern_obj(pattern.c_str(), pattern.size());
+    Long index_of = pattern_obj.match(text.c_str(), text.size());
+    size_t matches = pattern_obj.count(text.c_str(), text.size());
+    if (index_of != Status::InvalidParameter || matches != 0) {
+        printf("%s: pattern_len = %" PRIuPTR ", text_len = %" PRIuPTR "\n",
+               AlgorithmTy::name(), pattern_len, text_len);
+        printf("index_of: %" PRIiPTR ", matches: %" PRIuPTR "\n\n", index_of, matches);
+    }
+}
+
+//
+// A Pattern of AutoTune shared by many threads must keep retuning, the racing
+// counter of the pinned searches used to leave it in a trial for good.
+//
+void StringMatch_verify_auto_tune(size_t thread_num)
+{
+    typedef AnsiString::AutoTune::Pattern pattern_type;
+    static const size_t kRounds = 2000;
+
+    // Retune at every check, so the trials race with the pinned searches. The check
+    // interval is longer than a trial, so a stale count of the pinned searches used
+    // to push the trial past its end.
+    AutoTuneOptions saved_options = AutoTuneOptions::global();
+    AutoTuneOptions options;
+    options.trial_rounds = 1;
+    options.check_interval = 64;
+    options.retune_seconds = 1.0e-6;
+    AutoTuneOptions::set_global(options);
+    pattern_type pattern(Patterns[0]);
+    AutoTuneOptions::set_global(saved_options);
+
+    Long expected[kSearchTexts];
+    for (size_t i = 0; i < kSearchTexts; ++i) {
+        expected[i] = AnsiString::StrStr::match(SearchTexts[i], ::strlen(SearchTexts[i]),
+                                                pattern.c_str(), pattern.size());
+    }
+
+    std::atomic<size_t> mismatches(0);
+    std::vector<std::thread> workers;
+    workers.reserve(thread_num);
+    for (size_t t = 0; t < thread_num; ++t) {
+        workers.emplace_back([&]() {
+            size_t errors = 0;
+            for (size_t loop = 0; loop < kRounds; ++loop) {
+                for (size_t i = 0; i < kSearchTexts; ++i) {
+                    if (pattern.match(SearchTexts[i], ::strlen(SearchTexts[i])) != expected[i])
+                        errors++;
+                }
+            }
+            mismatches += errors;
+        });
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    uint64_t threaded_tunings = pattern.algorithm().tunings();
+
+    // The trials must still finish after the threads have gone.
+    for (size_t loop = 0; loop < kRounds; ++loop) {
+        for (size_t i = 0; i < kSearchTexts; ++i) {
+            if (pattern.match(SearchTexts[i], ::strlen(SearchTexts[i])) != expected[i])
+                mismatches++;
+        }
+    }
+    uint64_t tunings = pattern.algorithm().tunings();
+
+    if (mismatches.load() != 0 || threaded_tunings == 0 || tunings <= threaded_tunings) {
+        printf("%s: threads = %" PRIuPTR ", mismatches = %" PRIuPTR "\n",
+               AnsiString::AutoTune::name(), thread_num, mismatches.load());
+        printf("tunings: %" PRIu64 " (threads), %" PRIu64 " (single thread)\n\n",
+               threaded_tunings, tunings);
+    }
+}
+
+//
+// The multi-pattern engines report the matches in their own orders (by the start
+// or by the end), so the matches are sorted before they are compared.
+//
+struct MultiPatternMatch {
+    int id;
+    size_t start;
+    size_t end;
+
+    bool operator < (const MultiPatternMatch & rhs) const {
+        if (this->start != rhs.start)
+            return (this->start < rhs.start);
+        if (this->end != rhs.end)
+            return (this->end < rhs.end);
+        return (this->id < rhs.id);
+    }
+
+    bool operator == (const MultiPatternMatch & rhs) const {
+        return (this->id == rhs.id && this->start == rhs.start && this->end == rhs.end);
+    }
+};
+
+// All the overlapping matches of all patterns, by memcmp() at every position.
+void StringMatch_naive_search_all(const std::vector<std::string> & patterns, const std::string & text,
+                                  std::vector<MultiPatternMatch> & matches)
+{
+    matches.clear();
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        const std::string & pattern = patterns[id];
+        for (size_t pos = 0; pos + pattern.size() <= text.size(); ++pos) {
+            if (::memcmp(text.data() + pos, pattern.data(), pattern.size()) == 0) {
+                MultiPatternMatch match = { (int)id, pos, pos + pattern.size() };
+                matches.push_back(match);
+            }
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+}
+
+// Return false if a pattern is refused or compile() fails.
+template <typename MultiPatternTy>
+bool StringMatch_search_all(const std::vector<std::string> & patterns, const std::string & text,
+                            std::vector<MultiPatternMatch> & matches)
+{
+    matches.clear();
+
+    MultiPatternTy engine;
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        if (!engine.add_pattern((int)id, patterns[id].data(), patterns[id].size()))
+            return false;
+    }
+    if (!engine.compile())
+        return false;
+
+    engine.search_all(text.data(), text.size(),
+        [&matches](int pattern_id, size_t start, size_t end) {
+            MultiPatternMatch match = { pattern_id, start, end };
+            matches.push_back(match);
+        });
+    std::sort(matches.begin(), matches.end());
+    return true;
+}
+
+template <typename MultiPatternTy>
+void StringMatch_verify_search_all(const std::vector<std::string> & patterns, const std::string & text,
+                                   const std::vector<MultiPatternMatch> & expected)
+{
+    std::vector<MultiPatternMatch> matches;
+    bool success = StringMatch_search_all<MultiPatternTy>(patterns, text, matches);
+    if (!success || matches != expected) {
+        printf("%s: patterns = %" PRIuPTR ", text_len = %" PRIuPTR "\n",
+               MultiPatternTy::name(), patterns.size(), text.size());
+        printf("compiled: %d, matches: %" PRIuPTR ", expected: %" PRIuPTR "\n\n",
+               (int)success, matches.size(), expected.size());
+    }
+}
+
+// The patterns are the slices of text (so most of them match) and some random ones.
+void StringMatch_make_pattern_set(test::CorpusRandom & random, const std::string & text,
+                                  size_t num_patterns, size_t min_len, size_t max_len,
+                                  std::vector<std::string> & patterns)
+{
+    patterns.clear();
+    for (size_t i = 0; i < num_patterns; ++i) {
+        size_t length = min_len + random.next(max_len - min_len + 1);
+        if ((i % 4) != 3) {
+            size_t pos = random.next(text.size() - length + 1);
+            patterns.push_back(text.substr(pos, length));
+        }
+        else {
+            std::string pattern;
+            for (size_t j = 0; j < length; ++j)
+                pattern.push_back(text[random.next(text.size())]);
+            patterns.push_back(pattern);
+        }
+    }
+}
+
+// The binary text: all the 256 bytes, or only 4 bytes (0x00, 0x80, 0xFF, 'a') for many matches.
+std::string StringMatch_make_binary_text(test::CorpusRandom & random, size_t length, bool few_bytes)
+{
+    static const unsigned char kFewBytes[] = { 0x00, 0x80, 0xFF, 'a' };
+    std::string text;
+    text.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        if (few_bytes)
+            text.push_back((char)kFewBytes[random.next(sizeof(kFewBytes))]);
+        else
+            text.push_back((char)random.next(256));
+    }
+    return text;
+}
+
+//
+// Verify Teddy and ShiftOrMulti by a naive scan, up to their limit of 64 patterns,
+// and the 65th pattern must be refused.
+//
+void StringMatch_verify_small_pattern_sets()
+{
+    static const size_t kPatternSetSizes[] = { 1, 2, 8, 9, 33, 63, 64 };
+
+    test::CorpusRandom random(20201017ULL);
+    std::vector<std::string> patterns;
+    std::vector<MultiPatternMatch> expected;
+
+    for (int few_bytes = 0; few_bytes <= 1; ++few_bytes) {
+        std::string text = StringMatch_make_binary_text(random, 64 * 1024, (few_bytes != 0));
+        for (size_t i = 0; i < sm_countof_i(kPatternSetSizes); ++i) {
+            // ShiftOrMulti takes the patterns of up to 64 chars.
+            StringMatch_make_pattern_set(random, text, kPatternSetSizes[i], 1, 64, patterns);
+            StringMatch_naive_search_all(patterns, text, expected);
+            StringMatch_verify_search_all<TeddyImpl<char>>(patterns, text, expected);
+            StringMatch_verify_search_all<ShiftOrMultiImpl<char>>(patterns, text, expected);
+        }
+    }
+
+    std::string pattern(1, 'a');
+    TeddyImpl<char> teddy;
+    ShiftOrMultiImpl<char> shift_or_multi;
+    for (size_t i = 0; i < TeddyImpl<char>::kMaxPatterns; ++i) {
+        teddy.add_pattern((int)i, pattern.data(), pattern.size());
+        shift_or_multi.add_pattern((int)i, pattern.data(), pattern.size());
+    }
+    if (teddy.add_pattern(64, pattern.data(), pattern.size()))
+        printf("%s: the 65th pattern is accepted.\n\n", TeddyImpl<char>::name());
+    if (shift_or_multi.add_pattern(64, pattern.data(), pattern.size()))
+        printf("%s: the 65th pattern is accepted.\n\n", ShiftOrMultiImpl<char>::name());
+}
+
+//
+// Verify FDR and MultiPattern by CompactAhoCorasick, at the both sides of the
+// switch points of the engines of MultiPattern (64 and 10,000 patterns).
+//
+void StringMatch_verify_large_pattern_sets()
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    static const size_t kMaxTeddy = MultiPatternImpl<char>::kMaxTeddyPatterns;
+    static const size_t kMaxFdr = MultiPatternImpl<char>::kMaxFdrPatterns;
+    static const size_t kPatternSetSizes[] = { kMaxTeddy, kMaxTeddy + 1, kMaxFdr, kMaxFdr + 1 };
+    static const MultiPatternEngine::Type kEngines[] = {
+        MultiPatternEngine::Teddy, MultiPatternEngine::FDR,
+        MultiPatternEngine::FDR, MultiPatternEngine::CompactAC
+    };
+
+    test::CorpusRandom random(20201018ULL);
+    std::vector<std::string> patterns;
+    std::vector<MultiPatternMatch> expected;
+
+    for (int hex_text = 0; hex_text <= 1; ++hex_text) {
+        std::string text;
+        if (hex_text != 0) {
+            for (size_t i = 0; i < 256 * 1024; ++i)
+                text.push_back(kHexDigits[random.next(16)]);
+        }
+        else {
+            text = StringMatch_make_binary_text(random, 256 * 1024, false);
+        }
+
+        for (size_t i = 0; i < sm_countof_i(kPatternSetSizes); ++i) {
+            StringMatch_make_pattern_set(random, text, kPatternSetSizes[i], 4, 16, patterns);
+            if (!StringMatch_search_all<CompactAhoCorasickImpl<char>>(patterns, text, expected)) {
+                printf("%s: patterns = %" PRIuPTR " can't be compiled.\n\n",
+                       CompactAhoCorasickImpl<char>::name(), patterns.size());
+                continue;
+            }
+            StringMatch_verify_search_all<FdrImpl<char>>(patterns, text, expected);
+            StringMatch_verify_search_all<MultiPatternImpl<char>>(patterns, text, expected);
+
+            MultiPatternImpl<char> multi_pattern;
+            for (size_t id = 0; id < patterns.size(); ++id)
+                multi_pattern.add_pattern((int)id, patterns[id].data(), patterns[id].size());
+            multi_pattern.compile();
+            if (multi_pattern.engine() != kEngines[i]) {
+                printf("%s: patterns = %" PRIuPTR ", engine = %s, expected: %s\n\n",
+                       MultiPatternImpl<char>::name(), patterns.size(),
+                       MultiPatternEngine::name(multi_pattern.engine()),
+                       MultiPatternEngine::name(kEngines[i]));
+            }
+        }
+    }
+}
+
 template <typename AlgorithmTy>
 void StringMatch_benchmark()
 {
@@ -507,6 +991,940 @@ void StringMatch_benchmark()
 #endif
 }
 
+template <typename AhoCorasickTy>
+void StringMatch_multi_pattern_benchmark()
+{
+    static const size_t iters = kIterations / (kSearchTexts * 16) + 1;
+
+    test::StopWatch sw;
+    double preprocessing_time, searching_time;
+    size_t checksum = 0;
+
+    // Preprocessing: all of patterns are in one automation.
+    AhoCorasickTy automation;
+    sw.start();
+    for (size_t i = 0; i < kPatterns; ++i) {
+        automation.add_pattern((int)i, Patterns[i], ::strlen(Patterns[i]));
+    }
+    automation.compile();
+    sw.stop();
+    preprocessing_time = sw.getMillisec();
+
+    StringRef texts[kSearchTexts];
+    for (size_t i = 0; i < kSearchTexts; ++i) {
+        texts[i].set_data(SearchTexts[i], ::strlen(SearchTexts[i]));
+    }
+
+    // Searching: one pass per text.
+    sw.start();
+    for (size_t loop = 0; loop < iters; ++loop) {
+        for (size_t i = 0; i < kSearchTexts; ++i) {
+            automation.search_all(texts[i].c_str(), texts[i].size(),
+                [&checksum](int pattern_id, size_t start, size_t end) {
+                    checksum += (size_t)pattern_id + start;
+                });
+        }
+    }
+    sw.stop();
+    searching_time = sw.getMillisec();
+
+    printf("  %-22s   %-12u %8u    %10.1f KB    %8.3f ms    %8.3f ms\n",
+           AhoCorasickTy::name(), (unsigned int)checksum,
+           (unsigned int)automation.state_count(),
+           automation.memory_usage() / 1024.0,
+           preprocessing_time, searching_time);
+}
+
+static const size_t kKeywordSetSize = 10000;
+static const size_t kKeywordSetTextSize = 4 * 1024 * 1024;
+
+//
+// A large keyword set, such as the hashes of the threat indicators: 10,000
+// hex strings of 8 - 16 chars, and a log text which contains some of them.
+// The 2 KB nodes of AhoCorasick are far out of the caches here.
+//
+void StringMatch_make_keyword_set(std::vector<std::string> & keywords, test::Corpus & corpus)
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+
+    test::CorpusRandom random(20201017ULL);
+    keywords.clear();
+    keywords.reserve(kKeywordSetSize);
+    for (size_t i = 0; i < kKeywordSetSize; ++i) {
+        std::string keyword;
+        size_t length = 8 + random.next(9);
+        for (size_t j = 0; j < length; ++j) {
+            keyword.push_back(kHexDigits[random.next(16)]);
+        }
+        keywords.push_back(keyword);
+    }
+
+    // Plant every 16th keyword into the text once.
+    corpus.generate(test::CorpusType::Log, kKeywordSetTextSize);
+    std::string text(corpus.data(), corpus.size());
+    for (size_t i = 0; i < kKeywordSetSize; i += 16) {
+        size_t pos = random.next(text.size() - keywords[i].size());
+        text.replace(pos, keywords[i].size(), keywords[i]);
+    }
+    corpus.set_text("Log (keywords)", text);
+}
+
+template <typename AhoCorasickTy>
+void StringMatch_keyword_set_benchmark(const std::vector<std::string> & keywords,
+                                       const test::Corpus & corpus)
+{
+    static const size_t iters = 4;
+
+    test::StopWatch sw;
+    double preprocessing_time, searching_time;
+    size_t checksum = 0;
+
+    AhoCorasickTy automation;
+    sw.start();
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        automation.add_pattern((int)i, keywords[i].c_str(), keywords[i].size());
+    }
+    automation.compile();
+    sw.stop();
+    preprocessing_time = sw.getMillisec();
+
+    sw.start();
+    for (size_t loop = 0; loop < iters; ++loop) {
+        automation.search_all(corpus.data(), corpus.size(),
+            [&checksum](int pattern_id, size_t start, size_t end) {
+                checksum += (size_t)pattern_id + start;
+            });
+    }
+    sw.stop();
+    searching_time = sw.getMillisec();
+
+    printf("  %-22s   %-12u %8u    %10.1f KB    %8.3f ms    %8.3f ms\n",
+           AhoCorasickTy::name(), (unsigned int)checksum,
+           (unsigned int)automation.state_count(),
+           automation.memory_usage() / 1024.0,
+           preprocessing_time, searching_time);
+}
+
+//
+// All of the threads share the same compiled patterns, every result must be
+// the same as the single thread's. Build with STRING_MATCH_ENABLE_TSAN=ON to
+// check the data races of the search() with ThreadSanitizer.
+//
+template <typename AlgorithmTy>
+void StringMatch_multithread_benchmark(size_t thread_num)
+{
+    typedef typename AlgorithmTy::Pattern pattern_type;
+
+    static const size_t iters = kIterations / (kSearchTexts * kPatterns * 4) + 1;
+
+    test::StopWatch sw;
+    double searching_time;
+
+    StringRef texts[kSearchTexts];
+    for (size_t i = 0; i < kSearchTexts; ++i) {
+        texts[i].set_data(SearchTexts[i], ::strlen(SearchTexts[i]));
+    }
+
+    // Preprocessing: compile once, and then share them.
+    pattern_type pattern[kPatterns];
+    for (size_t i = 0; i < kPatterns; ++i) {
+        pattern[i].preprocessing(Patterns[i]);
+    }
+
+    Long expected[kSearchTexts][kPatterns];
+    for (size_t i = 0; i < kSearchTexts; ++i) {
+        for (size_t j = 0; j < kPatterns; ++j) {
+            expected[i][j] = pattern[j].match(texts[i].c_str(), texts[i].size());
+        }
+    }
+
+    std::atomic<size_t> checksum(0);
+    std::atomic<size_t> mismatches(0);
+
+    std::vector<std::thread> workers;
+    workers.reserve(thread_num);
+
+    sw.start();
+    for (size_t t = 0; t < thread_num; ++t) {
+        workers.emplace_back([&]() {
+            size_t sum = 0, errors = 0;
+            for (size_t loop = 0; loop < iters; ++loop) {
+                for (size_t i = 0; i < kSearchTexts; ++i) {
+                    for (size_t j = 0; j < kPatterns; ++j) {
+                        Long index_of = pattern[j].match(texts[i].c_str(), texts[i].size());
+                        if (unlikely(index_of != expected[i][j]))
+                            errors++;
+                        sum += (size_t)index_of;
+                    }
+                }
+            }
+            checksum += sum;
+            mismatches += errors;
+        });
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    sw.stop();
+    searching_time = sw.getMillisec();
+
+    double searches = (double)thread_num * iters * kSearchTexts * kPatterns;
+    printf("  %-22s   %-12u %7u    %10u    %8.3f ms    %8.3f M/s\n",
+           AlgorithmTy::name(), (unsigned int)checksum.load(),
+           (unsigned int)thread_num, (unsigned int)mismatches.load(),
+           searching_time, searches / (searching_time * 1000.0));
+}
+
+//
+// Search a large buffer with one thread and with ParallelSearcher.
+//
+template <typename AlgorithmTy>
+void StringMatch_parallel_benchmark(const char * text, size_t text_len,
+                                    const char * pattern_str, size_t thread_num)
+{
+    typedef typename AlgorithmTy::Pattern pattern_type;
+
+    test::StopWatch sw;
+    double single_time, parallel_time, count_time;
+
+    pattern_type pattern(pattern_str);
+    ParallelSearcher<AlgorithmTy> searcher(thread_num);
+
+    sw.start();
+    Long single_index = pattern.match(text, text_len);
+    sw.stop();
+    single_time = sw.getMillisec();
+
+    sw.start();
+    Long parallel_index = searcher.search(pattern, text, text_len);
+    sw.stop();
+    parallel_time = sw.getMillisec();
+
+    sw.start();
+    size_t matches = searcher.count(pattern, text, text_len);
+    sw.stop();
+    count_time = sw.getMillisec();
+
+    double mbytes = (double)text_len / (1024.0 * 1024.0);
+    printf("  %-22s   %-12d %-10d %8u    %8.1f MB/s   %8.1f MB/s   %8.1f MB/s\n",
+           AlgorithmTy::name(), (int)single_index, (int)parallel_index, (unsigned int)matches,
+           mbytes * 1000.0 / single_time, mbytes * 1000.0 / parallel_time,
+           mbytes * 1000.0 / count_time);
+}
+
+void StringMatch_parallel_benchmarks(size_t thread_num)
+{
+    static const size_t kTextLength = 64 * 1024 * 1024;
+    static const char kNeedle[] = "parallel searcher";
+
+    // Random lower letters, only one needle at the last 1/8 of the text.
+    std::string text(kTextLength, ' ');
+    unsigned int seed = 20201017;
+    for (size_t i = 0; i < kTextLength; ++i) {
+        seed = seed * 214013U + 2531011U;
+        text[i] = (char)('a' + ((seed >> 16) % 26));
+    }
+    size_t needle_pos = kTextLength - kTextLength / 8;
+    text.replace(needle_pos, sizeof(kNeedle) - 1, kNeedle);
+
+    printf("  Parallel (%u MB, %u)     Index        Parallel  Matches      Single        Parallel       Count\n",
+           (unsigned int)(kTextLength / (1024 * 1024)), (unsigned int)thread_num);
+    printf("-------------------------------------------------------------------------------------------------\n");
+
+    StringMatch_parallel_benchmark<AnsiString::AutoStrStr>(text.c_str(), text.size(), kNeedle, thread_num);
+    StringMatch_parallel_benchmark<AnsiString::BMTuned>(text.c_str(), text.size(), kNeedle, thread_num);
+    StringMatch_parallel_benchmark<AnsiString::Horspool>(text.c_str(), text.size(), kNeedle, thread_num);
+    StringMatch_parallel_benchmark<AnsiString::QuickSearch>(text.c_str(), text.size(), kNeedle, thread_num);
+    StringMatch_parallel_benchmark<AnsiString::ShiftOr>(text.c_str(), text.size(), kNeedle, thread_num);
+
+    printf("-------------------------------------------------------------------------------------------------\n");
+    printf("\n");
+}
+
+//
+// Search a file with the mapping and with the read() path.
+//
+template <typename AlgorithmTy>
+void StringMatch_file_benchmark(const char * path, const char * pattern_str)
+{
+    typedef typename AlgorithmTy::Pattern pattern_type;
+
+    test::StopWatch sw;
+    double mmap_time, read_time;
+
+    pattern_type pattern(pattern_str);
+    uint64_t checksum = 0;
+
+    FileSearchOptions options;
+    sw.start();
+    int64_t mmap_matches = search_file_all(path, pattern, [&checksum](uint64_t offset) {
+        checksum += offset;
+    }, MatchMode::Overlapping, options);
+    sw.stop();
+    mmap_time = sw.getMillisec();
+
+    options.use_mmap = false;
+    sw.start();
+    int64_t read_matches = search_file_all(path, pattern, [&checksum](uint64_t offset) {
+        checksum -= offset;
+    }, MatchMode::Overlapping, options);
+    sw.stop();
+    read_time = sw.getMillisec();
+
+    printf("  %-22s   %-10d %-10d %-8s    %8.3f ms    %8.3f ms\n",
+           AlgorithmTy::name(), (int)mmap_matches, (int)read_matches,
+           (checksum == 0) ? "OK" : "Failed", mmap_time, read_time);
+}
+
+void StringMatch_file_benchmarks(const char * path, const char * pattern)
+{
+    printf("  File: %s, pattern: \"%s\"\n\n", path, pattern);
+    printf("  Algorithm Name           mmap       read()     Verify      mmap Time      read() Time\n");
+    printf("-------------------------------------------------------------------------------------------------\n");
+
+    StringMatch_file_benchmark<AnsiString::AutoStrStr>(path, pattern);
+    StringMatch_file_benchmark<AnsiString::Kmp>(path, pattern);
+    StringMatch_file_benchmark<AnsiString::BMTuned>(path, pattern);
+    StringMatch_file_benchmark<AnsiString::Horspool>(path, pattern);
+    StringMatch_file_benchmark<AnsiString::QuickSearch>(path, pattern);
+    StringMatch_file_benchmark<AnsiString::ShiftOr>(path, pattern);
+
+    printf("-------------------------------------------------------------------------------------------------\n");
+    printf("\n");
+}
+
+//
+// The corpus benchmark: sweep the corpora, the text sizes, the pattern lengths and
+// the pattern frequencies, cold and warm, and print the throughput of every algorithm.
+//
+struct CorpusBenchmarkOptions {
+    std::vector<test::CorpusType::Type> types;
+    std::vector<std::string> files;
+    std::vector<size_t> sizes;
+    std::vector<size_t> lengths;
+    bool cold;
+    bool warm;
+    test::BenchmarkRunner::Options runner;
+    bool perf;                  // Report the hardware performance counters.
+    std::string csv_path;
+    std::string json_path;
+
+    CorpusBenchmarkOptions() : cold(true), warm(true), perf(false) {
+        for (int type = test::CorpusType::English; type < test::CorpusType::File; ++type) {
+            this->types.push_back((test::CorpusType::Type)type);
+        }
+        static const size_t kSizes[] = { 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+        this->sizes.assign(kSizes, kSizes + sm_countof(kSizes));
+        static const size_t kLengths[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024 };
+        this->lengths.assign(kLengths, kLengths + sm_countof(kLengths));
+    }
+};
+
+//
+// Return the statistics of the search time of the whole text (counts all of
+// the matches), the time of the preprocessing is not included. The cold runs
+// evict the caches before each run. The search statistics are of the first
+// (untimed) run, they are all zeros if STRING_MATCH_ENABLE_STATS is 0.
+//
+template <typename AlgorithmTy>
+test::BenchmarkStats StringMatch_corpus_measure(const test::Corpus & corpus,
+                                                const std::string & pattern_text, bool cold,
+                                                const test::BenchmarkRunner & runner,
+                                                test::CacheFlusher & flusher, size_t & matches,
+                                                SearchStats & search_stats)
+{
+    typedef typename AlgorithmTy::Pattern pattern_type;
+
+    pattern_type pattern(pattern_text);
+    const char * text = corpus.data();
+    size_t text_len = corpus.size();
+
+    AlgorithmTy::reset_stats();
+    matches = pattern.count(text, text_len);
+    search_stats = AlgorithmTy::stats();
+    auto search = [&]() {
+        size_t count = pattern.count(text, text_len);
+        test::do_not_optimize(count);
+    };
+    if (cold)
+        return runner.run_cold([&flusher]() { flusher.flush(); }, search);
+    else
+        return runner.run(search);
+}
+
+struct CorpusAlgorithm {
+    const char * (*name)();
+    size_t max_pattern_len;     // 0 is unlimited.
+    test::BenchmarkStats (*measure)(const test::Corpus &, const std::string &, bool,
+                                    const test::BenchmarkRunner &, test::CacheFlusher &, size_t &,
+                                    SearchStats &);
+};
+
+#define CORPUS_ALGORITHM(Name, MaxLen) \
+    { &AnsiString::Name::name, MaxLen, &StringMatch_corpus_measure<AnsiString::Name> }
+
+// The random bytes contain '\0', so only the algorithms which honour text_len.
+// The first one is the reference of the matches.
+static const CorpusAlgorithm CorpusAlgorithms[] = {
+    CORPUS_ALGORITHM(MemMem,                0),
+    CORPUS_ALGORITHM(AutoStrStr,            0),
+    CORPUS_ALGORITHM(Smart,                 0),
+    CORPUS_ALGORITHM(AutoTune,              0),
+    CORPUS_ALGORITHM(StdSearch,             0),
+    CORPUS_ALGORITHM(Kmp,                   0),
+    CORPUS_ALGORITHM(BoyerMoore,            0),
+    CORPUS_ALGORITHM(BMTuned,               0),
+    CORPUS_ALGORITHM(Sunday,                0),
+    CORPUS_ALGORITHM(Horspool,              0),
+    CORPUS_ALGORITHM(QuickSearch,           0),
+    CORPUS_ALGORITHM(TwoWay,                0),
+    CORPUS_ALGORITHM(ShiftAnd,              sizeof(size_t) * 8),
+    CORPUS_ALGORITHM(ShiftOr,               sizeof(size_t) * 8),
+    CORPUS_ALGORITHM(ShiftOrWide,           512),
+    CORPUS_ALGORITHM(WordHash,              0),
+    CORPUS_ALGORITHM(Volnitsky,             0),
+    CORPUS_ALGORITHM(CompactAhoCorasick,    0),
+};
+
+#undef CORPUS_ALGORITHM
+
+static const size_t kCorpusAlgorithms = sm_countof(CorpusAlgorithms);
+
+//
+// The hardware counters of the table below the throughputs: IPC, and the branch,
+// L1D and LLC misses per KB of the text, one row for each algorithm.
+//
+void StringMatch_corpus_counters(const test::Corpus & corpus, const std::vector<size_t> & lengths,
+                                 const std::vector<double> & speeds,
+                                 const std::vector<test::PerfCounterValues> & counters)
+{
+    static const test::PerfEvent::Type kMetrics[] = {
+        test::PerfEvent::Instructions,      // IPC
+        test::PerfEvent::BranchMisses,
+        test::PerfEvent::L1DMisses,
+        test::PerfEvent::LLCMisses
+    };
+    size_t columns = lengths.size();
+    double kilobytes = (double)corpus.size() / 1024.0;
+
+    for (size_t m = 0; m < sm_countof(kMetrics); ++m) {
+        test::PerfEvent::Type metric = kMetrics[m];
+        bool is_ipc = (metric == test::PerfEvent::Instructions);
+        bool available = false;
+        for (size_t i = 0; i < counters.size(); ++i) {
+            if (is_ipc ? (counters[i].ipc() > 0.0) : counters[i].has(metric))
+                available = true;
+        }
+        if (!available)
+            continue;
+
+        if (is_ipc)
+            printf("  %-22s", "IPC");
+        else
+            printf("  %-22s", (std::string(test::PerfEvent::name(metric)) + " / KB").c_str());
+        for (size_t col = 0; col < columns; ++col)
+            printf(" %9" PRIuPTR, lengths[col]);
+        printf("\n");
+        printf("-------------------------------------------------------------------------------------------------\n");
+
+        for (size_t alg = 0; alg < kCorpusAlgorithms; ++alg) {
+            printf("  %-22s", CorpusAlgorithms[alg].name());
+            for (size_t col = 0; col < columns; ++col) {
+                const test::PerfCounterValues & values = counters[alg * columns + col];
+                if (speeds[alg * columns + col] < 0.0 ||
+                    (is_ipc ? (values.ipc() <= 0.0) : !values.has(metric)))
+                    printf(" %9s", "-");
+                else if (is_ipc)
+                    printf(" %9.2f", values.ipc());
+                else
+                    printf(" %9.2f", values.get(metric) / kilobytes);
+            }
+            printf("\n");
+        }
+        printf("-------------------------------------------------------------------------------------------------\n\n");
+    }
+}
+
+#if STRING_MATCH_ENABLE_STATS
+
+//
+// The search statistics of the table: the comparisons per byte of the text,
+// the average shift, and the false positive verifications in percent, one row
+// for each algorithm ('-' if the algorithm doesn't count it).
+//
+void StringMatch_corpus_search_stats(const std::vector<size_t> & lengths,
+                                     const std::vector<double> & speeds,
+                                     const std::vector<SearchStats> & search_stats,
+                                     size_t text_len)
+{
+    static const char * const kMetrics[] = {
+        "Comparisons / byte",
+        "Average shift",
+        "False positives (%)"
+    };
+    size_t columns = lengths.size();
+
+    for (size_t m = 0; m < sm_countof(kMetrics); ++m) {
+        printf("  %-22s", kMetrics[m]);
+        for (size_t col = 0; col < columns; ++col)
+            printf(" %9" PRIuPTR, lengths[col]);
+        printf("\n");
+        printf("-------------------------------------------------------------------------------------------------\n");
+
+        for (size_t alg = 0; alg < kCorpusAlgorithms; ++alg) {
+            printf("  %-22s", CorpusAlgorithms[alg].name());
+            for (size_t col = 0; col < columns; ++col) {
+                const SearchStats & stats = search_stats[alg * columns + col];
+                if (speeds[alg * columns + col] < 0.0 || stats.searches == 0) {
+                    printf(" %9s", "-");
+                }
+                else if (m == 0) {
+                    printf(" %9.3f", (double)stats.comparisons / (double)text_len);
+                }
+                else if (m == 1) {
+                    if (stats.shifts != 0)
+                        printf(" %9.2f", stats.average_shift());
+                    else
+                        printf(" %9s", "-");
+                }
+                else {
+                    if (stats.verifications != 0)
+                        printf(" %9.2f", stats.false_positive_rate() * 100.0);
+                    else
+                        printf(" %9s", "-");
+                }
+            }
+            printf("\n");
+        }
+        printf("-------------------------------------------------------------------------------------------------\n\n");
+    }
+}
+
+#endif // STRING_MATCH_ENABLE_STATS
+
+//
+// One table of a corpus, a frequency and a cache state: a row for each algorithm,
+// a column for each pattern length, the cells are MB/s of the median run, '*' is
+// the fastest one of the column, "err" is a wrong numbers of matches, '-' is not
+// available. Every measurement is appended to records.
+//
+void StringMatch_corpus_table(const test::Corpus & corpus, test::PatternFrequency::Type frequency,
+                              bool cold, const std::vector<size_t> & lengths,
+                              const test::BenchmarkRunner & runner, test::CacheFlusher & flusher,
+                              std::vector<test::BenchmarkRecord> & records)
+{
+    size_t columns = lengths.size();
+    std::vector<double> speeds(kCorpusAlgorithms * columns, -1.0);
+    std::vector<char> errors(kCorpusAlgorithms * columns, 0);
+    std::vector<test::PerfCounterValues> counters(kCorpusAlgorithms * columns);
+    std::vector<SearchStats> search_stats(kCorpusAlgorithms * columns);
+    std::vector<Long> found(columns, -1);     // -1: no such pattern.
+
+    for (size_t col = 0; col < columns; ++col) {
+        std::string pattern;
+        if (!corpus.make_pattern(lengths[col], frequency, pattern))
+            continue;
+        size_t reference = 0;
+        for (size_t alg = 0; alg < kCorpusAlgorithms; ++alg) {
+            const CorpusAlgorithm & algorithm = CorpusAlgorithms[alg];
+            if (algorithm.max_pattern_len != 0 && pattern.size() > algorithm.max_pattern_len)
+                continue;
+            size_t matches = 0;
+            test::BenchmarkStats stats = algorithm.measure(corpus, pattern, cold, runner,
+                                                           flusher, matches,
+                                                           search_stats[alg * columns + col]);
+            if (alg == 0)
+                reference = matches;
+            errors[alg * columns + col] = (matches != reference);
+            speeds[alg * columns + col] = (stats.median > 0.0) ?
+                ((double)corpus.size() / (1024.0 * 1024.0) / stats.median) : 0.0;
+            counters[alg * columns + col] = stats.counters;
+
+            test::BenchmarkRecord record;
+            record.algorithm = algorithm.name();
+            record.corpus = corpus.name();
+            record.text_size = corpus.size();
+            record.pattern_len = pattern.size();
+            record.frequency = test::PatternFrequency::name(frequency);
+            record.cold = cold;
+            record.matches = matches;
+            record.stats = stats;
+            records.push_back(record);
+        }
+        found[col] = (Long)reference;
+    }
+
+    printf("  Corpus: %s, size: %" PRIuPTR " bytes, pattern: %s, %s\n\n",
+           corpus.name().c_str(), corpus.size(), test::PatternFrequency::name(frequency),
+           cold ? "cold" : "warm");
+
+    printf("  %-22s", "Pattern length");
+    for (size_t col = 0; col < columns; ++col)
+        printf(" %9" PRIuPTR, lengths[col]);
+    printf("\n");
+    printf("  %-22s", "Matches");
+    for (size_t col = 0; col < columns; ++col) {
+        if (found[col] >= 0)
+            printf(" %9" PRIiPTR, found[col]);
+        else
+            printf(" %9s", "-");
+    }
+    printf("\n");
+    printf("-------------------------------------------------------------------------------------------------\n");
+
+    for (size_t alg = 0; alg < kCorpusAlgorithms; ++alg) {
+        printf("  %-22s", CorpusAlgorithms[alg].name());
+        for (size_t col = 0; col < columns; ++col) {
+            double speed = speeds[alg * columns + col];
+            if (speed < 0.0) {
+                printf(" %9s", "-");
+            }
+            else if (errors[alg * columns + col]) {
+                printf(" %9s", "err");
+            }
+            else {
+                bool fastest = true;
+                for (size_t other = 0; other < kCorpusAlgorithms; ++other) {
+                    if (speeds[other * columns + col] > speed && !errors[other * columns + col])
+                        fastest = false;
+                }
+                printf(" %8.0f%c", speed, fastest ? '*' : ' ');
+            }
+        }
+        printf("\n");
+    }
+    printf("-------------------------------------------------------------------------------------------------\n");
+    printf("  (MB/s of the median of %u samples, the preprocessing time is not included, "
+           "'*' is the fastest one)\n\n", (unsigned int)runner.options().samples);
+
+    if (runner.perf_counters() != nullptr) {
+        StringMatch_corpus_counters(corpus, lengths, speeds, counters);
+    }
+#if STRING_MATCH_ENABLE_STATS
+    StringMatch_corpus_search_stats(lengths, speeds, search_stats, corpus.size());
+#endif
+    fflush(stdout);
+}
+
+bool StringMatch_corpus_benchmarks(const CorpusBenchmarkOptions & options)
+{
+    std::unique_ptr<test::PerfCounters> perf_counters;
+    if (options.perf) {
+        perf_counters.reset(new test::PerfCounters());
+        if (!perf_counters->is_available()) {
+            printf("  The hardware performance counters are not available "
+                   "(no PMU, or see /proc/sys/kernel/perf_event_paranoid).\n\n");
+            perf_counters.reset();
+        }
+    }
+    test::BenchmarkRunner runner(options.runner, perf_counters.get());
+    test::CacheFlusher flusher;
+    std::vector<test::BenchmarkRecord> records;
+    size_t corpus_count = options.types.size() + options.files.size();
+    for (size_t i = 0; i < corpus_count; ++i) {
+        for (size_t s = 0; s < options.sizes.size(); ++s) {
+            test::Corpus corpus;
+            bool success;
+            if (i < options.types.size()) {
+                success = corpus.generate(options.types[i], options.sizes[s]);
+            }
+            else {
+                const std::string & path = options.files[i - options.types.size()];
+                success = corpus.load(path.c_str(), options.sizes[s]);
+                if (!success)
+                    printf("  Can not load the corpus: %s\n\n", path.c_str());
+            }
+            if (!success)
+                break;
+
+            for (int frequency = test::PatternFrequency::Absent;
+                 frequency < test::PatternFrequency::Last; ++frequency) {
+                if (options.cold) {
+                    StringMatch_corpus_table(corpus, (test::PatternFrequency::Type)frequency,
+                                             true, options.lengths, runner, flusher, records);
+                }
+                if (options.warm) {
+                    StringMatch_corpus_table(corpus, (test::PatternFrequency::Type)frequency,
+                                             false, options.lengths, runner, flusher, records);
+                }
+            }
+        }
+    }
+
+    bool success = true;
+    if (!options.csv_path.empty()) {
+        if (!test::BenchmarkWriter::write(options.csv_path.c_str(),
+                                          test::BenchmarkWriter::Format::CSV, records)) {
+            printf("  Can not write the CSV file: %s\n", options.csv_path.c_str());
+            success = false;
+        }
+    }
+    if (!options.json_path.empty()) {
+        if (!test::BenchmarkWriter::write(options.json_path.c_str(),
+                                          test::BenchmarkWriter::Format::JSON, records)) {
+            printf("  Can not write the JSON file: %s\n", options.json_path.c_str());
+            success = false;
+        }
+    }
+    return success;
+}
+
+//
+// The calibration of SmartPattern: measure the engines of the length crossovers
+// (Simd, Horspool and BMTuned) on the English, log and binary corpora, and Simd
+// and TwoWay of the periodic patterns on a periodic text, choose simd_max_len,
+// long_min_len and two_way_min_len, and write the thresholds to the file. The
+// other thresholds are kept as the defaults.
+//
+bool StringMatch_calibrate(const char * path, size_t text_size)
+{
+    static const test::CorpusType::Type kTypes[] = {
+        test::CorpusType::English,
+        test::CorpusType::Log,
+        test::CorpusType::Binary
+    };
+    static const size_t kLengths[] = { 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024 };
+    enum { kSimd, kHorspool, kBMTuned, kEngines };
+    static const char * const kEngineNames[] = { "simd", "horspool", "bm-tuned" };
+
+    test::BenchmarkRunner::Options runner_options;
+    runner_options.samples = 5;
+    test::BenchmarkRunner runner(runner_options);
+    test::CacheFlusher flusher;
+
+    // The sum of the median times of the corpora.
+    double times[sm_countof(kLengths)][kEngines];
+    ::memset(times, 0, sizeof(times));
+
+    for (size_t t = 0; t < sm_countof(kTypes); ++t) {
+        test::Corpus corpus;
+        if (!corpus.generate(kTypes[t], text_size))
+            return false;
+        for (size_t l = 0; l < sm_countof(kLengths); ++l) {
+            std::string pattern;
+            if (!corpus.make_pattern(kLengths[l], test::PatternFrequency::Rare, pattern))
+                return false;
+            size_t matches;
+            SearchStats search_stats;
+            times[l][kSimd] += StringMatch_corpus_measure<AnsiString::AutoStrStr>(
+                corpus, pattern, false, runner, flusher, matches, search_stats).median;
+            times[l][kHorspool] += StringMatch_corpus_measure<AnsiString::Horspool>(
+                corpus, pattern, false, runner, flusher, matches, search_stats).median;
+            times[l][kBMTuned] += StringMatch_corpus_measure<AnsiString::BMTuned>(
+                corpus, pattern, false, runner, flusher, matches, search_stats).median;
+        }
+    }
+
+    printf("  %-22s", "Pattern length");
+    for (size_t l = 0; l < sm_countof(kLengths); ++l)
+        printf(" %7" PRIuPTR, kLengths[l]);
+    printf("\n");
+    printf("-------------------------------------------------------------------------------------------------\n");
+    double total_size = (double)text_size * sm_countof(kTypes);
+    for (int e = 0; e < kEngines; ++e) {
+        printf("  %-22s", kEngineNames[e]);
+        for (size_t l = 0; l < sm_countof(kLengths); ++l) {
+            double speed = (times[l][e] > 0.0) ? (total_size / (1024.0 * 1024.0) / times[l][e]) : 0.0;
+            printf(" %7.0f", speed);
+        }
+        printf("\n");
+    }
+    printf("-------------------------------------------------------------------------------------------------\n");
+    printf("  (MB/s of the rare patterns)\n\n");
+
+    SmartThresholds thresholds;
+
+    // The longest length which Simd wins, from the shortest one, unlimited if it
+    // wins all of the lengths.
+    thresholds.simd_max_len = (size_t)-1;
+    for (size_t l = 0; l < sm_countof(kLengths); ++l) {
+        if (times[l][kSimd] > sm_min(times[l][kHorspool], times[l][kBMTuned])) {
+            thresholds.simd_max_len = (l > 0) ? kLengths[l - 1] : 1;
+            break;
+        }
+    }
+
+    // The shortest length which BMTuned wins, from the longest one.
+    thresholds.long_min_len = kLengths[sm_countof(kLengths) - 1] * 2;
+    for (size_t l = sm_countof(kLengths); l > 0; --l) {
+        if (times[l - 1][kBMTuned] > times[l - 1][kHorspool])
+            break;
+        thresholds.long_min_len = kLengths[l - 1];
+    }
+
+    // The periodic patterns ("abab...ab") on a text of the near misses ("abab...aa").
+    printf("  %-22s", "Periodic length");
+    for (size_t l = 1; l < sm_countof(kLengths); ++l)
+        printf(" %7" PRIuPTR, kLengths[l]);
+    printf("\n");
+    printf("-------------------------------------------------------------------------------------------------\n");
+    double periodic_times[sm_countof(kLengths)][2];
+    for (size_t l = 1; l < sm_countof(kLengths); ++l) {
+        std::string pattern, unit;
+        for (size_t i = 0; i < kLengths[l] / 2; ++i)
+            pattern += "ab";
+        unit.assign(pattern, 0, pattern.size() - 1);
+        unit += 'a';
+        test::Corpus corpus;
+        std::string text;
+        text.reserve(text_size + unit.size());
+        while (text.size() < text_size)
+            text += unit;
+        corpus.set_text("periodic", text);
+        size_t matches;
+        SearchStats search_stats;
+        periodic_times[l][0] = StringMatch_corpus_measure<AnsiString::AutoStrStr>(
+            corpus, pattern, false, runner, flusher, matches, search_stats).median;
+        periodic_times[l][1] = StringMatch_corpus_measure<AnsiString::TwoWay>(
+            corpus, pattern, false, runner, flusher, matches, search_stats).median;
+    }
+    static const char * const kPeriodicNames[] = { "simd", "two-way" };
+    for (int e = 0; e < 2; ++e) {
+        printf("  %-22s", kPeriodicNames[e]);
+        for (size_t l = 1; l < sm_countof(kLengths); ++l) {
+            double speed = (periodic_times[l][e] > 0.0) ?
+                ((double)text_size / (1024.0 * 1024.0) / periodic_times[l][e]) : 0.0;
+            printf(" %7.0f", speed);
+        }
+        printf("\n");
+    }
+    printf("-------------------------------------------------------------------------------------------------\n");
+    printf("  (MB/s of the periodic patterns)\n\n");
+
+    // The shortest periodic length which TwoWay wins by kWorstCaseRatio times,
+    // from the longest one. The periodic text is the worst case of Simd, it's
+    // much faster than TwoWay on the other texts.
+    static const double kWorstCaseRatio = 4.0;
+    thresholds.two_way_min_len = (size_t)-1;
+    for (size_t l = sm_countof(kLengths) - 1; l > 0; --l) {
+        if (periodic_times[l][1] * kWorstCaseRatio > periodic_times[l][0])
+            break;
+        thresholds.two_way_min_len = kLengths[l];
+    }
+
+    printf("  simd_max_len = %s, long_min_len = %" PRIuPTR ", two_way_min_len = %s\n",
+           (thresholds.simd_max_len != (size_t)-1) ? std::to_string(thresholds.simd_max_len).c_str() : "unlimited",
+           thresholds.long_min_len,
+           (thresholds.two_way_min_len != (size_t)-1) ? std::to_string(thresholds.two_way_min_len).c_str() : "unlimited");
+    if (!thresholds.save(path)) {
+        printf("  Can not write the calibration file: %s\n\n", path);
+        return false;
+    }
+    printf("  The calibration file: %s (set STRING_MATCH_CALIBRATION to load it)\n\n", path);
+    return true;
+}
+
+// "64K", "16M", "4G" or a plain number.
+size_t parse_size(const char * str)
+{
+    char * end = nullptr;
+    double value = ::strtod(str, &end);
+    if (end != nullptr) {
+        switch (*end) {
+            case 'k': case 'K': value *= 1024.0; break;
+            case 'm': case 'M': value *= 1024.0 * 1024.0; break;
+            case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+            default: break;
+        }
+    }
+    return (size_t)value;
+}
+
+std::vector<std::string> split_list(const char * str)
+{
+    std::vector<std::string> items;
+    std::string item;
+    for (const char * p = str; ; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty())
+                items.push_back(item);
+            item.clear();
+            if (*p == '\0')
+                break;
+        }
+        else {
+            item += *p;
+        }
+    }
+    return items;
+}
+
+//
+// StringMatch --corpus [--types english,dna,protein,binary,log] [--file path]
+//                      [--sizes 1K,64K,1M,16M] [--lengths 1,2,4,...,1024] [--cold | --warm]
+//                      [--samples N] [--perf] [--csv path] [--json path]
+//
+bool parse_corpus_options(int argc, char * argv[], CorpusBenchmarkOptions & options)
+{
+    bool has_types = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (arg == "--types" && has_value) {
+            options.types.clear();
+            has_types = true;
+            std::vector<std::string> names = split_list(argv[++i]);
+            for (size_t n = 0; n < names.size(); ++n) {
+                test::CorpusType::Type type = test::CorpusType::parse(names[n].c_str());
+                if (type >= test::CorpusType::File) {
+                    printf("Unknown corpus type: %s\n", names[n].c_str());
+                    return false;
+                }
+                options.types.push_back(type);
+            }
+        }
+        else if (arg == "--file" && has_value) {
+            options.files.push_back(argv[++i]);
+            // Only the file if the types are not given.
+            if (!has_types)
+                options.types.clear();
+        }
+        else if (arg == "--sizes" && has_value) {
+            std::vector<std::string> sizes = split_list(argv[++i]);
+            options.sizes.clear();
+            for (size_t n = 0; n < sizes.size(); ++n) {
+                size_t size = parse_size(sizes[n].c_str());
+                if (size != 0)
+                    options.sizes.push_back(size);
+            }
+        }
+        else if (arg == "--lengths" && has_value) {
+            std::vector<std::string> lengths = split_list(argv[++i]);
+            options.lengths.clear();
+            for (size_t n = 0; n < lengths.size(); ++n) {
+                size_t length = (size_t)::strtoul(lengths[n].c_str(), nullptr, 10);
+                if (length != 0)
+                    options.lengths.push_back(length);
+            }
+        }
+        else if (arg == "--samples" && has_value) {
+            options.runner.samples = (size_t)::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--perf") {
+            options.perf = true;
+        }
+        else if (arg == "--csv" && has_value) {
+            options.csv_path = argv[++i];
+        }
+        else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        }
+        else if (arg == "--cold") {
+            options.cold = true;
+            options.warm = false;
+        }
+        else if (arg == "--warm") {
+            options.cold = false;
+            options.warm = true;
+        }
+        else {
+            printf("Unknown corpus option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
 void print_arch_type()
 {
 #if defined(WIN64) || defined(_WIN64) || defined(_M_X64) || defined(_M_AMD64) \
@@ -523,9 +1941,37 @@ void print_arch_type()
 #endif
 }
 
+void print_cpu_dispatch()
+{
+    printf("Instruction set: %d, AutoStrStr kernel: %s\n\n",
+           CpuInstrSet::level(), AutoStrStrDispatcher<char>::name());
+}
+
 int main(int argc, char * argv[])
 {
     print_arch_type();
+    print_cpu_dispatch();
+
+    // StringMatch --corpus [options]: the corpus benchmark only.
+    if (argc >= 2 && ::strcmp(argv[1], "--corpus") == 0) {
+        CorpusBenchmarkOptions options;
+        if (!parse_corpus_options(argc, argv, options))
+            return 1;
+        return (StringMatch_corpus_benchmarks(options) ? 0 : 1);
+    }
+
+    // StringMatch --calibrate [path] [size]: calibrate the thresholds of SmartPattern.
+    if (argc >= 2 && ::strcmp(argv[1], "--calibrate") == 0) {
+        const char * path = (argc >= 3) ? argv[2] : "smart_calibration.txt";
+        size_t size = (argc >= 4) ? parse_size(argv[3]) : (size_t)(1024 * 1024);
+        return (StringMatch_calibrate(path, (size != 0) ? size : (size_t)(1024 * 1024)) ? 0 : 1);
+    }
+
+    // StringMatch <file> <pattern>: benchmark the file search only.
+    if (argc >= 3) {
+        StringMatch_file_benchmarks(argv[1], argv[2]);
+        return 0;
+    }
 
     StringMatch_usage_examples();
 
@@ -545,7 +1991,42 @@ int main(int argc, char * argv[])
 
     StringMatch_verify<AnsiString::WordHash, AnsiString::StrStr>();
     StringMatch_verify<AnsiString::Volnitsky, AnsiString::StrStr>();
+    // Volnitsky used to return the first match in its hash chain, not the leftmost one.
+    StringMatch_verify_periodic<AnsiString::Volnitsky, AnsiString::StrStr>();
     StringMatch_verify<AnsiString::FastStrStr, AnsiString::StrStr>();
+    StringMatch_verify<AnsiString::AutoStrStr, AnsiString::StrStr>();
+    StringMatch_verify<AnsiString::Smart, AnsiString::StrStr>();
+    StringMatch_verify<AnsiString::AutoTune, AnsiString::StrStr>();
+    StringMatch_verify<AnsiString::TwoWay, AnsiString::StrStr>();
+    StringMatch_verify_nocase<AnsiString::NoCaseStrStr, AnsiString::StrStr>();
+    if (CpuInstrSet::has_sse42())
+        StringMatch_verify<AnsiString::SSEMemMem, AnsiString::StrStr>();
+    if (CpuInstrSet::has_avx2())
+        StringMatch_verify<AnsiString::AvxStrStr, AnsiString::StrStr>();
+#if STRING_MATCH_HAVE_AVX512BW
+    if (CpuInstrSet::has_avx512bw())
+        StringMatch_verify<AnsiString::Avx512StrStr, AnsiString::StrStr>();
+#endif
+
+    // ShiftAnd used to miss the patterns of exactly the bits of the mask word.
+    for (size_t pattern_len = sizeof(size_t) * 8 - 1; pattern_len <= sizeof(size_t) * 8; ++pattern_len) {
+        StringMatch_verify_pattern_len<AnsiString::ShiftAnd, AnsiString::StrStr>(pattern_len);
+        StringMatch_verify_pattern_len<AnsiString::ShiftOr, AnsiString::StrStr>(pattern_len);
+        StringMatch_verify_pattern_len<AnsiString::ShiftOrWide, AnsiString::StrStr>(pattern_len);
+    }
+    for (size_t pattern_len = 511; pattern_len <= 512; ++pattern_len) {
+        StringMatch_verify_pattern_len<AnsiString::ShiftOrWide, AnsiString::StrStr>(pattern_len);
+    }
+
+    // The patterns longer than the state were truncated and matched at a wrong position.
+    StringMatch_verify_too_long<AnsiString::ShiftAnd>(sizeof(size_t) * 8 + 6, 200);
+    StringMatch_verify_too_long<AnsiString::ShiftOr>(sizeof(size_t) * 8 + 6, 200);
+    StringMatch_verify_too_long<AnsiString::ShiftOrWide>(600, 2000);
+
+    StringMatch_verify_auto_tune(16);
+
+    StringMatch_verify_small_pattern_sets();
+    StringMatch_verify_large_pattern_sets();
 
     if (1) {
 #if SWITCH_BENCHMARK_TEST
@@ -556,13 +2037,29 @@ int main(int argc, char * argv[])
         printf("-------------------------------------------------------------------------------------------------\n");
 
         StringMatch_benchmark<AnsiString::StrStr>();
-        StringMatch_benchmark<AnsiString::SSEStrStr>();
-        StringMatch_benchmark<AnsiString::SSEStrStr2>();
-        StringMatch_benchmark<AnsiString::SSEStrStrA>();
-        StringMatch_benchmark<AnsiString::SSEStrStrA_v0>();
-        StringMatch_benchmark<AnsiString::SSEStrStrA_v2>();
+        // Skip the kernels this CPU can not run (STRING_MATCH_DISPATCH_BUILD).
+        if (CpuInstrSet::has_sse42()) {
+            StringMatch_benchmark<AnsiString::SSEStrStr>();
+            StringMatch_benchmark<AnsiString::SSEMemMem>();
+            StringMatch_benchmark<AnsiString::SSEStrStr2>();
+            StringMatch_benchmark<AnsiString::SSEStrStrA>();
+            StringMatch_benchmark<AnsiString::SSEStrStrA_v0>();
+            StringMatch_benchmark<AnsiString::SSEStrStrA_v2>();
+        }
+        if (CpuInstrSet::has_avx2())
+            StringMatch_benchmark<AnsiString::AvxStrStr>();
+#if STRING_MATCH_HAVE_AVX512BW
+        if (CpuInstrSet::has_avx512bw())
+            StringMatch_benchmark<AnsiString::Avx512StrStr>();
+#endif
+        // Case-insensitive, the checksum differs if a text has the other case of a pattern.
+        StringMatch_benchmark<AnsiString::NoCaseStrStr>();
+        StringMatch_benchmark<AnsiString::AutoStrStr>();
+        StringMatch_benchmark<AnsiString::Smart>();
+        StringMatch_benchmark<AnsiString::AutoTune>();
         StringMatch_benchmark<AnsiString::GlibcStrStr>();
         StringMatch_benchmark<AnsiString::GlibcStrStrOld>();
+        StringMatch_benchmark<AnsiString::TwoWay>();
         StringMatch_benchmark<AnsiString::MyStrStr>();
         printf("\n");
         StringMatch_benchmark<AnsiString::MemMem>();
@@ -592,6 +2089,7 @@ int main(int argc, char * argv[])
         StringMatch_benchmark<AnsiString::ShiftAnd>();
 #endif
         StringMatch_benchmark<AnsiString::ShiftOr>();
+        StringMatch_benchmark<AnsiString::ShiftOrWide>();
         StringMatch_benchmark<AnsiString::WordHash>();
         StringMatch_benchmark<AnsiString::Volnitsky>();
         StringMatch_benchmark<AnsiString::RabinKarp2>();
@@ -600,10 +2098,72 @@ int main(int argc, char * argv[])
 #if ENABLE_AHOCORASICK_TEST
         StringMatch_benchmark<AnsiString::AhoCorasick>();
 #endif
+        StringMatch_benchmark<AnsiString::CompactAhoCorasick>();
 
         printf("-------------------------------------------------------------------------------------------------\n");
         //printf("  ps: (*) indicates that not included the preprocessing time.\n");
         printf("\n");
+
+        printf("  Multi-pattern (%u)       CheckSum       States          Memory    Preprocessing   Search Time\n",
+               (unsigned int)kPatterns);
+        printf("-------------------------------------------------------------------------------------------------\n");
+
+        StringMatch_multi_pattern_benchmark<AhoCorasickImpl<char>>();
+        StringMatch_multi_pattern_benchmark<CompactAhoCorasickImpl<char>>();
+        StringMatch_multi_pattern_benchmark<ShiftOrMultiImpl<char>>();
+        StringMatch_multi_pattern_benchmark<TeddyImpl<char>>();
+        StringMatch_multi_pattern_benchmark<FdrImpl<char>>();
+        StringMatch_multi_pattern_benchmark<MultiPatternImpl<char>>();
+
+        printf("-------------------------------------------------------------------------------------------------\n");
+        printf("\n");
+
+        std::vector<std::string> keywords;
+        test::Corpus keyword_corpus;
+        StringMatch_make_keyword_set(keywords, keyword_corpus);
+
+        printf("  Multi-pattern (%u)    CheckSum       States          Memory    Preprocessing   Search Time\n",
+               (unsigned int)keywords.size());
+        printf("-------------------------------------------------------------------------------------------------\n");
+
+        StringMatch_keyword_set_benchmark<AhoCorasickImpl<char>>(keywords, keyword_corpus);
+        StringMatch_keyword_set_benchmark<CompactAhoCorasickImpl<char>>(keywords, keyword_corpus);
+        StringMatch_keyword_set_benchmark<FdrImpl<char>>(keywords, keyword_corpus);
+        StringMatch_keyword_set_benchmark<MultiPatternImpl<char>>(keywords, keyword_corpus);
+
+        printf("-------------------------------------------------------------------------------------------------\n");
+        printf("\n");
+
+#if ENABLE_MULTITHREAD_TEST
+        size_t thread_num = std::thread::hardware_concurrency();
+        if (thread_num < 2)
+            thread_num = 2;
+
+        printf("  Shared pattern           CheckSum      Threads    Mismatches    Search Time     Throughput\n");
+        printf("-------------------------------------------------------------------------------------------------\n");
+
+        StringMatch_multithread_benchmark<AnsiString::AutoStrStr>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::Kmp>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::BoyerMoore>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::BMTuned>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::Sunday>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::Horspool>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::QuickSearch>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::ShiftAnd>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::ShiftOr>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::WordHash>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::Volnitsky>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::RabinKarp2>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::AhoCorasick>(thread_num);
+        StringMatch_multithread_benchmark<AnsiString::CompactAhoCorasick>(thread_num);
+
+        printf("-------------------------------------------------------------------------------------------------\n");
+        printf("\n");
+#endif
+
+#if ENABLE_PARALLEL_TEST
+        StringMatch_parallel_benchmarks(ThreadPool::hardware_threads());
+#endif
 #endif
 
 #if (defined(_WIN32) || defined(WIN32) || defined(OS_WINDOWS) || defined(_WINDOWS_))
@@ -0,0 +1,339 @@
+
+#ifndef SUPPORT_BENCHMARK_RUNNER_H
+#define SUPPORT_BENCHMARK_RUNNER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "support/StopWatch.h"
+#include "support/PerfCounter.h"
+
+//
+// BenchmarkRunner: repeat a measurement and report min / median / p95 / mean / stddev.
+//
+// A sample is the time of a batch of runs, the batch is calibrated to last at least
+// min_sample_time, so the short runs (1 KB texts) are above the resolution of
+// the timer. The cold samples are always one run after the caches are evicted.
+// If the PerfCounters are given, the hardware counters of the timed runs are
+// reported per run too.
+//
+// BenchmarkWriter writes the records as CSV or JSON, keyed by the algorithm,
+// the corpus, the text size and the pattern length, for diffing the runs.
+//
+
+namespace test {
+
+//
+// Keep the value alive, so the optimiser can't drop the computation of it,
+// instead of summing the results into a checksum.
+//
+template <typename T>
+inline void do_not_optimize(const T & value) {
+#if defined(__GNUC__) || defined(__clang__)
+    __asm__ __volatile__("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T * sink;
+    sink = &value;
+#endif
+}
+
+struct BenchmarkStats {
+    std::size_t samples;
+    double min;             // In seconds per run.
+    double median;
+    double p95;
+    double mean;
+    double stddev;
+    PerfCounterValues counters;     // The average of a run.
+
+    BenchmarkStats() : samples(0), min(0.0), median(0.0), p95(0.0), mean(0.0), stddev(0.0) {}
+
+    // times: the seconds of every run.
+    static BenchmarkStats compute(std::vector<double> times) {
+        BenchmarkStats stats;
+        stats.samples = times.size();
+        if (times.empty())
+            return stats;
+
+        std::sort(times.begin(), times.end());
+        std::size_t n = times.size();
+        stats.min = times[0];
+        stats.median = (n % 2 != 0) ? times[n / 2] : ((times[n / 2 - 1] + times[n / 2]) / 2.0);
+        // Nearest rank.
+        std::size_t rank = (std::size_t)::ceil(0.95 * (double)n);
+        stats.p95 = times[(rank > 0) ? (rank - 1) : 0];
+
+        double sum = 0.0;
+        for (std::size_t i = 0; i < n; ++i)
+            sum += times[i];
+        stats.mean = sum / (double)n;
+
+        if (n > 1) {
+            double squares = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+                squares += (times[i] - stats.mean) * (times[i] - stats.mean);
+            stats.stddev = ::sqrt(squares / (double)(n - 1));
+        }
+        return stats;
+    }
+
+    // The throughput of the median run.
+    double gb_per_sec(uint64_t bytes) const {
+        return ((this->median > 0.0) ? ((double)bytes / this->median / 1.0e9) : 0.0);
+    }
+
+    double ns_per_byte(uint64_t bytes) const {
+        return ((bytes != 0) ? (this->median * 1.0e9 / (double)bytes) : 0.0);
+    }
+};
+
+class BenchmarkRunner {
+public:
+    struct Options {
+        std::size_t samples;        // The numbers of the samples.
+        double min_sample_time;     // In seconds.
+
+        Options() : samples(11), min_sample_time(0.001) {}
+    };
+
+private:
+    Options options_;
+    PerfCounters * perf_counters_;
+
+public:
+    explicit BenchmarkRunner(const Options & options = Options(),
+                             PerfCounters * perf_counters = nullptr)
+        : options_(options), perf_counters_(perf_counters) {
+        if (this->options_.samples == 0)
+            this->options_.samples = 1;
+    }
+
+    const Options & options() const { return this->options_; }
+    PerfCounters * perf_counters() const { return this->perf_counters_; }
+
+    // The warm samples: run() once untimed, calibrate the batch, then time the batches.
+    template <typename Function>
+    BenchmarkStats run(Function && function) const {
+        test::StopWatch sw;
+        function();
+
+        std::size_t batch = 1;
+        for (;;) {
+            sw.start();
+            for (std::size_t i = 0; i < batch; ++i)
+                function();
+            sw.stop();
+            if (sw.getSecond() >= this->options_.min_sample_time || batch >= ((std::size_t)1 << 30))
+                break;
+            batch *= 2;
+        }
+
+        std::vector<double> times;
+        times.reserve(this->options_.samples);
+        PerfCounterValues counters;
+        for (std::size_t s = 0; s < this->options_.samples; ++s) {
+            if (this->perf_counters_ != nullptr)
+                this->perf_counters_->start();
+            sw.start();
+            for (std::size_t i = 0; i < batch; ++i)
+                function();
+            sw.stop();
+            if (this->perf_counters_ != nullptr)
+                counters += this->perf_counters_->stop();
+            times.push_back(sw.getSecond() / (double)batch);
+        }
+
+        BenchmarkStats stats = BenchmarkStats::compute(times);
+        stats.counters = counters;
+        stats.counters /= (double)(this->options_.samples * batch);
+        return stats;
+    }
+
+    // The cold samples: prepare() (evict the caches) before every timed run.
+    template <typename Prepare, typename Function>
+    BenchmarkStats run_cold(Prepare && prepare, Function && function) const {
+        test::StopWatch sw;
+        std::vector<double> times;
+        times.reserve(this->options_.samples);
+        PerfCounterValues counters;
+        for (std::size_t s = 0; s < this->options_.samples; ++s) {
+            prepare();
+            if (this->perf_counters_ != nullptr)
+                this->perf_counters_->start();
+            sw.start();
+            function();
+            sw.stop();
+            if (this->perf_counters_ != nullptr)
+                counters += this->perf_counters_->stop();
+            times.push_back(sw.getSecond());
+        }
+
+        BenchmarkStats stats = BenchmarkStats::compute(times);
+        stats.counters = counters;
+        stats.counters /= (double)this->options_.samples;
+        return stats;
+    }
+};
+
+struct BenchmarkRecord {
+    std::string algorithm;
+    std::string corpus;
+    uint64_t    text_size;
+    std::size_t pattern_len;
+    std::string frequency;
+    bool        cold;
+    uint64_t    matches;
+    BenchmarkStats stats;
+
+    BenchmarkRecord() : text_size(0), pattern_len(0), cold(false), matches(0) {}
+};
+
+class BenchmarkWriter {
+public:
+    struct Format {
+        enum Type {
+            CSV,
+            JSON
+        };
+    };
+
+    // Return false if the file can't be written.
+    static bool write(const char * path, Format::Type format,
+                      const std::vector<BenchmarkRecord> & records) {
+        FILE * fp = ::fopen(path, "wb");
+        if (fp == nullptr)
+            return false;
+        if (format == Format::CSV)
+            BenchmarkWriter::write_csv(fp, records);
+        else
+            BenchmarkWriter::write_json(fp, records);
+        bool success = (::ferror(fp) == 0);
+        success = (::fclose(fp) == 0) && success;
+        return success;
+    }
+
+    static void write_csv(FILE * fp, const std::vector<BenchmarkRecord> & records) {
+        ::fprintf(fp, "algorithm,corpus,text_size,pattern_len,frequency,cache,matches,samples,"
+                      "min_ns,median_ns,p95_ns,mean_ns,stddev_ns,gb_per_sec,ns_per_byte");
+        for (int e = 0; e < PerfEvent::Last; ++e)
+            ::fprintf(fp, ",%s", PerfEvent::name((PerfEvent::Type)e));
+        ::fprintf(fp, "\n");
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const BenchmarkRecord & r = records[i];
+            ::fprintf(fp, "%s,%s,%llu,%u,%s,%s,%llu,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.4f,%.6f",
+                      BenchmarkWriter::csv_field(r.algorithm).c_str(),
+                      BenchmarkWriter::csv_field(r.corpus).c_str(),
+                      (unsigned long long)r.text_size, (unsigned)r.pattern_len,
+                      r.frequency.c_str(), r.cold ? "cold" : "warm",
+                      (unsigned long long)r.matches, (unsigned)r.stats.samples,
+                      r.stats.min * 1.0e9, r.stats.median * 1.0e9, r.stats.p95 * 1.0e9,
+                      r.stats.mean * 1.0e9, r.stats.stddev * 1.0e9,
+                      r.stats.gb_per_sec(r.text_size), r.stats.ns_per_byte(r.text_size));
+            // The unavailable counters are empty.
+            for (int e = 0; e < PerfEvent::Last; ++e) {
+                if (r.stats.counters.has((PerfEvent::Type)e))
+                    ::fprintf(fp, ",%.1f", r.stats.counters.get((PerfEvent::Type)e));
+                else
+                    ::fprintf(fp, ",");
+            }
+            ::fprintf(fp, "\n");
+        }
+    }
+
+    static void write_json(FILE * fp, const std::vector<BenchmarkRecord> & records) {
+        ::fprintf(fp, "[\n");
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const BenchmarkRecord & r = records[i];
+            ::fprintf(fp, "  {\"algorithm\": %s, \"corpus\": %s, \"text_size\": %llu, "
+                          "\"pattern_len\": %u, \"frequency\": \"%s\", \"cache\": \"%s\", "
+                          "\"matches\": %llu, \"samples\": %u, "
+                          "\"min_ns\": %.1f, \"median_ns\": %.1f, \"p95_ns\": %.1f, "
+                          "\"mean_ns\": %.1f, \"stddev_ns\": %.1f, "
+                          "\"gb_per_sec\": %.4f, \"ns_per_byte\": %.6f, \"counters\": %s}%s\n",
+                      BenchmarkWriter::json_string(r.algorithm).c_str(),
+                      BenchmarkWriter::json_string(r.corpus).c_str(),
+                      (unsigned long long)r.text_size, (unsigned)r.pattern_len,
+                      r.frequency.c_str(), r.cold ? "cold" : "warm",
+                      (unsigned long long)r.matches, (unsigned)r.stats.samples,
+                      r.stats.min * 1.0e9, r.stats.median * 1.0e9, r.stats.p95 * 1.0e9,
+                      r.stats.mean * 1.0e9, r.stats.stddev * 1.0e9,
+                      r.stats.gb_per_sec(r.text_size), r.stats.ns_per_byte(r.text_size),
+                      BenchmarkWriter::json_counters(r.stats.counters).c_str(),
+                      (i + 1 < records.size()) ? "," : "");
+        }
+        ::fprintf(fp, "]\n");
+    }
+
+private:
+    // Quote the field if it has a ',', a '"' or a new line.
+    static std::string csv_field(const std::string & value) {
+        if (value.find_first_of(",\"\n") == std::string::npos)
+            return value;
+        std::string field = "\"";
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            if (value[i] == '"')
+                field += '"';
+            field += value[i];
+        }
+        field += '"';
+        return field;
+    }
+
+    // The unavailable counters are null.
+    static std::string json_counters(const PerfCounterValues & counters) {
+        std::string str = "{";
+        for (int e = 0; e < PerfEvent::Last; ++e) {
+            char field[64];
+            if (counters.has((PerfEvent::Type)e)) {
+                ::snprintf(field, sizeof(field), "\"%s\": %.1f",
+                           PerfEvent::name((PerfEvent::Type)e), counters.get((PerfEvent::Type)e));
+            }
+            else {
+                ::snprintf(field, sizeof(field), "\"%s\": null", PerfEvent::name((PerfEvent::Type)e));
+            }
+            if (e != 0)
+                str += ", ";
+            str += field;
+        }
+        str += "}";
+        return str;
+    }
+
+    static std::string json_string(const std::string & value) {
+        std::string str = "\"";
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            char ch = value[i];
+            if (ch == '"' || ch == '\\') {
+                str += '\\';
+                str += ch;
+            }
+            else if ((unsigned char)ch < 0x20) {
+                char escape[8];
+                ::snprintf(escape, sizeof(escape), "\\u%04x", (unsigned)(unsigned char)ch);
+                str += escape;
+            }
+            else {
+                str += ch;
+            }
+        }
+        str += '"';
+        return str;
+    }
+};
+
+} // namespace test
+
+#endif // SUPPORT_BENCHMARK_RUNNER_H
@@ -0,0 +1,413 @@
+
+#ifndef SUPPORT_CORPUS_H
+#define SUPPORT_CORPUS_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "support/MappedFile.h"
+
+//
+// The corpora of the benchmarks: English text, DNA (4 symbols), protein (20 symbols),
+// random bytes and repetitive logs, or a file loaded from the disk. The corpora are
+// synthesised by a seeded generator, so the runs are repeatable.
+//
+// The text is followed by a '\0', but the random bytes corpus contains '\0' too,
+// so only the algorithms which honour text_len can be benchmarked on it.
+//
+
+namespace test {
+
+struct CorpusType {
+    enum Type {
+        English,
+        DNA,
+        Protein,
+        Binary,
+        Log,
+        File,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case English:   return "english";
+            case DNA:       return "dna";
+            case Protein:   return "protein";
+            case Binary:    return "binary";
+            case Log:       return "log";
+            case File:      return "file";
+            default:        return "unknown";
+        }
+    }
+
+    // Return CorpusType::Last if the name is unknown.
+    static Type parse(const char * name) {
+        for (int type = English; type < Last; ++type) {
+            if (::strcmp(name, CorpusType::name((Type)type)) == 0)
+                return (Type)type;
+        }
+        return Last;
+    }
+};
+
+struct PatternFrequency {
+    enum Type {
+        Absent,         // No match in the text.
+        Rare,           // Only a few matches, the text is scanned to the end.
+        Frequent,       // The most frequent one of the samples.
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Absent:    return "absent";
+            case Rare:      return "rare";
+            case Frequent:  return "frequent";
+            default:        return "unknown";
+        }
+    }
+};
+
+// SplitMix64, small and good enough for the corpora.
+class CorpusRandom {
+private:
+    uint64_t state_;
+
+public:
+    explicit CorpusRandom(uint64_t seed = 20201017ULL) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (this->state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return (z ^ (z >> 31));
+    }
+
+    // [0, limit)
+    std::size_t next(std::size_t limit) {
+        assert(limit != 0);
+        return (std::size_t)(this->next() % limit);
+    }
+};
+
+class Corpus {
+public:
+    typedef std::size_t size_type;
+
+private:
+    CorpusType::Type type_;
+    std::string name_;
+    std::string data_;          // c_str() is followed by a '\0'.
+
+public:
+    Corpus() : type_(CorpusType::Last) {}
+    ~Corpus() {}
+
+    CorpusType::Type type() const { return this->type_; }
+    const std::string & name() const { return this->name_; }
+
+    const char * data() const { return this->data_.c_str(); }
+    size_type size() const { return this->data_.size(); }
+
+    // Synthesise size bytes of the type.
+    bool generate(CorpusType::Type type, size_type size, uint64_t seed = 20201017ULL) {
+        CorpusRandom random(seed);
+        std::string text;
+        text.reserve(size + 1024);
+        switch (type) {
+            case CorpusType::English:
+                while (text.size() < size)
+                    Corpus::append_sentence(text, random);
+                break;
+            case CorpusType::DNA:
+                Corpus::append_symbols(text, size, "ACGT", random);
+                break;
+            case CorpusType::Protein:
+                Corpus::append_symbols(text, size, "ACDEFGHIKLMNPQRSTVWY", random);
+                break;
+            case CorpusType::Binary:
+                while (text.size() < size) {
+                    uint64_t bits = random.next();
+                    for (size_type i = 0; i < sizeof(bits) && text.size() < size; ++i) {
+                        text.push_back((char)(bits & 0xFF));
+                        bits >>= 8;
+                    }
+                }
+                break;
+            case CorpusType::Log:
+                while (text.size() < size)
+                    Corpus::append_log_line(text, random);
+                break;
+            default:
+                return false;
+        }
+        text.resize(size);
+        this->assign(type, CorpusType::name(type), text);
+        return true;
+    }
+
+    // Use a text of the caller as the corpus, the text is swapped in.
+    void set_text(const char * name, std::string & text) {
+        this->assign(CorpusType::File, name, text);
+    }
+
+    // Load a file, it's repeated up to size bytes if size > the file size,
+    // size = 0 means the whole file.
+    bool load(const char * path, size_type size = 0) {
+        StringMatch::MappedFile file;
+        MappedFileOptions options;
+        if (!file.open(path, options))
+            return false;
+
+        std::string text;
+        if (file.is_mapped()) {
+            text.assign(file.data(), file.data() + file.size());
+        }
+        else {
+            char buffer[64 * 1024];
+            int64_t bytes;
+            while ((bytes = file.read_fully(buffer, sizeof(buffer))) > 0) {
+                text.append(buffer, (size_type)bytes);
+                if (bytes < (int64_t)sizeof(buffer))
+                    break;
+            }
+            if (bytes < 0)
+                return false;
+        }
+        if (text.empty())
+            return false;
+
+        if (size != 0) {
+            size_type file_size = text.size();
+            text.reserve(size);
+            while (text.size() < size) {
+                size_type length = (std::min)(file_size, size - text.size());
+                text.append(text, 0, length);
+            }
+            text.resize(size);
+        }
+        const char * name = ::strrchr(path, '/');
+        this->assign(CorpusType::File, (name != nullptr) ? (name + 1) : path, text);
+        return true;
+    }
+
+    //
+    // Pick a pattern of the length and the frequency, return false if there
+    // isn't one (e.g. the absent 1-byte pattern of the random bytes).
+    //
+    // The candidates are the substrings at the random positions of the text,
+    // they are counted in the first sample_len bytes of the text. The frequent
+    // pattern is the most frequent candidate, the rare pattern is taken from the
+    // tail of the text and is the least frequent candidate, the absent pattern
+    // is a candidate with a changed last char which has no match in the text.
+    //
+    bool make_pattern(size_type length, PatternFrequency::Type frequency,
+                      std::string & pattern, uint64_t seed = 1) const {
+        static const size_type kCandidates = 16;
+        static const size_type kSampleLen = 1024 * 1024;
+
+        size_type text_len = this->size();
+        if (length == 0 || length > text_len)
+            return false;
+
+        CorpusRandom random(seed + length * 131 + (uint64_t)frequency);
+        const char * text = this->data();
+        size_type positions = text_len - length + 1;
+        size_type sample_len = (std::min)(text_len, kSampleLen);
+
+        if (frequency == PatternFrequency::Frequent) {
+            size_type sample_positions = sample_len - (std::min)(sample_len, length) + 1;
+            size_type best_count = 0;
+            for (size_type i = 0; i < kCandidates; ++i) {
+                size_type pos = random.next(sample_positions);
+                size_type count = Corpus::count(text, sample_len, text + pos, length);
+                if (count > best_count || pattern.empty()) {
+                    best_count = count;
+                    pattern.assign(text + pos, length);
+                }
+            }
+            return true;
+        }
+
+        // The last 1/8 of the text.
+        size_type tail = text_len - text_len / 8;
+        if (tail >= positions)
+            tail = 0;
+
+        if (frequency == PatternFrequency::Rare) {
+            size_type best_count = (size_type)-1;
+            for (size_type i = 0; i < kCandidates; ++i) {
+                size_type pos = tail + random.next(positions - tail);
+                size_type count = Corpus::count(text, sample_len, text + pos, length);
+                if (count < best_count) {
+                    best_count = count;
+                    pattern.assign(text + pos, length);
+                }
+            }
+            return true;
+        }
+
+        // Absent: change the last char of a candidate, check the whole text.
+        for (size_type i = 0; i < kCandidates * 4; ++i) {
+            size_type pos = tail + random.next(positions - tail);
+            std::string candidate(text + pos, length);
+            for (int ch = 0; ch < 256; ++ch) {
+                candidate[length - 1] = (char)((unsigned char)(candidate[length - 1] + 1));
+                if (Corpus::count(text, text_len, candidate.data(), length, 1) == 0) {
+                    pattern = candidate;
+                    return true;
+                }
+                // The short patterns of the random bytes are all present.
+                if (length <= 2 && this->type_ == CorpusType::Binary)
+                    break;
+            }
+        }
+        return false;
+    }
+
+private:
+    typedef StringMatch::MappedFile::Options MappedFileOptions;
+
+    void assign(CorpusType::Type type, const char * name, std::string & text) {
+        this->type_ = type;
+        this->name_ = name;
+        this->data_.swap(text);
+    }
+
+    // The overlapping matches, stop at max_count.
+    static size_type count(const char * text, size_type text_len,
+                           const char * pattern, size_type pattern_len,
+                           size_type max_count = (size_type)-1) {
+        size_type count = 0;
+        const char * first = text;
+        const char * last = text + text_len;
+        for (;;) {
+            const char * found = std::search(first, last, pattern, pattern + pattern_len);
+            if (found == last)
+                break;
+            if (++count >= max_count)
+                break;
+            first = found + 1;
+        }
+        return count;
+    }
+
+    static void append_symbols(std::string & text, size_type size,
+                               const char * alphabet, CorpusRandom & random) {
+        size_type alphabet_size = ::strlen(alphabet);
+        while (text.size() < size) {
+            text.push_back(alphabet[random.next(alphabet_size)]);
+        }
+    }
+
+    static std::vector<uint32_t> zipf_weights(size_type count) {
+        std::vector<uint32_t> cumulative;
+        uint32_t sum = 0;
+        for (size_type i = 0; i < count; ++i) {
+            sum += (uint32_t)(100000 / (i + 1));
+            cumulative.push_back(sum);
+        }
+        return cumulative;
+    }
+
+    // The words are picked up by a Zipf-like distribution: word i has the weight 1 / (i + 1).
+    static const char * pick_word(CorpusRandom & random) {
+        static const char * kWords[] = {
+            "the", "of", "and", "to", "a", "in", "is", "that", "it", "was",
+            "for", "on", "are", "as", "with", "his", "they", "at", "be", "this",
+            "from", "have", "or", "by", "one", "had", "not", "but", "what", "all",
+            "were", "when", "we", "there", "can", "an", "your", "which", "their", "said",
+            "state", "island", "population", "between", "people", "river", "mountain", "design",
+            "background", "california", "example", "sample", "generally", "published", "engraver",
+            "emblematic", "represent", "political", "dispute", "consists", "number", "largely",
+            "covered", "around", "historical", "depiction", "illustrated", "underneath", "golden",
+            "wealth", "shipping", "similar", "current", "admitted", "escutcheon", "goddess"
+        };
+        static const size_type kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+        static const std::vector<uint32_t> cumulative = Corpus::zipf_weights(kWordCount);
+        uint32_t value = (uint32_t)random.next(cumulative.back());
+        size_type index = (size_type)(std::upper_bound(cumulative.begin(), cumulative.end(), value)
+                                      - cumulative.begin());
+        return kWords[index];
+    }
+
+    static void append_sentence(std::string & text, CorpusRandom & random) {
+        size_type words = 5 + random.next(15);
+        for (size_type i = 0; i < words; ++i) {
+            const char * word = Corpus::pick_word(random);
+            size_type first = text.size();
+            text += word;
+            if (i == 0)
+                text[first] = (char)(text[first] - 'a' + 'A');
+            if (i + 1 < words) {
+                text += (random.next(10) == 0) ? ", " : " ";
+            }
+        }
+        text += (random.next(8) == 0) ? ".\n" : ". ";
+    }
+
+    static void append_log_line(std::string & text, CorpusRandom & random) {
+        static const char * kLevels[] = { "INFO", "INFO", "INFO", "INFO", "DEBUG", "DEBUG", "WARN", "ERROR" };
+        static const char * kPaths[] = {
+            "/api/v1/users", "/api/v1/orders", "/api/v1/search", "/api/v2/items",
+            "/static/app.js", "/healthz", "/login", "/api/v1/orders/checkout"
+        };
+        static const int kStatus[] = { 200, 200, 200, 200, 200, 201, 204, 301, 304, 400, 404, 500 };
+
+        char line[256];
+        size_type seconds = random.next(86400);
+        int length = ::snprintf(line, sizeof(line),
+            "2020-10-17T%02u:%02u:%02u.%03uZ %-5s [worker-%u] GET %s status=%d latency=%ums "
+            "request_id=%08x%08x\n",
+            (unsigned)(seconds / 3600), (unsigned)(seconds / 60 % 60), (unsigned)(seconds % 60),
+            (unsigned)random.next(1000),
+            kLevels[random.next(sizeof(kLevels) / sizeof(kLevels[0]))],
+            (unsigned)random.next(16),
+            kPaths[random.next(sizeof(kPaths) / sizeof(kPaths[0]))],
+            kStatus[random.next(sizeof(kStatus) / sizeof(kStatus[0]))],
+            (unsigned)random.next(2000),
+            (unsigned)random.next(), (unsigned)random.next());
+        if (length > 0)
+            text.append(line, (std::min)((size_type)length, sizeof(line) - 1));
+    }
+};
+
+//
+// Evict the caches before a cold run: read and write a buffer larger than
+// the last level cache.
+//
+class CacheFlusher {
+private:
+    std::vector<char> buffer_;
+
+public:
+    explicit CacheFlusher(std::size_t size = 64 * 1024 * 1024) : buffer_(size, 1) {}
+
+    int flush() {
+        volatile char * data = this->buffer_.data();
+        int sum = 0;
+        for (std::size_t i = 0; i < this->buffer_.size(); i += 64) {
+            sum += data[i];
+            data[i] = (char)sum;
+        }
+        return sum;
+    }
+};
+
+} // namespace test
+
+#endif // SUPPORT_CORPUS_H
@@ -0,0 +1,293 @@
+
+#ifndef SUPPORT_MAPPED_FILE_H
+#define SUPPORT_MAPPED_FILE_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#if defined(_WIN32) || defined(WIN32) || defined(OS_WINDOWS) || defined(_WINDOWS_)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#define SM_MAPPED_FILE_WINDOWS  1
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif // _WIN32
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <string.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace StringMatch {
+
+//
+// A read-only file: the regular files are mapped into the memory, the others
+// (pipes, sockets, char devices, or the files can't be mapped) are read in
+// chunks by read_fully(), use pread() if the file is seekable.
+//
+// The path "-" is the standard input.
+//
+class MappedFile {
+public:
+    struct Options {
+        bool use_mmap;          // Try to map the regular files.
+        bool populate;          // MAP_POPULATE: prefault the page tables at once.
+        bool huge_pages;        // MADV_HUGEPAGE: transparent huge pages if the kernel can.
+        bool sequential;        // MADV_SEQUENTIAL | MADV_WILLNEED, or POSIX_FADV_SEQUENTIAL.
+
+        Options() : use_mmap(true), populate(false), huge_pages(false), sequential(true) {}
+    };
+
+private:
+#if SM_MAPPED_FILE_WINDOWS
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int fd_;
+#endif
+    bool owns_file_;
+    bool seekable_;
+    bool mapped_;
+    const char * data_;
+    std::size_t size_;
+    uint64_t offset_;           // The read position of read_fully().
+
+public:
+    MappedFile()
+#if SM_MAPPED_FILE_WINDOWS
+        : file_(INVALID_HANDLE_VALUE), mapping_(NULL),
+#else
+        : fd_(-1),
+#endif
+          owns_file_(false), seekable_(false), mapped_(false),
+          data_(nullptr), size_(0), offset_(0) {
+    }
+
+    explicit MappedFile(const char * path, const Options & options = Options())
+#if SM_MAPPED_FILE_WINDOWS
+        : file_(INVALID_HANDLE_VALUE), mapping_(NULL),
+#else
+        : fd_(-1),
+#endif
+          owns_file_(false), seekable_(false), mapped_(false),
+          data_(nullptr), size_(0), offset_(0) {
+        this->open(path, options);
+    }
+
+    ~MappedFile() {
+        this->close();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator = (const MappedFile &) = delete;
+
+#if SM_MAPPED_FILE_WINDOWS
+    bool is_open() const { return (this->file_ != INVALID_HANDLE_VALUE); }
+#else
+    bool is_open() const { return (this->fd_ >= 0); }
+#endif
+    bool is_mapped() const { return this->mapped_; }
+    bool is_seekable() const { return this->seekable_; }
+
+    // The mapped bytes, only valid when is_mapped().
+    const char * data() const { return this->data_; }
+    std::size_t size() const { return this->size_; }
+
+    bool open(const char * path, const Options & options = Options()) {
+        this->close();
+        if (path == nullptr)
+            return false;
+
+#if SM_MAPPED_FILE_WINDOWS
+        if (::strcmp(path, "-") == 0) {
+            this->file_ = ::GetStdHandle(STD_INPUT_HANDLE);
+            this->owns_file_ = false;
+        }
+        else {
+            DWORD flags = options.sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+            this->file_ = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                        NULL, OPEN_EXISTING, flags, NULL);
+            this->owns_file_ = true;
+        }
+        if (this->file_ == INVALID_HANDLE_VALUE || this->file_ == NULL) {
+            this->file_ = INVALID_HANDLE_VALUE;
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (::GetFileType(this->file_) == FILE_TYPE_DISK && ::GetFileSizeEx(this->file_, &file_size)) {
+            this->seekable_ = true;
+            if (options.use_mmap && file_size.QuadPart > 0 &&
+                (uint64_t)file_size.QuadPart <= (uint64_t)((std::size_t)-1)) {
+                this->mapping_ = ::CreateFileMappingA(this->file_, NULL, PAGE_READONLY, 0, 0, NULL);
+                if (this->mapping_ != NULL) {
+                    void * view = ::MapViewOfFile(this->mapping_, FILE_MAP_READ, 0, 0, 0);
+                    if (view != NULL) {
+                        this->data_ = (const char *)view;
+                        this->size_ = (std::size_t)file_size.QuadPart;
+                        this->mapped_ = true;
+                    }
+                    else {
+                        ::CloseHandle(this->mapping_);
+                        this->mapping_ = NULL;
+                    }
+                }
+            }
+        }
+#else
+        if (::strcmp(path, "-") == 0) {
+            this->fd_ = STDIN_FILENO;
+            this->owns_file_ = false;
+        }
+        else {
+            this->fd_ = ::open(path, O_RDONLY);
+            this->owns_file_ = true;
+        }
+        if (this->fd_ < 0)
+            return false;
+
+        struct stat st;
+        if (::fstat(this->fd_, &st) != 0) {
+            this->close();
+            return false;
+        }
+
+        if (S_ISREG(st.st_mode)) {
+            this->seekable_ = true;
+            if (options.use_mmap && st.st_size > 0 &&
+                (uint64_t)st.st_size <= (uint64_t)((std::size_t)-1)) {
+                this->map((std::size_t)st.st_size, options);
+            }
+#if defined(POSIX_FADV_SEQUENTIAL)
+            if (!this->mapped_ && options.sequential) {
+                ::posix_fadvise(this->fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+#endif
+        }
+#endif // SM_MAPPED_FILE_WINDOWS
+        return true;
+    }
+
+    void close() {
+#if SM_MAPPED_FILE_WINDOWS
+        if (this->mapped_) {
+            ::UnmapViewOfFile((LPCVOID)this->data_);
+        }
+        if (this->mapping_ != NULL) {
+            ::CloseHandle(this->mapping_);
+            this->mapping_ = NULL;
+        }
+        if (this->file_ != INVALID_HANDLE_VALUE && this->owns_file_) {
+            ::CloseHandle(this->file_);
+        }
+        this->file_ = INVALID_HANDLE_VALUE;
+#else
+        if (this->mapped_) {
+            ::munmap((void *)this->data_, this->size_);
+        }
+        if (this->fd_ >= 0 && this->owns_file_) {
+            ::close(this->fd_);
+        }
+        this->fd_ = -1;
+#endif
+        this->owns_file_ = false;
+        this->seekable_ = false;
+        this->mapped_ = false;
+        this->data_ = nullptr;
+        this->size_ = 0;
+        this->offset_ = 0;
+    }
+
+    // Read the next size bytes, only stop early at the end of file.
+    // Return the numbers of bytes read, or -1 if failed.
+    int64_t read_fully(void * buffer, std::size_t size) {
+        assert(buffer != nullptr);
+        char * dest = (char *)buffer;
+        std::size_t total = 0;
+        while (total < size) {
+            int64_t bytes = this->read_some(dest + total, size - total);
+            if (bytes < 0)
+                return -1;
+            if (bytes == 0)
+                break;
+            total += (std::size_t)bytes;
+        }
+        return (int64_t)total;
+    }
+
+private:
+#if !SM_MAPPED_FILE_WINDOWS
+    void map(std::size_t size, const Options & options) {
+        int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+        if (options.populate)
+            flags |= MAP_POPULATE;
+#endif
+        void * addr = ::mmap(nullptr, size, PROT_READ, flags, this->fd_, 0);
+        if (addr == MAP_FAILED)
+            return;
+
+        this->data_ = (const char *)addr;
+        this->size_ = size;
+        this->mapped_ = true;
+
+        // The advices are only hints, ignore the errors.
+        if (options.sequential) {
+#if defined(MADV_SEQUENTIAL)
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+#endif
+#if defined(MADV_WILLNEED)
+            ::madvise(addr, size, MADV_WILLNEED);
+#endif
+        }
+#if defined(MADV_HUGEPAGE)
+        if (options.huge_pages)
+            ::madvise(addr, size, MADV_HUGEPAGE);
+#endif
+    }
+#endif // !SM_MAPPED_FILE_WINDOWS
+
+    int64_t read_some(char * buffer, std::size_t size) {
+#if SM_MAPPED_FILE_WINDOWS
+        DWORD to_read = (size > (std::size_t)0x40000000UL) ? (DWORD)0x40000000UL : (DWORD)size;
+        DWORD bytes = 0;
+        if (!::ReadFile(this->file_, buffer, to_read, &bytes, NULL)) {
+            // The write end of the pipe has been closed.
+            if (::GetLastError() == ERROR_BROKEN_PIPE)
+                return 0;
+            return -1;
+        }
+        this->offset_ += bytes;
+        return (int64_t)bytes;
+#else
+        for (;;) {
+            ssize_t bytes;
+            if (this->seekable_)
+                bytes = ::pread(this->fd_, buffer, size, (off_t)this->offset_);
+            else
+                bytes = ::read(this->fd_, buffer, size);
+            if (bytes >= 0) {
+                this->offset_ += (uint64_t)bytes;
+                return (int64_t)bytes;
+            }
+            if (errno != EINTR)
+                return -1;
+        }
+#endif
+    }
+};
+
+} // namespace StringMatch
+
+#endif // SUPPORT_MAPPED_FILE_H
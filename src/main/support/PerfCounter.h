@@ -0,0 +1,306 @@
+
+#ifndef SUPPORT_PERF_COUNTER_H
+#define SUPPORT_PERF_COUNTER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define SM_HAVE_PERF_EVENT  1
+#else
+#define SM_HAVE_PERF_EVENT  0
+#endif
+
+#include "basic/stddef.h"
+#include "basic/stdint.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+
+//
+// The hardware performance counters of the calling thread, by perf_event_open()
+// on Linux: cycles, instructions, branch misses, L1D read misses, LLC misses and
+// the TMA (top-down) slots if the PMU exports the "slots" event.
+//
+// Every counter is opened by itself, so a counter which the CPU, the kernel or
+// perf_event_paranoid doesn't allow is only marked as unavailable. The multiplexed
+// counters are scaled by time_enabled / time_running. On the other platforms
+// none of them is available.
+//
+// Usage:
+//
+//   PerfCounters counters;
+//   PerfCounterValues values;
+//   {
+//       PerfCounterScope scope(counters, values);
+//       ... // The code to be measured.
+//   }
+//   if (values.has(PerfEvent::Cycles)) ...
+//
+
+namespace test {
+
+struct PerfEvent {
+    enum Type {
+        Cycles,
+        Instructions,
+        BranchMisses,
+        L1DMisses,
+        LLCMisses,
+        Slots,
+        Last
+    };
+
+    static const char * name(Type type) {
+        switch (type) {
+            case Cycles:        return "cycles";
+            case Instructions:  return "instructions";
+            case BranchMisses:  return "branch_misses";
+            case L1DMisses:     return "l1d_misses";
+            case LLCMisses:     return "llc_misses";
+            case Slots:         return "slots";
+            default:            return "unknown";
+        }
+    }
+};
+
+struct PerfCounterValues {
+    double value[PerfEvent::Last];
+    bool valid[PerfEvent::Last];
+
+    PerfCounterValues() {
+        this->clear();
+    }
+
+    void clear() {
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            this->value[i] = 0.0;
+            this->valid[i] = false;
+        }
+    }
+
+    bool has(PerfEvent::Type type) const { return this->valid[type]; }
+    double get(PerfEvent::Type type) const { return this->value[type]; }
+
+    bool empty() const {
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            if (this->valid[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Instructions per cycle, or 0.0.
+    double ipc() const {
+        if (this->has(PerfEvent::Cycles) && this->has(PerfEvent::Instructions) &&
+            this->value[PerfEvent::Cycles] > 0.0)
+            return (this->value[PerfEvent::Instructions] / this->value[PerfEvent::Cycles]);
+        else
+            return 0.0;
+    }
+
+    PerfCounterValues & operator += (const PerfCounterValues & other) {
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            if (other.valid[i]) {
+                this->value[i] += other.value[i];
+                this->valid[i] = true;
+            }
+        }
+        return *this;
+    }
+
+    // The average of the runs.
+    PerfCounterValues & operator /= (double runs) {
+        if (runs > 0.0) {
+            for (int i = 0; i < PerfEvent::Last; ++i)
+                this->value[i] /= runs;
+        }
+        return *this;
+    }
+};
+
+class PerfCounters {
+private:
+    int fd_[PerfEvent::Last];
+
+public:
+    PerfCounters() {
+        for (int i = 0; i < PerfEvent::Last; ++i)
+            this->fd_[i] = -1;
+        this->open();
+    }
+
+    ~PerfCounters() {
+        this->close();
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters & operator = (const PerfCounters &) = delete;
+
+    bool is_available(PerfEvent::Type type) const { return (this->fd_[type] >= 0); }
+
+    bool is_available() const {
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            if (this->fd_[i] >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    void start() {
+#if SM_HAVE_PERF_EVENT
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            if (this->fd_[i] >= 0) {
+                ::ioctl(this->fd_[i], PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(this->fd_[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // Stop the counters and return the counts since start().
+    PerfCounterValues stop() {
+        PerfCounterValues values;
+#if SM_HAVE_PERF_EVENT
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            if (this->fd_[i] >= 0)
+                ::ioctl(this->fd_[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            if (this->fd_[i] < 0)
+                continue;
+            // read_format: value, time_enabled, time_running.
+            uint64_t data[3] = { 0, 0, 0 };
+            if (::read(this->fd_[i], data, sizeof(data)) != (ssize_t)sizeof(data))
+                continue;
+            // The counter was never scheduled on the PMU.
+            if (data[2] == 0)
+                continue;
+            double value = (double)data[0];
+            if (data[2] < data[1])
+                value = value * (double)data[1] / (double)data[2];
+            values.value[i] = value;
+            values.valid[i] = true;
+        }
+#endif
+        return values;
+    }
+
+private:
+#if SM_HAVE_PERF_EVENT
+    static int open_event(uint32_t type, uint64_t config) {
+        struct perf_event_attr attr;
+        ::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // This thread, any CPU.
+        return (int)::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    static uint64_t cache_config(uint64_t cache, uint64_t op, uint64_t result) {
+        return (cache | (op << 8) | (result << 16));
+    }
+
+    // The "slots" event of the core PMU, e.g. "event=0x00,umask=0x4" since Ice Lake.
+    static bool find_slots_event(uint32_t & type, uint64_t & config) {
+        FILE * fp = ::fopen("/sys/bus/event_source/devices/cpu/type", "r");
+        if (fp == nullptr)
+            return false;
+        unsigned int pmu_type = 0;
+        bool success = (::fscanf(fp, "%u", &pmu_type) == 1);
+        ::fclose(fp);
+        if (!success)
+            return false;
+
+        fp = ::fopen("/sys/bus/event_source/devices/cpu/events/slots", "r");
+        if (fp == nullptr)
+            return false;
+        char line[128];
+        success = (::fgets(line, sizeof(line), fp) != nullptr);
+        ::fclose(fp);
+        if (!success)
+            return false;
+
+        unsigned int event = 0, umask = 0;
+        const char * field = ::strstr(line, "event=");
+        if (field == nullptr || ::sscanf(field, "event=%x", &event) != 1)
+            return false;
+        field = ::strstr(line, "umask=");
+        if (field != nullptr && ::sscanf(field, "umask=%x", &umask) != 1)
+            return false;
+
+        type = pmu_type;
+        config = (uint64_t)event | ((uint64_t)umask << 8);
+        return true;
+    }
+#endif // SM_HAVE_PERF_EVENT
+
+    void open() {
+#if SM_HAVE_PERF_EVENT
+        this->fd_[PerfEvent::Cycles] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        this->fd_[PerfEvent::Instructions] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        this->fd_[PerfEvent::BranchMisses] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        this->fd_[PerfEvent::L1DMisses] = open_event(PERF_TYPE_HW_CACHE,
+            cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                         PERF_COUNT_HW_CACHE_RESULT_MISS));
+        this->fd_[PerfEvent::LLCMisses] = open_event(PERF_TYPE_HW_CACHE,
+            cache_config(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                         PERF_COUNT_HW_CACHE_RESULT_MISS));
+        uint32_t slots_type;
+        uint64_t slots_config;
+        if (find_slots_event(slots_type, slots_config))
+            this->fd_[PerfEvent::Slots] = open_event(slots_type, slots_config);
+#endif
+    }
+
+    void close() {
+#if SM_HAVE_PERF_EVENT
+        for (int i = 0; i < PerfEvent::Last; ++i) {
+            if (this->fd_[i] >= 0) {
+                ::close(this->fd_[i]);
+                this->fd_[i] = -1;
+            }
+        }
+#endif
+    }
+};
+
+//
+// Count the scope: the counts are added to values when the scope ends.
+//
+class PerfCounterScope {
+private:
+    PerfCounters & counters_;
+    PerfCounterValues & values_;
+
+public:
+    PerfCounterScope(PerfCounters & counters, PerfCounterValues & values)
+        : counters_(counters), values_(values) {
+        this->counters_.start();
+    }
+
+    ~PerfCounterScope() {
+        this->values_ += this->counters_.stop();
+    }
+
+    PerfCounterScope(const PerfCounterScope &) = delete;
+    PerfCounterScope & operator = (const PerfCounterScope &) = delete;
+};
+
+} // namespace test
+
+#endif // SUPPORT_PERF_COUNTER_H
@@ -58,6 +58,16 @@ inline std::size_t strlen(const wchar_t * str) {
     return (std::size_t)::wcslen((const wchar_t *)str);
 }
 
+template <>
+inline std::size_t strlen(const char16_t * str) {
+    return (std::size_t)std::char_traits<char16_t>::length(str);
+}
+
+template <>
+inline std::size_t strlen(const char32_t * str) {
+    return (std::size_t)std::char_traits<char32_t>::length(str);
+}
+
 } // namespace detail
 
 template <typename CharTy>
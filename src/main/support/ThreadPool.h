@@ -0,0 +1,156 @@
+
+#ifndef SUPPORT_THREAD_POOL_H
+#define SUPPORT_THREAD_POOL_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+#pragma once
+#endif
+
+#include "basic/stddef.h"
+#include <assert.h>
+
+#include <cstddef>
+#include <exception>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace StringMatch {
+
+//
+// A fork-join thread pool: run(task) calls task(thread_id) on every thread of
+// the pool at the same time, and returns after all of them are finished.
+// The caller thread is the thread 0, so a pool of N threads owns N - 1 workers.
+// The workers are created once and sleep between two runs. If the task throws
+// on any thread, run() still waits for all of them, and then rethrows the first
+// exception on the caller thread.
+//
+class ThreadPool {
+public:
+    typedef std::function<void (std::size_t)> task_type;
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::mutex run_mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const task_type * task_;
+    std::exception_ptr error_;      // The first exception of the workers in this run.
+    std::size_t generation_;
+    std::size_t running_;
+    bool stop_;
+
+public:
+    // thread_num = 0 means std::thread::hardware_concurrency().
+    explicit ThreadPool(std::size_t thread_num = 0)
+        : task_(nullptr), generation_(0), running_(0), stop_(false) {
+        if (thread_num == 0)
+            thread_num = ThreadPool::hardware_threads();
+        for (std::size_t id = 1; id < thread_num; ++id) {
+            this->workers_.emplace_back(&ThreadPool::worker, this, id);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->stop_ = true;
+        }
+        this->start_cv_.notify_all();
+        for (std::size_t i = 0; i < this->workers_.size(); ++i) {
+            this->workers_[i].join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator = (const ThreadPool &) = delete;
+
+    static std::size_t hardware_threads() {
+        std::size_t thread_num = std::thread::hardware_concurrency();
+        return ((thread_num != 0) ? thread_num : 1);
+    }
+
+    // The numbers of threads, include the caller thread.
+    std::size_t size() const { return (this->workers_.size() + 1); }
+
+    // Can be called from any thread, the runs are serialized.
+    void run(const task_type & task) {
+        std::lock_guard<std::mutex> run_lock(this->run_mutex_);
+        if (this->workers_.empty()) {
+            task(0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->task_ = &task;
+            this->running_ = this->workers_.size();
+            this->generation_++;
+        }
+        this->start_cv_.notify_all();
+
+        // The workers still call through task_, so don't leave before they're done.
+        std::exception_ptr error;
+        try {
+            task(0);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            this->done_cv_.wait(lock, [this]() { return (this->running_ == 0); });
+            this->task_ = nullptr;
+            if (!error)
+                error = this->error_;
+            this->error_ = nullptr;
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    void worker(std::size_t id) {
+        std::size_t generation = 0;
+        for (;;) {
+            const task_type * task;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex_);
+                this->start_cv_.wait(lock, [this, generation]() {
+                    return (this->stop_ || this->generation_ != generation);
+                });
+                if (this->stop_)
+                    return;
+                generation = this->generation_;
+                task = this->task_;
+            }
+
+            assert(task != nullptr);
+            std::exception_ptr error;
+            try {
+                (*task)(id);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                if (error && !this->error_)
+                    this->error_ = error;
+                assert(this->running_ > 0);
+                if (--this->running_ == 0)
+                    this->done_cv_.notify_one();
+            }
+        }
+    }
+};
+
+} // namespace StringMatch
+
+#endif // SUPPORT_THREAD_POOL_H
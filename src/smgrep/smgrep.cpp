@@ -0,0 +1,699 @@
+
+//
+// smgrep: a grep-style front end of the StringMatch algorithms.
+//
+// Usage: smgrep [options] PATTERN [FILE...]
+//        smgrep [options] -f PATTERN_FILE [FILE...]
+//
+// The regular files are mapped and searched in place, the pipes and stdin ("-")
+// are read by lines. The files are searched on a thread pool, and the output is
+// printed in the order of the files on the command line: the file at the print
+// cursor writes to stdout as it goes, only the files ahead of it are buffered.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+
+#include "StringMatch.h"
+#include "support/StopWatch.h"
+#include "support/MappedFile.h"
+#include "support/ThreadPool.h"
+
+#include "algorithm/MemMem.h"
+#include "algorithm/AutoStrStr.h"
+#include "algorithm/SmartPattern.h"
+#include "algorithm/AutoTune.h"
+#include "algorithm/TwoWay.h"
+#include "algorithm/StdSearch.h"
+#include "algorithm/Kmp.h"
+#include "algorithm/KmpStd.h"
+#include "algorithm/BoyerMoore.h"
+#include "algorithm/Sunday.h"
+#include "algorithm/Horspool.h"
+#include "algorithm/QuickSearch.h"
+#include "algorithm/BMTuned.h"
+#include "algorithm/ShiftAnd.h"
+#include "algorithm/ShiftOr.h"
+#include "algorithm/ShiftOrWide.h"
+#include "algorithm/NoCaseStrStr.h"
+#include "algorithm/WordHash.h"
+#include "algorithm/Volnitsky.h"
+#include "algorithm/AhoCorasick.h"
+#include "algorithm/CompactAhoCorasick.h"
+
+using namespace StringMatch;
+
+namespace {
+
+enum ExitCode {
+    kExitMatched = 0,
+    kExitNoMatch = 1,
+    kExitError   = 2
+};
+
+struct Options {
+    std::vector<std::string> patterns;
+    std::vector<std::string> files;
+    const char * algorithm;
+    std::size_t threads;        // 0 means all of the hardware threads.
+    std::size_t buffer_size;    // The buffer size of the read path.
+    bool count;                 // -c: print the numbers of the matching lines (or the matches with -o).
+    bool offsets;               // -o: print the byte offset of every match.
+    bool files_with_matches;    // -l: print the names of the files which have a match.
+    bool line_number;           // -n
+    bool byte_offset;           // -b: the byte offset of the line.
+    int  with_filename;         // -H = 1, -h = 0, default -1: when there are more than one file.
+    bool stats;                 // -s: print the throughput to stderr.
+    bool ignore_case;           // -i: use NoCaseStrStr.
+    bool utf8;                  // --utf8: fold the non-ASCII patterns as UTF-8, implies -i.
+    MappedFile::Options file_options;
+
+    Options() : algorithm("AutoStrStr"), threads(0), buffer_size(1024 * 1024),
+                count(false), offsets(false), files_with_matches(false),
+                line_number(false), byte_offset(false), with_filename(-1),
+                stats(false), ignore_case(false), utf8(false), file_options() {
+    }
+};
+
+// The output of a file is handed to the printer in the chunks of this size.
+static const std::size_t kOutputChunkSize = 64 * 1024;
+
+//
+// Print the output of the files in the order of the command line. The file at
+// the print cursor writes to stdout directly, the files ahead of the cursor keep
+// their output until the cursor reaches them.
+//
+class OrderedPrinter {
+private:
+    std::mutex mutex_;
+    std::vector<std::string> pending_;  // The output of the files ahead of the cursor.
+    std::vector<char> finished_;
+    std::size_t next_print_;            // The print cursor.
+
+public:
+    explicit OrderedPrinter(std::size_t file_count)
+        : pending_(file_count), finished_(file_count, 0), next_print_(0) {
+    }
+
+    // Hand over a chunk of the output of the file, the output is cleared.
+    void write(std::size_t file, std::string & output) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->write_locked(file, output);
+    }
+
+    // Hand over the last output of the file, and move the cursor over the
+    // finished files. The next file prints the output it has kept.
+    void finish(std::size_t file, std::string & output) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->write_locked(file, output);
+        std::string().swap(output);
+        this->finished_[file] = 1;
+        while (this->next_print_ < this->finished_.size() && this->finished_[this->next_print_]) {
+            this->next_print_++;
+            if (this->next_print_ < this->pending_.size()) {
+                std::string & pending = this->pending_[this->next_print_];
+                this->print(pending);
+                std::string().swap(pending);
+            }
+        }
+    }
+
+private:
+    void write_locked(std::size_t file, std::string & output) {
+        if (file == this->next_print_)
+            this->print(output);
+        else
+            this->pending_[file] += output;
+        output.clear();
+    }
+
+    void print(const std::string & output) {
+        if (!output.empty())
+            ::fwrite(output.data(), 1, output.size(), stdout);
+    }
+};
+
+struct FileResult {
+    std::string output;         // The output hasn't been handed to the printer.
+    uint64_t bytes;
+    uint64_t matches;           // The matching lines, or the matches with -o.
+    bool error;
+    OrderedPrinter * printer;
+    std::size_t file;           // The index of the file on the command line.
+
+    FileResult() : bytes(0), matches(0), error(false), printer(nullptr), file(0) {}
+
+    // Hand the output to the printer once it's a full chunk, or any with force.
+    void flush(bool force = false) {
+        if (this->output.size() >= kOutputChunkSize || (force && !this->output.empty())) {
+            assert(this->printer != nullptr);
+            this->printer->write(this->file, this->output);
+        }
+    }
+};
+
+const char * find_line_start(const char * first, const char * pos) {
+    while (pos > first && *(pos - 1) != '\n')
+        --pos;
+    return pos;
+}
+
+const char * find_line_end(const char * pos, const char * last) {
+    const char * eol = (const char *)::memchr(pos, '\n', (std::size_t)(last - pos));
+    return ((eol != nullptr) ? eol : last);
+}
+
+uint64_t count_lines(const char * first, const char * last) {
+    uint64_t lines = 0;
+    while (first < last) {
+        const char * eol = (const char *)::memchr(first, '\n', (std::size_t)(last - first));
+        if (eol == nullptr)
+            break;
+        lines++;
+        first = eol + 1;
+    }
+    return lines;
+}
+
+template <typename AlgorithmTy>
+typename AlgorithmTy::Pattern * new_pattern(const std::string & pattern, const Options & options) {
+    SM_UNUSED_VAR(options);
+    return new typename AlgorithmTy::Pattern(pattern);
+}
+
+template <>
+AnsiString::NoCaseStrStr::Pattern *
+new_pattern<AnsiString::NoCaseStrStr>(const std::string & pattern, const Options & options) {
+    return new AnsiString::NoCaseStrStr::Pattern(pattern, options.utf8 ? CaseFold::Utf8 : CaseFold::Ascii);
+}
+
+template <typename AlgorithmTy>
+class Grep {
+public:
+    typedef typename AlgorithmTy::Pattern   pattern_type;
+    typedef std::size_t                     size_type;
+
+    static const size_type npos = (size_type)-1;
+
+private:
+    const Options & options_;
+    std::vector<std::unique_ptr<pattern_type>> patterns_;   // Pattern isn't copyable.
+    bool with_filename_;
+
+    // The search state of a buffer: the next match of every pattern.
+    struct Scanner {
+        const Grep * grep;
+        const char * data;
+        size_type length;
+        std::vector<size_type> next;    // The start of the next match, or npos.
+        bool primed;
+
+        Scanner(const Grep * grep, const char * data, size_type length)
+            : grep(grep), data(data), length(length), next(grep->patterns_.size(), 0),
+              primed(false) {
+        }
+
+        // Return the leftmost match starts at pos or later, and its pattern.
+        size_type find(size_type pos, size_type & which) {
+            size_type leftmost = npos;
+            for (size_type i = 0; i < this->next.size(); ++i) {
+                // Search again only if the last match of it has been passed.
+                if (!this->primed || (this->next[i] != npos && this->next[i] < pos)) {
+                    const pattern_type & pattern = *this->grep->patterns_[i];
+                    Long index_of = Status::NotFound;
+                    if (pos + pattern.size() <= this->length)
+                        index_of = pattern.match(this->data + pos, this->length - pos);
+                    this->next[i] = (index_of >= 0) ? (pos + (size_type)index_of) : npos;
+                }
+                if (this->next[i] < leftmost) {
+                    leftmost = this->next[i];
+                    which = i;
+                }
+            }
+            this->primed = true;
+            return leftmost;
+        }
+    };
+
+public:
+    Grep(const Options & options, bool with_filename)
+        : options_(options), with_filename_(with_filename) {
+        this->patterns_.reserve(options.patterns.size());
+        for (size_type i = 0; i < options.patterns.size(); ++i) {
+            this->patterns_.emplace_back(new_pattern<AlgorithmTy>(options.patterns[i], options));
+        }
+    }
+
+    void search(const std::string & file_path, FileResult & result) const {
+        const std::string path = (file_path == "-") ? std::string("(standard input)") : file_path;
+        MappedFile file;
+        if (!file.open(file_path.c_str(), this->options_.file_options)) {
+            ::fprintf(stderr, "smgrep: %s: %s\n", path.c_str(), ::strerror(errno));
+            result.error = true;
+            return;
+        }
+
+        uint64_t line_no = 1;
+        if (file.is_mapped()) {
+            result.bytes = file.size();
+            this->scan(path, file.data(), file.size(), 0, line_no, result);
+        }
+        else {
+            this->read_by_lines(path, file, line_no, result);
+        }
+
+        if (this->options_.files_with_matches) {
+            if (result.matches != 0)
+                result.output += path + "\n";
+        }
+        else if (this->options_.count) {
+            this->print_filename(path, result.output);
+            result.output += std::to_string(result.matches) + "\n";
+        }
+    }
+
+private:
+    void print_filename(const std::string & path, std::string & output) const {
+        if (this->with_filename_) {
+            output += path;
+            output += ':';
+        }
+    }
+
+    // Read the complete lines into the buffer and scan them, the last partial
+    // line is moved to the head of the buffer, the buffer grows for a long line.
+    void read_by_lines(const std::string & path, MappedFile & file,
+                       uint64_t & line_no, FileResult & result) const {
+        std::vector<char> buffer(this->options_.buffer_size ? this->options_.buffer_size : 1);
+        size_type carry = 0;
+        uint64_t base = 0;
+        for (;;) {
+            size_type request = buffer.size() - carry;
+            int64_t bytes = file.read_fully(buffer.data() + carry, request);
+            if (bytes < 0) {
+                ::fprintf(stderr, "smgrep: %s: %s\n", path.c_str(), ::strerror(errno));
+                result.error = true;
+                return;
+            }
+            result.bytes += (uint64_t)bytes;
+            size_type length = carry + (size_type)bytes;
+            bool eof = ((size_type)bytes < request);
+
+            size_type lines_len = length;
+            if (!eof) {
+                const char * last_line = find_line_start(buffer.data(), buffer.data() + length);
+                lines_len = (size_type)(last_line - buffer.data());
+                if (lines_len == 0) {
+                    // A line is longer than the buffer.
+                    carry = length;
+                    buffer.resize(buffer.size() * 2);
+                    continue;
+                }
+            }
+
+            if (!this->scan(path, buffer.data(), lines_len, base, line_no, result))
+                return;
+            // The lines of a pipe are printed as they come.
+            result.flush(true);
+            if (eof)
+                return;
+
+            carry = length - lines_len;
+            ::memmove(buffer.data(), buffer.data() + lines_len, carry);
+            base += lines_len;
+        }
+    }
+
+    // Scan the buffer of complete lines at the offset base of the file.
+    // Return false if the rest of the file needn't to be searched.
+    bool scan(const std::string & path, const char * data, size_type length, uint64_t base,
+              uint64_t & line_no, FileResult & result) const {
+        const Options & options = this->options_;
+        Scanner scanner(this, data, length);
+        const char * counted = data;
+        size_type pos = 0;
+        size_type which = 0;
+        while (pos < length) {
+            size_type index = scanner.find(pos, which);
+            if (index == npos)
+                break;
+            result.matches++;
+            if (options.files_with_matches)
+                return false;
+
+            if (options.offsets) {
+                // The non-overlapping matches, from left to right.
+                if (!options.count) {
+                    this->print_filename(path, result.output);
+                    result.output += std::to_string(base + index) + "\n";
+                    result.flush();
+                }
+                pos = index + this->patterns_[which]->size();
+                continue;
+            }
+
+            const char * line_first = find_line_start(data + pos, data + index);
+            const char * line_last = find_line_end(data + index, data + length);
+            if (!options.count) {
+                this->print_filename(path, result.output);
+                if (options.line_number) {
+                    line_no += count_lines(counted, line_first);
+                    counted = line_first;
+                    result.output += std::to_string(line_no) + ":";
+                }
+                if (options.byte_offset) {
+                    result.output += std::to_string(base + (uint64_t)(line_first - data)) + ":";
+                }
+                result.output.append(line_first, line_last);
+                result.output += '\n';
+                result.flush();
+            }
+            pos = (size_type)(line_last - data) + 1;
+        }
+        if (options.line_number)
+            line_no += count_lines(counted, data + length);
+        return true;
+    }
+};
+
+template <typename AlgorithmTy>
+int run_grep(const Options & options) {
+    bool with_filename = (options.with_filename >= 0) ? (options.with_filename != 0)
+                                                      : (options.files.size() > 1);
+    Grep<AlgorithmTy> grep(options, with_filename);
+
+    std::size_t file_count = options.files.size();
+    OrderedPrinter printer(file_count);
+    std::vector<FileResult> results(file_count);
+    for (std::size_t i = 0; i < file_count; ++i) {
+        results[i].printer = &printer;
+        results[i].file = i;
+    }
+    std::atomic<std::size_t> next_file(0);
+
+    std::size_t threads = options.threads ? options.threads : ThreadPool::hardware_threads();
+    if (threads > file_count)
+        threads = file_count;
+    ThreadPool pool(threads);
+
+    test::StopWatch sw;
+    sw.start();
+
+    pool.run([&](std::size_t thread_id) {
+        SM_UNUSED_VAR(thread_id);
+        for (;;) {
+            std::size_t file = next_file.fetch_add(1, std::memory_order_relaxed);
+            if (file >= file_count)
+                break;
+            grep.search(options.files[file], results[file]);
+            printer.finish(file, results[file].output);
+        }
+    });
+    ::fflush(stdout);
+
+    sw.stop();
+
+    uint64_t bytes = 0, matches = 0;
+    bool error = false;
+    for (std::size_t i = 0; i < file_count; ++i) {
+        bytes += results[i].bytes;
+        matches += results[i].matches;
+        error = error || results[i].error;
+    }
+
+    if (options.stats) {
+        double elapsed = sw.getMillisec();
+        double mb_per_sec = (elapsed > 0.0) ? ((double)bytes / (1024.0 * 1024.0)) / (elapsed / 1000.0) : 0.0;
+        ::fprintf(stderr, "smgrep: %s, %u thread(s), %u file(s), %llu bytes, %llu %s, "
+                          "%0.3f ms, %0.1f MB/s\n",
+                  AlgorithmTy::name(), (unsigned)pool.size(), (unsigned)file_count,
+                  (unsigned long long)bytes, (unsigned long long)matches,
+                  options.offsets ? "match(es)" : "matching line(s)",
+                  elapsed, mb_per_sec);
+    }
+
+    if (error)
+        return kExitError;
+    return ((matches != 0) ? kExitMatched : kExitNoMatch);
+}
+
+struct AlgorithmEntry {
+    const char * name;              // The AnsiString::* typedef.
+    const char * (*display_name)();
+    int (*run)(const Options &);
+    std::size_t max_pattern_len;    // 0 is unlimited.
+};
+
+#define SMGREP_ALGORITHM(Name, MaxLen) \
+    { #Name, &AnsiString::Name::name, &run_grep<AnsiString::Name>, MaxLen }
+
+// The algorithms which honour text_len: the mapped files aren't null-terminated.
+const AlgorithmEntry kAlgorithms[] = {
+    SMGREP_ALGORITHM(AutoStrStr,            0),
+    SMGREP_ALGORITHM(Smart,                 0),
+    SMGREP_ALGORITHM(AutoTune,              0),
+    SMGREP_ALGORITHM(MemMem,                0),
+    SMGREP_ALGORITHM(StdSearch,             0),
+    SMGREP_ALGORITHM(Kmp,                   0),
+    SMGREP_ALGORITHM(KmpStd,                0),
+    SMGREP_ALGORITHM(BoyerMoore,            0),
+    SMGREP_ALGORITHM(BMTuned,               0),
+    SMGREP_ALGORITHM(Horspool,              0),
+    SMGREP_ALGORITHM(QuickSearch,           0),
+    SMGREP_ALGORITHM(Sunday,                0),
+    SMGREP_ALGORITHM(TwoWay,                0),
+    SMGREP_ALGORITHM(ShiftAnd,              sizeof(size_t) * 8),
+    SMGREP_ALGORITHM(ShiftOr,               sizeof(size_t) * 8),
+    SMGREP_ALGORITHM(ShiftOrWide,           512),
+    SMGREP_ALGORITHM(WordHash,              0),
+    SMGREP_ALGORITHM(Volnitsky,             0),
+    SMGREP_ALGORITHM(AhoCorasick,           0),
+    SMGREP_ALGORITHM(CompactAhoCorasick,    0),
+    SMGREP_ALGORITHM(NoCaseStrStr,          0),
+};
+
+#undef SMGREP_ALGORITHM
+
+const AlgorithmEntry * find_algorithm(const char * name) {
+    for (std::size_t i = 0; i < sizeof(kAlgorithms) / sizeof(kAlgorithms[0]); ++i) {
+        const char * s1 = kAlgorithms[i].name;
+        const char * s2 = name;
+        while (*s1 != '\0' && ::tolower((unsigned char)*s1) == ::tolower((unsigned char)*s2)) {
+            ++s1;
+            ++s2;
+        }
+        if (*s1 == '\0' && *s2 == '\0')
+            return &kAlgorithms[i];
+    }
+    return nullptr;
+}
+
+void print_usage() {
+    ::printf("Usage: smgrep [options] PATTERN [FILE...]\n"
+             "       smgrep [options] -f PATTERN_FILE [FILE...]\n"
+             "\n"
+             "Search the FILEs (or stdin, \"-\") for the fixed string PATTERN.\n"
+             "\n"
+             "  -a, --algorithm NAME      the algorithm, see --list (default: AutoStrStr)\n"
+             "  -f, --file FILE           read the patterns from FILE, one per line\n"
+             "  -i, --ignore-case         ignore the case of the ASCII letters (-a NoCaseStrStr)\n"
+             "      --utf8                ignore the case of the UTF-8 patterns too, implies -i\n"
+             "  -c, --count               print the numbers of the matching lines\n"
+             "  -o, --offsets             print the byte offset of every match\n"
+             "  -l, --files-with-matches  print only the names of the files which match\n"
+             "  -n, --line-number         print the line number of the line\n"
+             "  -b, --byte-offset         print the byte offset of the line\n"
+             "  -H, --with-filename       print the file name of every match\n"
+             "  -h, --no-filename         never print the file name\n"
+             "  -j, --threads N           search N files in parallel (default: all CPUs)\n"
+             "      --calibration FILE    load the thresholds of -a Smart (StringMatch --calibrate)\n"
+             "      --no-mmap             read the files instead of mapping them\n"
+             "      --populate            prefault the mapping (MAP_POPULATE)\n"
+             "      --huge-pages          advise the transparent huge pages (MADV_HUGEPAGE)\n"
+             "  -s, --stats               print the throughput to stderr\n"
+             "      --list                list the algorithms\n"
+             "      --help                print this help\n"
+             "\n"
+             "Exit status: 0 if a match is found, 1 if not, 2 if an error occurred.\n");
+}
+
+void print_algorithms() {
+    for (std::size_t i = 0; i < sizeof(kAlgorithms) / sizeof(kAlgorithms[0]); ++i) {
+        ::printf("  %-22s %s\n", kAlgorithms[i].name, kAlgorithms[i].display_name());
+    }
+}
+
+bool read_pattern_file(const char * path, std::vector<std::string> & patterns) {
+    FILE * fp = (::strcmp(path, "-") == 0) ? stdin : ::fopen(path, "rb");
+    if (fp == nullptr)
+        return false;
+    std::string line;
+    int ch;
+    do {
+        ch = ::fgetc(fp);
+        if (ch == '\n' || ch == EOF) {
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.resize(line.size() - 1);
+            // The empty lines are skipped.
+            if (!line.empty())
+                patterns.push_back(line);
+            line.clear();
+        }
+        else {
+            line += (char)ch;
+        }
+    } while (ch != EOF);
+    bool success = (::ferror(fp) == 0);
+    if (fp != stdin)
+        ::fclose(fp);
+    return success;
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    Options options;
+    bool has_pattern_file = false;
+    bool has_algorithm = false;
+    std::vector<const char *> args;
+
+    for (int i = 1; i < argc; ++i) {
+        const char * arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (::strcmp(arg, "--") == 0) {
+            for (++i; i < argc; ++i)
+                args.push_back(argv[i]);
+            break;
+        }
+        else if (arg[0] != '-' || arg[1] == '\0') {
+            args.push_back(arg);
+        }
+        else if (::strcmp(arg, "-a") == 0 || ::strcmp(arg, "--algorithm") == 0) {
+            if (!has_value) goto missing_value;
+            options.algorithm = argv[++i];
+            has_algorithm = true;
+        }
+        else if (::strcmp(arg, "-f") == 0 || ::strcmp(arg, "--file") == 0) {
+            if (!has_value) goto missing_value;
+            if (!read_pattern_file(argv[++i], options.patterns)) {
+                ::fprintf(stderr, "smgrep: %s: %s\n", argv[i], ::strerror(errno));
+                return kExitError;
+            }
+            has_pattern_file = true;
+        }
+        else if (::strcmp(arg, "--calibration") == 0) {
+            if (!has_value) goto missing_value;
+            SmartThresholds thresholds;
+            if (!thresholds.load(argv[++i])) {
+                ::fprintf(stderr, "smgrep: %s: can not load the calibration file\n", argv[i]);
+                return kExitError;
+            }
+            SmartThresholds::set_global(thresholds);
+        }
+        else if (::strcmp(arg, "-j") == 0 || ::strcmp(arg, "--threads") == 0) {
+            if (!has_value) goto missing_value;
+            options.threads = (std::size_t)::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (::strcmp(arg, "-i") == 0 || ::strcmp(arg, "--ignore-case") == 0)
+            options.ignore_case = true;
+        else if (::strcmp(arg, "--utf8") == 0)
+            options.ignore_case = options.utf8 = true;
+        else if (::strcmp(arg, "-c") == 0 || ::strcmp(arg, "--count") == 0)
+            options.count = true;
+        else if (::strcmp(arg, "-o") == 0 || ::strcmp(arg, "--offsets") == 0)
+            options.offsets = true;
+        else if (::strcmp(arg, "-l") == 0 || ::strcmp(arg, "--files-with-matches") == 0)
+            options.files_with_matches = true;
+        else if (::strcmp(arg, "-n") == 0 || ::strcmp(arg, "--line-number") == 0)
+            options.line_number = true;
+        else if (::strcmp(arg, "-b") == 0 || ::strcmp(arg, "--byte-offset") == 0)
+            options.byte_offset = true;
+        else if (::strcmp(arg, "-H") == 0 || ::strcmp(arg, "--with-filename") == 0)
+            options.with_filename = 1;
+        else if (::strcmp(arg, "-h") == 0 || ::strcmp(arg, "--no-filename") == 0)
+            options.with_filename = 0;
+        else if (::strcmp(arg, "-s") == 0 || ::strcmp(arg, "--stats") == 0)
+            options.stats = true;
+        else if (::strcmp(arg, "--no-mmap") == 0)
+            options.file_options.use_mmap = false;
+        else if (::strcmp(arg, "--populate") == 0)
+            options.file_options.populate = true;
+        else if (::strcmp(arg, "--huge-pages") == 0)
+            options.file_options.huge_pages = true;
+        else if (::strcmp(arg, "--list") == 0) {
+            print_algorithms();
+            return kExitMatched;
+        }
+        else if (::strcmp(arg, "--help") == 0) {
+            print_usage();
+            return kExitMatched;
+        }
+        else {
+            ::fprintf(stderr, "smgrep: unknown option: %s\n", arg);
+            print_usage();
+            return kExitError;
+        }
+        continue;
+
+missing_value:
+        ::fprintf(stderr, "smgrep: option requires a value: %s\n", arg);
+        return kExitError;
+    }
+
+    std::size_t first_file = 0;
+    if (!has_pattern_file) {
+        if (args.empty()) {
+            print_usage();
+            return kExitError;
+        }
+        options.patterns.push_back(args[0]);
+        first_file = 1;
+    }
+    for (std::size_t i = first_file; i < args.size(); ++i) {
+        options.files.push_back(args[i]);
+    }
+    if (options.files.empty())
+        options.files.push_back("-");
+
+    if (options.ignore_case && !has_algorithm)
+        options.algorithm = "NoCaseStrStr";
+    const AlgorithmEntry * algorithm = find_algorithm(options.algorithm);
+    if (algorithm == nullptr) {
+        ::fprintf(stderr, "smgrep: unknown algorithm: %s, see --list\n", options.algorithm);
+        return kExitError;
+    }
+    if (options.ignore_case && algorithm != find_algorithm("NoCaseStrStr")) {
+        ::fprintf(stderr, "smgrep: only NoCaseStrStr ignores the case, see -i\n");
+        return kExitError;
+    }
+
+    for (std::size_t i = 0; i < options.patterns.size(); ++i) {
+        const std::string & pattern = options.patterns[i];
+        if (pattern.empty()) {
+            ::fprintf(stderr, "smgrep: the pattern is empty\n");
+            return kExitError;
+        }
+        if (algorithm->max_pattern_len != 0 && pattern.size() > algorithm->max_pattern_len) {
+            ::fprintf(stderr, "smgrep: %s supports the patterns of at most %u chars\n",
+                      algorithm->name, (unsigned)algorithm->max_pattern_len);
+            return kExitError;
+        }
+    }
+    if (options.patterns.empty())
+        return kExitNoMatch;
+
+    return algorithm->run(options);
+}